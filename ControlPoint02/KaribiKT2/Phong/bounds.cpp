@@ -0,0 +1,88 @@
+#include "bounds.hpp"
+#include <cfloat>
+#include <cmath>
+#include <algorithm>
+
+AABB::AABB() {
+    Min = glm::vec3(FLT_MAX);
+    Max = glm::vec3(-FLT_MAX);
+}
+
+AABB::AABB(const glm::vec3& min, const glm::vec3& max) {
+    Min = min;
+    Max = max;
+}
+
+void
+AABB::Extend(const glm::vec3& point) {
+    Min = glm::min(Min, point);
+    Max = glm::max(Max, point);
+}
+
+void
+AABB::Extend(const AABB& other) {
+    Min = glm::min(Min, other.Min);
+    Max = glm::max(Max, other.Max);
+}
+
+glm::vec3
+AABB::GetCenter() const {
+    return (Min + Max) * 0.5f;
+}
+
+glm::vec3
+AABB::GetExtents() const {
+    return (Max - Min) * 0.5f;
+}
+
+AABB
+AABB::Transformed(const glm::mat4& m) const {
+    // NOTE: New extents are the old ones projected onto each world axis by |M|
+    glm::vec3 Center = glm::vec3(m * glm::vec4(GetCenter(), 1.0f));
+    glm::vec3 Extents = GetExtents();
+    glm::vec3 NewExtents;
+    for (unsigned Axis = 0; Axis < 3; ++Axis) {
+        NewExtents[Axis] = std::abs(m[0][Axis]) * Extents.x + std::abs(m[1][Axis]) * Extents.y + std::abs(m[2][Axis]) * Extents.z;
+    }
+
+    return AABB(Center - NewExtents, Center + NewExtents);
+}
+
+bool
+AABB::IntersectsSphere(const glm::vec3& center, float radius) const {
+    glm::vec3 Closest = glm::clamp(center, Min, Max);
+    glm::vec3 Delta = Closest - center;
+    return glm::dot(Delta, Delta) <= radius * radius;
+}
+
+bool
+AABB::IntersectsRay(const glm::vec3& origin, const glm::vec3& invDirection, float maxDistance, float& distance) const {
+    glm::vec3 Near = (Min - origin) * invDirection;
+    glm::vec3 Far = (Max - origin) * invDirection;
+    glm::vec3 Entry = glm::min(Near, Far);
+    glm::vec3 Exit = glm::max(Near, Far);
+    float Enter = std::max(std::max(Entry.x, Entry.y), std::max(Entry.z, 0.0f));
+    float Leave = std::min(std::min(Exit.x, Exit.y), std::min(Exit.z, maxDistance));
+    if (Enter > Leave) {
+        return false;
+    }
+
+    distance = Enter;
+    return true;
+}
+
+BoundingSphere::BoundingSphere() {
+    Center = glm::vec3(0.0f);
+    Radius = 0.0f;
+}
+
+BoundingSphere::BoundingSphere(const glm::vec3& center, float radius) {
+    Center = center;
+    Radius = radius;
+}
+
+BoundingSphere
+BoundingSphere::Transformed(const glm::mat4& m) const {
+    float MaxScale = std::max(glm::length(glm::vec3(m[0])), std::max(glm::length(glm::vec3(m[1])), glm::length(glm::vec3(m[2]))));
+    return BoundingSphere(glm::vec3(m * glm::vec4(Center, 1.0f)), Radius * MaxScale);
+}
@@ -0,0 +1,96 @@
+/**
+ * @file bounds.hpp
+ * @brief Bounding boxes and spheres used for light and visibility tests
+ *
+ */
+
+#pragma once
+#include <glm/glm.hpp>
+
+struct AABB {
+    glm::vec3 Min;
+    glm::vec3 Max;
+
+    /**
+     * @brief Ctor - empty box, extending it with any point makes it valid
+     *
+     */
+    AABB();
+
+    /**
+     * @brief Ctor
+     *
+     * @param min Minimum corner
+     * @param max Maximum corner
+     */
+    AABB(const glm::vec3& min, const glm::vec3& max);
+
+    /**
+     * @brief Grows the box to contain the point
+     *
+     * @param point Point
+     */
+    void Extend(const glm::vec3& point);
+
+    /**
+     * @brief Grows the box to contain another box
+     *
+     * @param other Box
+     */
+    void Extend(const AABB& other);
+
+    glm::vec3 GetCenter() const;
+    glm::vec3 GetExtents() const;
+
+    /**
+     * @brief Returns box containing this box after the transformation
+     *
+     * @param m Model matrix
+     */
+    AABB Transformed(const glm::mat4& m) const;
+
+    /**
+     * @brief Returns whether any point of the box lies within the sphere
+     *
+     * @param center Sphere center
+     * @param radius Sphere radius
+     */
+    bool IntersectsSphere(const glm::vec3& center, float radius) const;
+
+    /**
+     * @brief Slab test of a ray against the box
+     *
+     * @param origin Ray origin
+     * @param invDirection Component-wise inverse of the ray direction
+     * @param maxDistance Hits further along the ray than this are ignored
+     * @param distance Output distance where the ray enters the box, 0 if it starts inside
+     */
+    bool IntersectsRay(const glm::vec3& origin, const glm::vec3& invDirection, float maxDistance, float& distance) const;
+};
+
+struct BoundingSphere {
+    glm::vec3 Center;
+    float Radius;
+
+    /**
+     * @brief Ctor - point sphere at the origin
+     *
+     */
+    BoundingSphere();
+
+    /**
+     * @brief Ctor
+     *
+     * @param center Center
+     * @param radius Radius
+     */
+    BoundingSphere(const glm::vec3& center, float radius);
+
+    /**
+     * @brief Returns sphere containing this sphere after the transformation.
+     * The radius is scaled by the largest axis scale of the matrix
+     *
+     * @param m Model matrix
+     */
+    BoundingSphere Transformed(const glm::mat4& m) const;
+};
@@ -0,0 +1,237 @@
+#include "bvh.hpp"
+#include <algorithm>
+#include <cfloat>
+
+static const unsigned BinCount = 12;
+static const unsigned MaxLeafSize = 4;
+static const unsigned MaxDepth = 48;
+
+static float
+SurfaceArea(const AABB& box) {
+    glm::vec3 Size = box.Max - box.Min;
+    return 2.0f * (Size.x * Size.y + Size.y * Size.z + Size.z * Size.x);
+}
+
+BVH::BVH() {}
+
+void
+BVH::Build(const AABB* bounds, unsigned count) {
+    mNodes.clear();
+    mBounds.assign(bounds, bounds + count);
+    mPrimitives.resize(count);
+    mCentroids.resize(count);
+    for (unsigned PrimIdx = 0; PrimIdx < count; ++PrimIdx) {
+        mPrimitives[PrimIdx] = PrimIdx;
+        mCentroids[PrimIdx] = bounds[PrimIdx].GetCenter();
+    }
+    if (!count) {
+        return;
+    }
+
+    mNodes.reserve(2 * count);
+    Node Root = { AABB(), 0, count };
+    mNodes.push_back(Root);
+    subdivide(0, 0);
+}
+
+void
+BVH::subdivide(unsigned node, unsigned depth) {
+    const unsigned First = mNodes[node].First;
+    const unsigned Count = mNodes[node].Count;
+    AABB Bounds;
+    AABB CentroidBounds;
+    for (unsigned PrimIdx = First; PrimIdx < First + Count; ++PrimIdx) {
+        Bounds.Extend(mBounds[mPrimitives[PrimIdx]]);
+        CentroidBounds.Extend(mCentroids[mPrimitives[PrimIdx]]);
+    }
+    mNodes[node].Bounds = Bounds;
+    if (Count <= MaxLeafSize || depth >= MaxDepth) {
+        return;
+    }
+
+    // NOTE: Binned SAH, cost of a split is area * primitive count summed over both sides
+    float BestCost = FLT_MAX;
+    unsigned BestAxis = 0;
+    unsigned BestSplit = 0;
+    for (unsigned Axis = 0; Axis < 3; ++Axis) {
+        float Min = CentroidBounds.Min[Axis];
+        float Extent = CentroidBounds.Max[Axis] - Min;
+        if (Extent <= 0.0f) {
+            continue;
+        }
+        float Scale = BinCount / Extent;
+
+        AABB BinBounds[BinCount];
+        unsigned BinCounts[BinCount] = { 0 };
+        for (unsigned PrimIdx = First; PrimIdx < First + Count; ++PrimIdx) {
+            unsigned Bin = std::min(BinCount - 1, static_cast<unsigned>((mCentroids[mPrimitives[PrimIdx]][Axis] - Min) * Scale));
+            ++BinCounts[Bin];
+            BinBounds[Bin].Extend(mBounds[mPrimitives[PrimIdx]]);
+        }
+
+        float LeftArea[BinCount - 1];
+        unsigned LeftCount[BinCount - 1];
+        AABB Left;
+        unsigned LeftSum = 0;
+        for (unsigned Bin = 0; Bin < BinCount - 1; ++Bin) {
+            LeftSum += BinCounts[Bin];
+            Left.Extend(BinBounds[Bin]);
+            LeftCount[Bin] = LeftSum;
+            LeftArea[Bin] = LeftSum ? SurfaceArea(Left) : 0.0f;
+        }
+        AABB Right;
+        unsigned RightSum = 0;
+        for (unsigned Bin = BinCount - 1; Bin > 0; --Bin) {
+            RightSum += BinCounts[Bin];
+            Right.Extend(BinBounds[Bin]);
+            if (!RightSum || !LeftCount[Bin - 1]) {
+                continue;
+            }
+            float Cost = LeftCount[Bin - 1] * LeftArea[Bin - 1] + RightSum * SurfaceArea(Right);
+            if (Cost < BestCost) {
+                BestCost = Cost;
+                BestAxis = Axis;
+                BestSplit = Bin;
+            }
+        }
+    }
+
+    // NOTE: Splitting has to beat intersecting every primitive of a leaf
+    if (BestCost == FLT_MAX || BestCost >= Count * SurfaceArea(Bounds)) {
+        return;
+    }
+
+    float Min = CentroidBounds.Min[BestAxis];
+    float Scale = BinCount / (CentroidBounds.Max[BestAxis] - Min);
+    unsigned* Middle = std::partition(&mPrimitives[First], &mPrimitives[First] + Count, [&](unsigned prim) {
+        return std::min(BinCount - 1, static_cast<unsigned>((mCentroids[prim][BestAxis] - Min) * Scale)) < BestSplit;
+    });
+    unsigned LeftCount = Middle - &mPrimitives[First];
+
+    unsigned LeftChild = mNodes.size();
+    Node LeftNode = { AABB(), First, LeftCount };
+    Node RightNode = { AABB(), First + LeftCount, Count - LeftCount };
+    mNodes.push_back(LeftNode);
+    mNodes.push_back(RightNode);
+    mNodes[node].First = LeftChild;
+    mNodes[node].Count = 0;
+    subdivide(LeftChild, depth + 1);
+    subdivide(LeftChild + 1, depth + 1);
+}
+
+void
+BVH::appendSubtree(unsigned node, std::vector<unsigned>& result) const {
+    const Node& Current = mNodes[node];
+    if (Current.Count) {
+        result.insert(result.end(), &mPrimitives[Current.First], &mPrimitives[Current.First] + Current.Count);
+        return;
+    }
+    appendSubtree(Current.First, result);
+    appendSubtree(Current.First + 1, result);
+}
+
+void
+BVH::QueryFrustum(const Frustum& frustum, std::vector<unsigned>& result) const {
+    if (mNodes.empty()) {
+        return;
+    }
+    unsigned Stack[MaxDepth + 2];
+    unsigned StackSize = 0;
+    Stack[StackSize++] = 0;
+    while (StackSize) {
+        const Node& Current = mNodes[Stack[--StackSize]];
+        int Side = frustum.ClassifyAABB(Current.Bounds);
+        if (Side == FRUSTUM_OUTSIDE) {
+            continue;
+        }
+        if (Side == FRUSTUM_INSIDE) {
+            appendSubtree(&Current - mNodes.data(), result);
+            continue;
+        }
+        if (Current.Count) {
+            for (unsigned PrimIdx = Current.First; PrimIdx < Current.First + Current.Count; ++PrimIdx) {
+                if (frustum.IntersectsAABB(mBounds[mPrimitives[PrimIdx]])) {
+                    result.push_back(mPrimitives[PrimIdx]);
+                }
+            }
+            continue;
+        }
+        Stack[StackSize++] = Current.First + 1;
+        Stack[StackSize++] = Current.First;
+    }
+}
+
+void
+BVH::QuerySphere(const glm::vec3& center, float radius, std::vector<unsigned>& result) const {
+    if (mNodes.empty()) {
+        return;
+    }
+    unsigned Stack[MaxDepth + 2];
+    unsigned StackSize = 0;
+    Stack[StackSize++] = 0;
+    while (StackSize) {
+        const Node& Current = mNodes[Stack[--StackSize]];
+        if (!Current.Bounds.IntersectsSphere(center, radius)) {
+            continue;
+        }
+        if (Current.Count) {
+            for (unsigned PrimIdx = Current.First; PrimIdx < Current.First + Current.Count; ++PrimIdx) {
+                if (mBounds[mPrimitives[PrimIdx]].IntersectsSphere(center, radius)) {
+                    result.push_back(mPrimitives[PrimIdx]);
+                }
+            }
+            continue;
+        }
+        Stack[StackSize++] = Current.First + 1;
+        Stack[StackSize++] = Current.First;
+    }
+}
+
+int
+BVH::Raycast(const glm::vec3& origin, const glm::vec3& direction, float maxDistance, float& hitDistance) const {
+    int Hit = -1;
+    hitDistance = maxDistance;
+    if (mNodes.empty()) {
+        return Hit;
+    }
+    const glm::vec3 InvDirection = 1.0f / direction;
+    unsigned Stack[MaxDepth + 2];
+    unsigned StackSize = 0;
+    Stack[StackSize++] = 0;
+    while (StackSize) {
+        const Node& Current = mNodes[Stack[--StackSize]];
+        float Distance;
+        if (!Current.Bounds.IntersectsRay(origin, InvDirection, hitDistance, Distance)) {
+            continue;
+        }
+        if (Current.Count) {
+            for (unsigned PrimIdx = Current.First; PrimIdx < Current.First + Current.Count; ++PrimIdx) {
+                if (mBounds[mPrimitives[PrimIdx]].IntersectsRay(origin, InvDirection, hitDistance, Distance)) {
+                    hitDistance = Distance;
+                    Hit = mPrimitives[PrimIdx];
+                }
+            }
+            continue;
+        }
+
+        // NOTE: Nearer child is popped first so the hit distance shrinks early
+        float LeftDistance = FLT_MAX;
+        float RightDistance = FLT_MAX;
+        bool LeftHit = mNodes[Current.First].Bounds.IntersectsRay(origin, InvDirection, hitDistance, LeftDistance);
+        bool RightHit = mNodes[Current.First + 1].Bounds.IntersectsRay(origin, InvDirection, hitDistance, RightDistance);
+        unsigned Near = LeftDistance <= RightDistance ? Current.First : Current.First + 1;
+        unsigned Far = Near == Current.First ? Current.First + 1 : Current.First;
+        if (LeftHit && RightHit) {
+            Stack[StackSize++] = Far;
+            Stack[StackSize++] = Near;
+        } else if (LeftHit || RightHit) {
+            Stack[StackSize++] = LeftHit ? Current.First : Current.First + 1;
+        }
+    }
+    return Hit;
+}
+
+unsigned
+BVH::GetNodeCount() const {
+    return mNodes.size();
+}
@@ -0,0 +1,73 @@
+/**
+ * @file bvh.hpp
+ * @brief Bounding volume hierarchy over boxes, built with the surface area heuristic
+ *
+ */
+
+#pragma once
+#include <vector>
+#include <glm/glm.hpp>
+#include "bounds.hpp"
+#include "frustum.hpp"
+
+class BVH {
+public:
+    // NOTE: Interior node children are stored next to each other, so a node only
+    // needs the index of its first child. Leaves index a range of mPrimitives instead
+    struct Node {
+        AABB Bounds;
+        unsigned First;
+        unsigned Count;
+    };
+
+    BVH();
+
+    /**
+     * @brief Rebuilds the tree. Primitive ids returned by queries are indices into bounds
+     *
+     * @param bounds Primitive boxes
+     * @param count Number of primitives
+     */
+    void Build(const AABB* bounds, unsigned count);
+
+    /**
+     * @brief Appends every primitive whose box may be inside the frustum. Subtrees
+     * fully inside are appended without testing their primitives
+     *
+     * @param frustum View frustum
+     * @param result Output primitive ids
+     */
+    void QueryFrustum(const Frustum& frustum, std::vector<unsigned>& result) const;
+
+    /**
+     * @brief Appends every primitive whose box intersects the sphere
+     *
+     * @param center Sphere center
+     * @param radius Sphere radius
+     * @param result Output primitive ids
+     */
+    void QuerySphere(const glm::vec3& center, float radius, std::vector<unsigned>& result) const;
+
+    /**
+     * @brief Finds the primitive box hit first by the ray
+     *
+     * @param origin Ray origin
+     * @param direction Ray direction, need not be normalized
+     * @param maxDistance Hits further along the ray than this are ignored, in units of direction
+     * @param hitDistance Output distance of the hit, in units of direction
+     *
+     * @returns Primitive id or -1 if nothing was hit
+     */
+    int Raycast(const glm::vec3& origin, const glm::vec3& direction, float maxDistance, float& hitDistance) const;
+
+    unsigned GetNodeCount() const;
+
+private:
+    std::vector<Node> mNodes;
+    std::vector<unsigned> mPrimitives;
+    std::vector<AABB> mBounds;
+    std::vector<glm::vec3> mCentroids;
+
+    void subdivide(unsigned node, unsigned depth);
+    void appendSubtree(unsigned node, std::vector<unsigned>& result) const;
+};
@@ -0,0 +1,257 @@
+#include "clustered_lighting.hpp"
+#include <algorithm>
+#include <cmath>
+#include <string>
+
+ClusteredLighting::ClusteredLighting() {
+    mProjection = glm::mat4(0.0f);
+    mNear = 0.1f;
+    mFar = 100.0f;
+    mSlices.resize(GRID_Z);
+    mGrid.resize(CLUSTER_COUNT * 2);
+    createTextureBuffer(mGridBuffer, mGridTexture, GL_RG32UI);
+    createTextureBuffer(mIndexBuffer, mIndexTexture, GL_R32UI);
+    createTextureBuffer(mPointBuffer, mPointTexture, GL_RGBA32F);
+    createTextureBuffer(mSpotBuffer, mSpotTexture, GL_RGBA32F);
+}
+
+void
+ClusteredLighting::Build(const LightManager& lights, const glm::mat4& view, const glm::mat4& projection, ThreadPool& pool) {
+    if (!(projection == mProjection)) {
+        buildClusterBounds(projection);
+    }
+
+    const LightManager::PointLights& Points = lights.GetActivePointLights();
+    mPointSpheres.resize(Points.Position.size());
+    for (unsigned LightIdx = 0; LightIdx < Points.Position.size(); ++LightIdx) {
+        mPointSpheres[LightIdx] = glm::vec4(glm::vec3(view * glm::vec4(Points.Position[LightIdx], 1.0f)), Points.Radius[LightIdx]);
+    }
+
+    const LightManager::SpotLights& Spots = lights.GetActiveSpotLights();
+    mSpotSpheres.resize(Spots.Position.size());
+    for (unsigned LightIdx = 0; LightIdx < Spots.Position.size(); ++LightIdx) {
+        mSpotSpheres[LightIdx] = glm::vec4(glm::vec3(view * glm::vec4(Spots.Position[LightIdx], 1.0f)), Spots.Radius[LightIdx]);
+    }
+
+    pool.ParallelFor(GRID_Z, [this](unsigned begin, unsigned end, unsigned) {
+        for (unsigned Slice = begin; Slice < end; ++Slice) {
+            binSlice(Slice);
+        }
+    });
+
+    // NOTE: Slices were binned independently, stitch them into one index list
+    mIndices.clear();
+    for (unsigned Slice = 0; Slice < GRID_Z; ++Slice) {
+        const SliceBins& Bins = mSlices[Slice];
+        unsigned Base = mIndices.size();
+        for (unsigned Tile = 0; Tile < GRID_X * GRID_Y; ++Tile) {
+            unsigned Cluster = Slice * GRID_X * GRID_Y + Tile;
+            mGrid[Cluster * 2] = Base + Bins.TileOffsets[Tile];
+            mGrid[Cluster * 2 + 1] = Bins.TileCounts[Tile];
+        }
+        mIndices.insert(mIndices.end(), Bins.Indices.begin(), Bins.Indices.end());
+    }
+
+    packLights(lights);
+    upload();
+}
+
+void
+ClusteredLighting::Bind(const Shader& shader, int screenWidth, int screenHeight) const {
+    glActiveTexture(GL_TEXTURE0 + GRID_TEXTURE_UNIT);
+    glBindTexture(GL_TEXTURE_BUFFER, mGridTexture);
+    glActiveTexture(GL_TEXTURE0 + INDEX_TEXTURE_UNIT);
+    glBindTexture(GL_TEXTURE_BUFFER, mIndexTexture);
+    glActiveTexture(GL_TEXTURE0 + POINT_TEXTURE_UNIT);
+    glBindTexture(GL_TEXTURE_BUFFER, mPointTexture);
+    glActiveTexture(GL_TEXTURE0 + SPOT_TEXTURE_UNIT);
+    glBindTexture(GL_TEXTURE_BUFFER, mSpotTexture);
+    glActiveTexture(GL_TEXTURE0);
+
+    shader.SetUniform1i("uClusterGrid", GRID_TEXTURE_UNIT);
+    shader.SetUniform1i("uClusterIndices", INDEX_TEXTURE_UNIT);
+    shader.SetUniform1i("uPointLightData", POINT_TEXTURE_UNIT);
+    shader.SetUniform1i("uSpotLightData", SPOT_TEXTURE_UNIT);
+    shader.SetUniform2f("uClusterScreenScale", glm::vec2(GRID_X / static_cast<float>(screenWidth), GRID_Y / static_cast<float>(screenHeight)));
+
+    // NOTE: Slice = log(depth / near) / log(far / near) * GRID_Z, folded into a scale and bias on log(depth)
+    float LogRange = std::log(mFar / mNear);
+    shader.SetUniform2f("uClusterDepthScaleBias", glm::vec2(GRID_Z / LogRange, -GRID_Z * std::log(mNear) / LogRange));
+}
+
+unsigned
+ClusteredLighting::GetLightIndexCount() const {
+    return mIndices.size();
+}
+
+std::vector<std::string>
+ClusteredLighting::GetDefines() {
+    return {
+        "CLUSTER_GRID_X " + std::to_string(GRID_X),
+        "CLUSTER_GRID_Y " + std::to_string(GRID_Y),
+        "CLUSTER_GRID_Z " + std::to_string(GRID_Z),
+    };
+}
+
+void
+ClusteredLighting::buildClusterBounds(const glm::mat4& projection) {
+    mProjection = projection;
+    mNear = projection[3][2] / (projection[2][2] - 1.0f);
+    mFar = projection[3][2] / (projection[2][2] + 1.0f);
+    glm::mat4 InverseProjection = glm::inverse(projection);
+
+    mClusterMin.resize(CLUSTER_COUNT);
+    mClusterMax.resize(CLUSTER_COUNT);
+    for (unsigned Y = 0; Y < GRID_Y; ++Y) {
+        for (unsigned X = 0; X < GRID_X; ++X) {
+            // NOTE: Tile corners on the near plane, scaled along their view rays to each slice depth
+            glm::vec3 Corners[4];
+            for (unsigned CornerIdx = 0; CornerIdx < 4; ++CornerIdx) {
+                float NdcX = -1.0f + 2.0f * (X + (CornerIdx & 1)) / GRID_X;
+                float NdcY = -1.0f + 2.0f * (Y + (CornerIdx >> 1)) / GRID_Y;
+                glm::vec4 Corner = InverseProjection * glm::vec4(NdcX, NdcY, -1.0f, 1.0f);
+                Corners[CornerIdx] = glm::vec3(Corner) / Corner.w;
+            }
+
+            for (unsigned Slice = 0; Slice < GRID_Z; ++Slice) {
+                float Depths[2] = { sliceDepth(Slice), sliceDepth(Slice + 1) };
+                glm::vec3 Min(1e30f);
+                glm::vec3 Max(-1e30f);
+                for (unsigned CornerIdx = 0; CornerIdx < 4; ++CornerIdx) {
+                    for (unsigned DepthIdx = 0; DepthIdx < 2; ++DepthIdx) {
+                        glm::vec3 Point = Corners[CornerIdx] * (Depths[DepthIdx] / -Corners[CornerIdx].z);
+                        Min = glm::min(Min, Point);
+                        Max = glm::max(Max, Point);
+                    }
+                }
+                unsigned Cluster = (Slice * GRID_Y + Y) * GRID_X + X;
+                mClusterMin[Cluster] = Min;
+                mClusterMax[Cluster] = Max;
+            }
+        }
+    }
+}
+
+float
+ClusteredLighting::sliceDepth(unsigned slice) const {
+    return mNear * std::pow(mFar / mNear, slice / static_cast<float>(GRID_Z));
+}
+
+static bool
+SphereIntersectsBox(const glm::vec4& sphere, const glm::vec3& boxMin, const glm::vec3& boxMax) {
+    glm::vec3 Center(sphere);
+    glm::vec3 Closest = glm::clamp(Center, boxMin, boxMax);
+    glm::vec3 Delta = Closest - Center;
+    return glm::dot(Delta, Delta) <= sphere.w * sphere.w;
+}
+
+void
+ClusteredLighting::binSlice(unsigned slice) {
+    SliceBins& Bins = mSlices[slice];
+    float SliceNear = sliceDepth(slice);
+    float SliceFar = sliceDepth(slice + 1);
+
+    // NOTE: Cheap depth rejection first, the per tile test only sees lights overlapping the slice
+    Bins.PointCandidates.clear();
+    for (unsigned LightIdx = 0; LightIdx < mPointSpheres.size(); ++LightIdx) {
+        float Depth = -mPointSpheres[LightIdx].z;
+        float Radius = mPointSpheres[LightIdx].w;
+        if (Depth + Radius >= SliceNear && Depth - Radius <= SliceFar) {
+            Bins.PointCandidates.push_back(LightIdx);
+        }
+    }
+    Bins.SpotCandidates.clear();
+    for (unsigned LightIdx = 0; LightIdx < mSpotSpheres.size(); ++LightIdx) {
+        float Depth = -mSpotSpheres[LightIdx].z;
+        float Radius = mSpotSpheres[LightIdx].w;
+        if (Depth + Radius >= SliceNear && Depth - Radius <= SliceFar) {
+            Bins.SpotCandidates.push_back(LightIdx);
+        }
+    }
+
+    Bins.TileOffsets.resize(GRID_X * GRID_Y);
+    Bins.TileCounts.resize(GRID_X * GRID_Y);
+    Bins.Indices.clear();
+    for (unsigned Tile = 0; Tile < GRID_X * GRID_Y; ++Tile) {
+        unsigned Cluster = slice * GRID_X * GRID_Y + Tile;
+        const glm::vec3& Min = mClusterMin[Cluster];
+        const glm::vec3& Max = mClusterMax[Cluster];
+        Bins.TileOffsets[Tile] = Bins.Indices.size();
+
+        unsigned PointCount = 0;
+        for (unsigned LightIdx : Bins.PointCandidates) {
+            if (SphereIntersectsBox(mPointSpheres[LightIdx], Min, Max)) {
+                Bins.Indices.push_back(LightIdx);
+                ++PointCount;
+            }
+        }
+        unsigned SpotCount = 0;
+        for (unsigned LightIdx : Bins.SpotCandidates) {
+            if (SphereIntersectsBox(mSpotSpheres[LightIdx], Min, Max)) {
+                Bins.Indices.push_back(LightIdx);
+                ++SpotCount;
+            }
+        }
+        Bins.TileCounts[Tile] = std::min(PointCount, 0xFFFFu) | (std::min(SpotCount, 0xFFFFu) << 16);
+    }
+}
+
+void
+ClusteredLighting::packLights(const LightManager& lights) {
+    // NOTE: Layout must match the texelFetch offsets in phong_material_texture.frag
+    const LightManager::PointLights& Points = lights.GetActivePointLights();
+    mPointData.resize(Points.Position.size() * 4);
+    for (unsigned LightIdx = 0; LightIdx < Points.Position.size(); ++LightIdx) {
+        glm::vec4* Texels = &mPointData[LightIdx * 4];
+        const glm::vec3& Attenuation = Points.Attenuation[LightIdx];
+        Texels[0] = glm::vec4(Points.Position[LightIdx], Attenuation.x);
+        Texels[1] = glm::vec4(Points.Ka[LightIdx], Attenuation.y);
+        Texels[2] = glm::vec4(Points.Kd[LightIdx], Attenuation.z);
+        Texels[3] = glm::vec4(Points.Ks[LightIdx], 0.0f);
+    }
+
+    const LightManager::SpotLights& Spots = lights.GetActiveSpotLights();
+    mSpotData.resize(Spots.Position.size() * 5);
+    for (unsigned LightIdx = 0; LightIdx < Spots.Position.size(); ++LightIdx) {
+        glm::vec4* Texels = &mSpotData[LightIdx * 5];
+        const glm::vec3& Attenuation = Spots.Attenuation[LightIdx];
+        Texels[0] = glm::vec4(Spots.Position[LightIdx], Attenuation.x);
+        Texels[1] = glm::vec4(Spots.Ka[LightIdx], Attenuation.y);
+        Texels[2] = glm::vec4(Spots.Kd[LightIdx], Attenuation.z);
+        Texels[3] = glm::vec4(Spots.Ks[LightIdx], Spots.CutOff[LightIdx].x);
+        Texels[4] = glm::vec4(Spots.Direction[LightIdx], Spots.CutOff[LightIdx].y);
+    }
+}
+
+void
+ClusteredLighting::upload() {
+    uploadTextureBuffer(mGridBuffer, mGrid.data(), mGrid.size() * sizeof(unsigned));
+    uploadTextureBuffer(mIndexBuffer, mIndices.data(), mIndices.size() * sizeof(unsigned));
+    uploadTextureBuffer(mPointBuffer, mPointData.data(), mPointData.size() * sizeof(glm::vec4));
+    uploadTextureBuffer(mSpotBuffer, mSpotData.data(), mSpotData.size() * sizeof(glm::vec4));
+}
+
+void
+ClusteredLighting::createTextureBuffer(unsigned& buffer, unsigned& texture, GLenum format) {
+    glGenBuffers(1, &buffer);
+    glBindBuffer(GL_TEXTURE_BUFFER, buffer);
+    glBufferData(GL_TEXTURE_BUFFER, sizeof(glm::vec4), 0, GL_STREAM_DRAW);
+    glGenTextures(1, &texture);
+    glBindTexture(GL_TEXTURE_BUFFER, texture);
+    glTexBuffer(GL_TEXTURE_BUFFER, format, buffer);
+    glBindTexture(GL_TEXTURE_BUFFER, 0);
+    glBindBuffer(GL_TEXTURE_BUFFER, 0);
+}
+
+void
+ClusteredLighting::uploadTextureBuffer(unsigned buffer, const void* data, size_t size) {
+    if (!size) {
+        return;
+    }
+
+    // NOTE: Orphan the previous storage so the driver doesn't wait on last frame's draws
+    glBindBuffer(GL_TEXTURE_BUFFER, buffer);
+    glBufferData(GL_TEXTURE_BUFFER, size, 0, GL_STREAM_DRAW);
+    glBufferSubData(GL_TEXTURE_BUFFER, 0, size, data);
+    glBindBuffer(GL_TEXTURE_BUFFER, 0);
+}
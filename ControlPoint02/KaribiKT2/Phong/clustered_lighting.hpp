@@ -0,0 +1,110 @@
+/**
+ * @file clustered_lighting.hpp
+ * @brief Bins point and spot lights into a view frustum cluster grid
+ * so each fragment only shades the lights that can reach it
+ *
+ */
+
+#pragma once
+#include <vector>
+#include <GL/glew.h>
+#include <glm/glm.hpp>
+#include "shader.hpp"
+#include "light_manager.hpp"
+#include "thread_pool.hpp"
+
+class ClusteredLighting {
+public:
+    // NOTE: Injected into the shader as CLUSTER_GRID_* defines
+    static const unsigned GRID_X = 16;
+    static const unsigned GRID_Y = 9;
+    static const unsigned GRID_Z = 24;
+    static const unsigned CLUSTER_COUNT = GRID_X * GRID_Y * GRID_Z;
+
+    // NOTE: Texture units used by the cluster buffers, 0 and 1 are material maps
+    static const unsigned GRID_TEXTURE_UNIT = 2;
+    static const unsigned INDEX_TEXTURE_UNIT = 3;
+    static const unsigned POINT_TEXTURE_UNIT = 4;
+    static const unsigned SPOT_TEXTURE_UNIT = 5;
+
+    /**
+     * @brief Ctor - creates the texture buffers
+     *
+     */
+    ClusteredLighting();
+
+    /**
+     * @brief Assigns active lights to clusters and uploads the grid, the
+     * light index list and the light data. Slices are binned in parallel
+     *
+     * @param lights Lights, Update must have been called this frame
+     * @param view View matrix
+     * @param projection Projection matrix
+     * @param pool Worker threads
+     */
+    void Build(const LightManager& lights, const glm::mat4& view, const glm::mat4& projection, ThreadPool& pool);
+
+    /**
+     * @brief Binds the cluster buffers and sets lookup uniforms on the bound shader
+     *
+     * @param shader Currently bound shader
+     * @param screenWidth Framebuffer width
+     * @param screenHeight Framebuffer height
+     */
+    void Bind(const Shader& shader, int screenWidth, int screenHeight) const;
+
+    /**
+     * @brief Returns total number of light references over all clusters
+     *
+     */
+    unsigned GetLightIndexCount() const;
+
+    /**
+     * @brief Returns defines the shader needs to match the grid layout
+     *
+     */
+    static std::vector<std::string> GetDefines();
+
+private:
+    struct SliceBins {
+        std::vector<unsigned> PointCandidates;
+        std::vector<unsigned> SpotCandidates;
+        // NOTE: Offset into Indices and packed counts for each tile in the slice
+        std::vector<unsigned> TileOffsets;
+        std::vector<unsigned> TileCounts;
+        std::vector<unsigned> Indices;
+    };
+
+    unsigned mGridBuffer;
+    unsigned mGridTexture;
+    unsigned mIndexBuffer;
+    unsigned mIndexTexture;
+    unsigned mPointBuffer;
+    unsigned mPointTexture;
+    unsigned mSpotBuffer;
+    unsigned mSpotTexture;
+
+    glm::mat4 mProjection;
+    float mNear;
+    float mFar;
+    std::vector<glm::vec3> mClusterMin;
+    std::vector<glm::vec3> mClusterMax;
+
+    // NOTE: View space center and radius of each active light
+    std::vector<glm::vec4> mPointSpheres;
+    std::vector<glm::vec4> mSpotSpheres;
+    std::vector<SliceBins> mSlices;
+
+    std::vector<unsigned> mGrid;
+    std::vector<unsigned> mIndices;
+    std::vector<glm::vec4> mPointData;
+    std::vector<glm::vec4> mSpotData;
+
+    void buildClusterBounds(const glm::mat4& projection);
+    float sliceDepth(unsigned slice) const;
+    void binSlice(unsigned slice);
+    void packLights(const LightManager& lights);
+    void upload();
+    static void createTextureBuffer(unsigned& buffer, unsigned& texture, GLenum format);
+    static void uploadTextureBuffer(unsigned buffer, const void* data, size_t size);
+};
@@ -0,0 +1,166 @@
+#include "command_list.hpp"
+
+template<typename T>
+static T
+Read(const unsigned char*& cursor) {
+    T Value;
+    std::memcpy(&Value, cursor, sizeof(T));
+    cursor += sizeof(T);
+    return Value;
+}
+
+CommandList::CommandList() : mCommandCount(0) {}
+
+void
+CommandList::Clear() {
+    mBytes.clear();
+    mCommandCount = 0;
+}
+
+void
+CommandList::UseProgram(unsigned program) {
+    begin(CMD_USE_PROGRAM);
+    write(program);
+}
+
+void
+CommandList::BindVertexArray(unsigned vao) {
+    begin(CMD_BIND_VERTEX_ARRAY);
+    write(vao);
+}
+
+void
+CommandList::BindTexture(unsigned unit, unsigned texture) {
+    begin(CMD_BIND_TEXTURE);
+    write(unit);
+    write(texture);
+}
+
+unsigned
+CommandList::UniformMatrix4(int location, const glm::mat4& value) {
+    begin(CMD_UNIFORM_MATRIX4);
+    write(location);
+    return write(value);
+}
+
+unsigned
+CommandList::UniformMatrix3(int location, const glm::mat3& value) {
+    begin(CMD_UNIFORM_MATRIX3);
+    write(location);
+    return write(value);
+}
+
+void
+CommandList::DrawArrays(unsigned first, unsigned count) {
+    begin(CMD_DRAW_ARRAYS);
+    write(first);
+    write(count);
+}
+
+void
+CommandList::DrawArraysInstanced(unsigned first, unsigned count, unsigned instanceCount) {
+    begin(CMD_DRAW_ARRAYS_INSTANCED);
+    write(first);
+    write(count);
+    write(instanceCount);
+}
+
+void
+CommandList::MultiDrawArraysIndirect(unsigned offset, unsigned drawCount) {
+    begin(CMD_MULTI_DRAW_ARRAYS_INDIRECT);
+    write(offset);
+    write(drawCount);
+}
+
+void
+CommandList::DrawArraysIndirect(unsigned offset) {
+    begin(CMD_DRAW_ARRAYS_INDIRECT);
+    write(offset);
+}
+
+void
+CommandList::Call(Callback function, void* data, unsigned arg) {
+    begin(CMD_CALL);
+    write(function);
+    write(data);
+    write(arg);
+}
+
+void
+CommandList::PatchMatrix4(unsigned offset, const glm::mat4& value) {
+    std::memcpy(&mBytes[offset], &value, sizeof(glm::mat4));
+}
+
+void
+CommandList::PatchMatrix3(unsigned offset, const glm::mat3& value) {
+    std::memcpy(&mBytes[offset], &value, sizeof(glm::mat3));
+}
+
+void
+CommandList::Execute() const {
+    const unsigned char* Cursor = mBytes.data();
+    const unsigned char* End = Cursor + mBytes.size();
+    while (Cursor < End) {
+        switch (Read<unsigned>(Cursor)) {
+        case CMD_USE_PROGRAM: {
+            glUseProgram(Read<unsigned>(Cursor));
+        } break;
+        case CMD_BIND_VERTEX_ARRAY: {
+            glBindVertexArray(Read<unsigned>(Cursor));
+        } break;
+        case CMD_BIND_TEXTURE: {
+            unsigned Unit = Read<unsigned>(Cursor);
+            glActiveTexture(GL_TEXTURE0 + Unit);
+            glBindTexture(GL_TEXTURE_2D, Read<unsigned>(Cursor));
+        } break;
+        case CMD_UNIFORM_MATRIX4: {
+            int Location = Read<int>(Cursor);
+            // NOTE: Values are only copied in, so they can be passed straight from the stream
+            glUniformMatrix4fv(Location, 1, GL_FALSE, reinterpret_cast<const float*>(Cursor));
+            Cursor += sizeof(glm::mat4);
+        } break;
+        case CMD_UNIFORM_MATRIX3: {
+            int Location = Read<int>(Cursor);
+            glUniformMatrix3fv(Location, 1, GL_FALSE, reinterpret_cast<const float*>(Cursor));
+            Cursor += sizeof(glm::mat3);
+        } break;
+        case CMD_DRAW_ARRAYS: {
+            unsigned First = Read<unsigned>(Cursor);
+            glDrawArrays(GL_TRIANGLES, First, Read<unsigned>(Cursor));
+        } break;
+        case CMD_DRAW_ARRAYS_INSTANCED: {
+            unsigned First = Read<unsigned>(Cursor);
+            unsigned Count = Read<unsigned>(Cursor);
+            glDrawArraysInstanced(GL_TRIANGLES, First, Count, Read<unsigned>(Cursor));
+        } break;
+        case CMD_MULTI_DRAW_ARRAYS_INDIRECT: {
+            unsigned Offset = Read<unsigned>(Cursor);
+            glMultiDrawArraysIndirect(GL_TRIANGLES, static_cast<const char*>(0) + Offset, Read<unsigned>(Cursor), 0);
+        } break;
+        case CMD_DRAW_ARRAYS_INDIRECT: {
+            glDrawArraysIndirect(GL_TRIANGLES, static_cast<const char*>(0) + Read<unsigned>(Cursor));
+        } break;
+        case CMD_CALL: {
+            Callback Function = Read<Callback>(Cursor);
+            void* Data = Read<void*>(Cursor);
+            Function(Data, Read<unsigned>(Cursor));
+        } break;
+        }
+    }
+}
+
+unsigned
+CommandList::GetCommandCount() const {
+    return mCommandCount;
+}
+
+unsigned
+CommandList::GetSize() const {
+    return mBytes.size();
+}
+
+void
+CommandList::begin(ECommand command) {
+    write(static_cast<unsigned>(command));
+    ++mCommandCount;
+}
@@ -0,0 +1,109 @@
+/**
+ * @file command_list.hpp
+ * @brief Draw, bind and uniform commands recorded into a compact byte stream and
+ * replayed by one dispatch loop. Values that change between replays are patched in place
+ *
+ */
+
+#pragma once
+#include <cstring>
+#include <vector>
+#include <GL/glew.h>
+#include <glm/glm.hpp>
+
+class CommandList {
+public:
+    /**
+     * @brief Work that cannot be recorded as plain GL calls, run in order during Execute
+     *
+     * @param data Pointer given when recording
+     * @param arg Value given when recording
+     */
+    typedef void (*Callback)(void* data, unsigned arg);
+
+    CommandList();
+
+    /**
+     * @brief Removes all commands, keeping the memory
+     *
+     */
+    void Clear();
+
+    void UseProgram(unsigned program);
+    void BindVertexArray(unsigned vao);
+    void BindTexture(unsigned unit, unsigned texture);
+
+    /**
+     * @brief Records a mat4 uniform upload
+     *
+     * @returns Offset of the value, for PatchMatrix4
+     */
+    unsigned UniformMatrix4(int location, const glm::mat4& value);
+
+    /**
+     * @brief Records a mat3 uniform upload
+     *
+     * @returns Offset of the value, for PatchMatrix3
+     */
+    unsigned UniformMatrix3(int location, const glm::mat3& value);
+
+    void DrawArrays(unsigned first, unsigned count);
+    void DrawArraysInstanced(unsigned first, unsigned count, unsigned instanceCount);
+
+    /**
+     * @brief Records draws sourced from the GL_DRAW_INDIRECT_BUFFER bound at replay
+     *
+     * @param offset Byte offset of the first command in the buffer
+     * @param drawCount Number of commands, drawn with one glMultiDrawArraysIndirect
+     */
+    void MultiDrawArraysIndirect(unsigned offset, unsigned drawCount);
+
+    /**
+     * @brief Records one draw sourced from the bound GL_DRAW_INDIRECT_BUFFER
+     *
+     * @param offset Byte offset of the command in the buffer
+     */
+    void DrawArraysIndirect(unsigned offset);
+
+    void Call(Callback function, void* data, unsigned arg);
+
+    void PatchMatrix4(unsigned offset, const glm::mat4& value);
+    void PatchMatrix3(unsigned offset, const glm::mat3& value);
+
+    /**
+     * @brief Replays the commands in recorded order. Needs the GL context
+     *
+     */
+    void Execute() const;
+
+    unsigned GetCommandCount() const;
+    unsigned GetSize() const;
+
+private:
+    enum ECommand {
+        CMD_USE_PROGRAM,
+        CMD_BIND_VERTEX_ARRAY,
+        CMD_BIND_TEXTURE,
+        CMD_UNIFORM_MATRIX4,
+        CMD_UNIFORM_MATRIX3,
+        CMD_DRAW_ARRAYS,
+        CMD_DRAW_ARRAYS_INSTANCED,
+        CMD_MULTI_DRAW_ARRAYS_INDIRECT,
+        CMD_DRAW_ARRAYS_INDIRECT,
+        CMD_CALL,
+    };
+
+    // NOTE: Every command is a 32 bit opcode followed by its arguments, all 4 byte aligned
+    std::vector<unsigned char> mBytes;
+    unsigned mCommandCount;
+
+    template<typename T>
+    unsigned write(const T& value) {
+        unsigned Offset = mBytes.size();
+        mBytes.resize(Offset + sizeof(T));
+        std::memcpy(&mBytes[Offset], &value, sizeof(T));
+        return Offset;
+    }
+
+    void begin(ECommand command);
+};
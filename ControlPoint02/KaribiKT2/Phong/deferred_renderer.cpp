@@ -0,0 +1,141 @@
+#include "deferred_renderer.hpp"
+#include "render_queue.hpp"
+
+static void
+SetGeometryDefaults(const Shader& shader) {
+    shader.SetUniform1i("uMaterial.Kd", 0);
+    shader.SetUniform1i("uMaterial.Ks", 1);
+    shader.SetUniform1f("uMaterial.Shininess", 64);
+    shader.SetUniform1i("uDrawData", RenderQueue::DRAW_DATA_TEXTURE_UNIT);
+}
+
+static void
+SetLightingDefaults(const Shader& shader) {
+    shader.SetUniform1i("uGAlbedo", DeferredRenderer::ALBEDO_TEXTURE_UNIT);
+    shader.SetUniform1i("uGSpecular", DeferredRenderer::SPECULAR_TEXTURE_UNIT);
+    shader.SetUniform1i("uGNormal", DeferredRenderer::NORMAL_TEXTURE_UNIT);
+    shader.SetUniform1i("uGDepth", DeferredRenderer::DEPTH_TEXTURE_UNIT);
+}
+
+DeferredRenderer::DeferredRenderer(int width, int height, const std::vector<std::string>& lightDefines)
+    : mGeometryShader("shaders/basic.vert", "shaders/gbuffer.frag"),
+      mIndirectGeometryShader("shaders/basic.vert", "shaders/gbuffer.frag", std::vector<std::string>(1, "INDIRECT_DRAW")),
+      mLightingVariants("shaders/deferred_lighting.vert", "shaders/deferred_lighting.frag", lightDefines, SetLightingDefaults) {
+    mWidth = width;
+    mHeight = height;
+    glUseProgram(mGeometryShader.GetId());
+    SetGeometryDefaults(mGeometryShader);
+    glUseProgram(mIndirectGeometryShader.GetId());
+    SetGeometryDefaults(mIndirectGeometryShader);
+    glUseProgram(0);
+
+    glGenVertexArrays(1, &mFullscreenVAO);
+    createTargets();
+
+    // NOTE: Only the clustered variants exist, with and without the sun
+    mLightingVariants.Get(LIGHT_CLUSTERED);
+    mLightingVariants.Get(LIGHT_CLUSTERED | LIGHT_DIRECTIONAL);
+}
+
+const Shader&
+DeferredRenderer::BeginGeometryPass(bool indirect) {
+    glBindFramebuffer(GL_FRAMEBUFFER, mFBO);
+    glClear(GL_COLOR_BUFFER_BIT | GL_DEPTH_BUFFER_BIT);
+    const Shader& Geometry = indirect ? mIndirectGeometryShader : mGeometryShader;
+    glUseProgram(Geometry.GetId());
+    return Geometry;
+}
+
+void
+DeferredRenderer::Resize(int width, int height) {
+    if (width <= 0 || height <= 0 || (width == mWidth && height == mHeight)) {
+        return;
+    }
+    deleteTargets();
+    mWidth = width;
+    mHeight = height;
+    createTargets();
+}
+
+void
+DeferredRenderer::LightingPass(const LightManager& lights, const ClusteredLighting& clusters, const glm::mat4& view, const glm::mat4& projection, const glm::vec3& viewPos) {
+    glBindFramebuffer(GL_FRAMEBUFFER, 0);
+    glClear(GL_COLOR_BUFFER_BIT | GL_DEPTH_BUFFER_BIT);
+
+    const Shader& Lighting = mLightingVariants.Get((lights.GetVariantMask() & LIGHT_DIRECTIONAL) | LIGHT_CLUSTERED);
+    glUseProgram(Lighting.GetId());
+    Lighting.SetView(view);
+    Lighting.SetUniform4m("uInverseViewProjection", glm::inverse(projection * view));
+    Lighting.SetUniform3f("uViewPos", viewPos);
+    lights.Upload(Lighting);
+    clusters.Bind(Lighting, mWidth, mHeight);
+
+    glActiveTexture(GL_TEXTURE0 + ALBEDO_TEXTURE_UNIT);
+    glBindTexture(GL_TEXTURE_2D, mAlbedoTexture);
+    glActiveTexture(GL_TEXTURE0 + SPECULAR_TEXTURE_UNIT);
+    glBindTexture(GL_TEXTURE_2D, mSpecularTexture);
+    glActiveTexture(GL_TEXTURE0 + NORMAL_TEXTURE_UNIT);
+    glBindTexture(GL_TEXTURE_2D, mNormalTexture);
+    glActiveTexture(GL_TEXTURE0 + DEPTH_TEXTURE_UNIT);
+    glBindTexture(GL_TEXTURE_2D, mDepthTexture);
+    glActiveTexture(GL_TEXTURE0);
+
+    glDisable(GL_DEPTH_TEST);
+    glBindVertexArray(mFullscreenVAO);
+    glDrawArrays(GL_TRIANGLES, 0, 3);
+    glBindVertexArray(0);
+    glEnable(GL_DEPTH_TEST);
+
+    // NOTE: Scene depth is needed by anything drawn forward on top of the lit image
+    glBindFramebuffer(GL_READ_FRAMEBUFFER, mFBO);
+    glBlitFramebuffer(0, 0, mWidth, mHeight, 0, 0, mWidth, mHeight, GL_DEPTH_BUFFER_BIT, GL_NEAREST);
+    glBindFramebuffer(GL_FRAMEBUFFER, 0);
+}
+
+void
+DeferredRenderer::createTargets() {
+    // NOTE: Layout
+    // 0: RGBA8   albedo
+    // 1: RGBA8   specular color, shininess / 256
+    // 2: RG16F   octahedral encoded world space normal
+    // D: DEPTH24_STENCIL8, same as the default framebuffer so it can be blitted
+    mAlbedoTexture = createTarget(GL_RGBA8, GL_RGBA, GL_UNSIGNED_BYTE, mWidth, mHeight);
+    mSpecularTexture = createTarget(GL_RGBA8, GL_RGBA, GL_UNSIGNED_BYTE, mWidth, mHeight);
+    mNormalTexture = createTarget(GL_RG16F, GL_RG, GL_FLOAT, mWidth, mHeight);
+    mDepthTexture = createTarget(GL_DEPTH24_STENCIL8, GL_DEPTH_STENCIL, GL_UNSIGNED_INT_24_8, mWidth, mHeight);
+
+    glGenFramebuffers(1, &mFBO);
+    glBindFramebuffer(GL_FRAMEBUFFER, mFBO);
+    glFramebufferTexture2D(GL_FRAMEBUFFER, GL_COLOR_ATTACHMENT0, GL_TEXTURE_2D, mAlbedoTexture, 0);
+    glFramebufferTexture2D(GL_FRAMEBUFFER, GL_COLOR_ATTACHMENT1, GL_TEXTURE_2D, mSpecularTexture, 0);
+    glFramebufferTexture2D(GL_FRAMEBUFFER, GL_COLOR_ATTACHMENT2, GL_TEXTURE_2D, mNormalTexture, 0);
+    glFramebufferTexture2D(GL_FRAMEBUFFER, GL_DEPTH_STENCIL_ATTACHMENT, GL_TEXTURE_2D, mDepthTexture, 0);
+    const GLenum DrawBuffers[] = { GL_COLOR_ATTACHMENT0, GL_COLOR_ATTACHMENT1, GL_COLOR_ATTACHMENT2 };
+    glDrawBuffers(3, DrawBuffers);
+
+    if (glCheckFramebufferStatus(GL_FRAMEBUFFER) != GL_FRAMEBUFFER_COMPLETE) {
+        std::cerr << "[Err] G-buffer framebuffer is incomplete" << std::endl;
+    }
+    glBindFramebuffer(GL_FRAMEBUFFER, 0);
+}
+
+void
+DeferredRenderer::deleteTargets() {
+    glDeleteFramebuffers(1, &mFBO);
+    const unsigned Targets[] = { mAlbedoTexture, mSpecularTexture, mNormalTexture, mDepthTexture };
+    glDeleteTextures(4, Targets);
+}
+
+unsigned
+DeferredRenderer::createTarget(GLenum internalFormat, GLenum format, GLenum type, int width, int height) {
+    unsigned Texture;
+    glGenTextures(1, &Texture);
+    glBindTexture(GL_TEXTURE_2D, Texture);
+    glTexImage2D(GL_TEXTURE_2D, 0, internalFormat, width, height, 0, format, type, 0);
+    glTexParameteri(GL_TEXTURE_2D, GL_TEXTURE_MIN_FILTER, GL_NEAREST);
+    glTexParameteri(GL_TEXTURE_2D, GL_TEXTURE_MAG_FILTER, GL_NEAREST);
+    glTexParameteri(GL_TEXTURE_2D, GL_TEXTURE_WRAP_S, GL_CLAMP_TO_EDGE);
+    glTexParameteri(GL_TEXTURE_2D, GL_TEXTURE_WRAP_T, GL_CLAMP_TO_EDGE);
+    glBindTexture(GL_TEXTURE_2D, 0);
+    return Texture;
+}
@@ -0,0 +1,84 @@
+/**
+ * @file deferred_renderer.hpp
+ * @brief G-buffer and screen space lighting pass for deferred shading
+ *
+ */
+
+#pragma once
+#include <string>
+#include <vector>
+#include <GL/glew.h>
+#include <glm/glm.hpp>
+#include "shader.hpp"
+#include "shader_variants.hpp"
+#include "light_manager.hpp"
+#include "clustered_lighting.hpp"
+
+class DeferredRenderer {
+public:
+    // NOTE: G-buffer texture units, kept clear of the material (0, 1) and cluster (2 - 5) units
+    static const unsigned ALBEDO_TEXTURE_UNIT = 6;
+    static const unsigned SPECULAR_TEXTURE_UNIT = 7;
+    static const unsigned NORMAL_TEXTURE_UNIT = 8;
+    static const unsigned DEPTH_TEXTURE_UNIT = 9;
+
+    /**
+     * @brief Ctor - creates the G-buffer and compiles the geometry pass program
+     *
+     * @param width Framebuffer width
+     * @param height Framebuffer height
+     * @param lightDefines Defines shared with the forward light shaders (array sizes, cluster grid)
+     */
+    DeferredRenderer(int width, int height, const std::vector<std::string>& lightDefines);
+    DeferredRenderer(const DeferredRenderer&) = delete;
+    DeferredRenderer& operator=(const DeferredRenderer&) = delete;
+
+    /**
+     * @brief Binds and clears the G-buffer
+     *
+     * @param indirect Return the program that reads transforms from the render queue's draw data
+     *
+     * @returns Geometry pass shader, bound. Scene is drawn with it as with any forward shader
+     */
+    const Shader& BeginGeometryPass(bool indirect = false);
+
+    /**
+     * @brief Recreates the G-buffer if the framebuffer size changed. Empty sizes, e.g. of a
+     * minimized window, keep the old one
+     *
+     * @param width Framebuffer width
+     * @param height Framebuffer height
+     */
+    void Resize(int width, int height);
+
+    /**
+     * @brief Shades the G-buffer into the default framebuffer. Point and spot
+     * lights come from the cluster grid, so every pixel only evaluates the
+     * lights of its screen tile and depth slice. Depth is copied over afterwards
+     *
+     * @param lights Lights, Update must have been called this frame
+     * @param clusters Cluster grid built for this frame's view and projection
+     * @param view View matrix
+     * @param projection Projection matrix
+     * @param viewPos Camera position
+     */
+    void LightingPass(const LightManager& lights, const ClusteredLighting& clusters, const glm::mat4& view, const glm::mat4& projection, const glm::vec3& viewPos);
+
+private:
+    int mWidth;
+    int mHeight;
+    unsigned mFBO;
+    unsigned mAlbedoTexture;
+    unsigned mSpecularTexture;
+    unsigned mNormalTexture;
+    unsigned mDepthTexture;
+    // NOTE: Fullscreen triangle is generated from gl_VertexID, core profile still needs a VAO bound
+    unsigned mFullscreenVAO;
+    Shader mGeometryShader;
+    Shader mIndirectGeometryShader;
+    ShaderVariants mLightingVariants;
+
+    void createTargets();
+    void deleteTargets();
+    static unsigned createTarget(GLenum internalFormat, GLenum format, GLenum type, int width, int height);
+};
@@ -0,0 +1,119 @@
+#include "frustum.hpp"
+#include <xmmintrin.h>
+#include <cmath>
+
+Frustum::Frustum() {
+    for (unsigned PlaneIdx = 0; PlaneIdx < 6; ++PlaneIdx) {
+        mPlanes[PlaneIdx] = glm::vec4(0.0f, 0.0f, 0.0f, 1.0f);
+    }
+}
+
+Frustum::Frustum(const glm::mat4& viewProjection) {
+    // NOTE: Gribb-Hartmann, clip space -w <= x, y, z <= w gives row3 +- row0..2
+    glm::vec4 Rows[4];
+    for (unsigned Row = 0; Row < 4; ++Row) {
+        Rows[Row] = glm::vec4(viewProjection[0][Row], viewProjection[1][Row], viewProjection[2][Row], viewProjection[3][Row]);
+    }
+    for (unsigned Axis = 0; Axis < 3; ++Axis) {
+        mPlanes[Axis * 2] = Rows[3] + Rows[Axis];
+        mPlanes[Axis * 2 + 1] = Rows[3] - Rows[Axis];
+    }
+    for (unsigned PlaneIdx = 0; PlaneIdx < 6; ++PlaneIdx) {
+        mPlanes[PlaneIdx] /= glm::length(glm::vec3(mPlanes[PlaneIdx]));
+    }
+}
+
+bool
+Frustum::IntersectsAABB(const AABB& box) const {
+    glm::vec3 Center = box.GetCenter();
+    glm::vec3 Extents = box.GetExtents();
+    for (unsigned PlaneIdx = 0; PlaneIdx < 6; ++PlaneIdx) {
+        const glm::vec4& Plane = mPlanes[PlaneIdx];
+        glm::vec3 Normal(Plane);
+        float Distance = glm::dot(Normal, Center) + Plane.w;
+        float Reach = std::abs(Normal.x) * Extents.x + std::abs(Normal.y) * Extents.y + std::abs(Normal.z) * Extents.z;
+        if (Distance + Reach < 0.0f) {
+            return false;
+        }
+    }
+    return true;
+}
+
+int
+Frustum::ClassifyAABB(const AABB& box) const {
+    glm::vec3 Center = box.GetCenter();
+    glm::vec3 Extents = box.GetExtents();
+    int Side = FRUSTUM_INSIDE;
+    for (unsigned PlaneIdx = 0; PlaneIdx < 6; ++PlaneIdx) {
+        const glm::vec4& Plane = mPlanes[PlaneIdx];
+        glm::vec3 Normal(Plane);
+        float Distance = glm::dot(Normal, Center) + Plane.w;
+        float Reach = std::abs(Normal.x) * Extents.x + std::abs(Normal.y) * Extents.y + std::abs(Normal.z) * Extents.z;
+        if (Distance + Reach < 0.0f) {
+            return FRUSTUM_OUTSIDE;
+        }
+        if (Distance - Reach < 0.0f) {
+            Side = FRUSTUM_INTERSECTS;
+        }
+    }
+    return Side;
+}
+
+bool
+Frustum::IntersectsSphere(const BoundingSphere& sphere) const {
+    for (unsigned PlaneIdx = 0; PlaneIdx < 6; ++PlaneIdx) {
+        if (glm::dot(glm::vec3(mPlanes[PlaneIdx]), sphere.Center) + mPlanes[PlaneIdx].w < -sphere.Radius) {
+            return false;
+        }
+    }
+    return true;
+}
+
+unsigned
+Frustum::CullPacked(const float* const centers[3], const float* const extents[3],
+    const float* const sphereCenters[3], const float* radii, unsigned count, unsigned char* visible) const {
+    __m128 PlaneX[6], PlaneY[6], PlaneZ[6], PlaneW[6];
+    __m128 AbsX[6], AbsY[6], AbsZ[6];
+    for (unsigned PlaneIdx = 0; PlaneIdx < 6; ++PlaneIdx) {
+        PlaneX[PlaneIdx] = _mm_set1_ps(mPlanes[PlaneIdx].x);
+        PlaneY[PlaneIdx] = _mm_set1_ps(mPlanes[PlaneIdx].y);
+        PlaneZ[PlaneIdx] = _mm_set1_ps(mPlanes[PlaneIdx].z);
+        PlaneW[PlaneIdx] = _mm_set1_ps(mPlanes[PlaneIdx].w);
+        AbsX[PlaneIdx] = _mm_set1_ps(std::abs(mPlanes[PlaneIdx].x));
+        AbsY[PlaneIdx] = _mm_set1_ps(std::abs(mPlanes[PlaneIdx].y));
+        AbsZ[PlaneIdx] = _mm_set1_ps(std::abs(mPlanes[PlaneIdx].z));
+    }
+
+    unsigned VisibleCount = 0;
+    for (unsigned Idx = 0; Idx < count; Idx += 4) {
+        __m128 CX = _mm_loadu_ps(centers[0] + Idx);
+        __m128 CY = _mm_loadu_ps(centers[1] + Idx);
+        __m128 CZ = _mm_loadu_ps(centers[2] + Idx);
+        __m128 EX = _mm_loadu_ps(extents[0] + Idx);
+        __m128 EY = _mm_loadu_ps(extents[1] + Idx);
+        __m128 EZ = _mm_loadu_ps(extents[2] + Idx);
+        __m128 SX = _mm_loadu_ps(sphereCenters[0] + Idx);
+        __m128 SY = _mm_loadu_ps(sphereCenters[1] + Idx);
+        __m128 SZ = _mm_loadu_ps(sphereCenters[2] + Idx);
+        __m128 NegRadius = _mm_sub_ps(_mm_setzero_ps(), _mm_loadu_ps(radii + Idx));
+
+        // NOTE: Lanes stay set while box and sphere are on the inner side of every plane so far
+        __m128 Inside = _mm_cmpeq_ps(_mm_setzero_ps(), _mm_setzero_ps());
+        for (unsigned PlaneIdx = 0; PlaneIdx < 6; ++PlaneIdx) {
+            __m128 BoxDistance = _mm_add_ps(_mm_add_ps(_mm_mul_ps(PlaneX[PlaneIdx], CX), _mm_mul_ps(PlaneY[PlaneIdx], CY)),
+                _mm_add_ps(_mm_mul_ps(PlaneZ[PlaneIdx], CZ), PlaneW[PlaneIdx]));
+            __m128 Reach = _mm_add_ps(_mm_add_ps(_mm_mul_ps(AbsX[PlaneIdx], EX), _mm_mul_ps(AbsY[PlaneIdx], EY)), _mm_mul_ps(AbsZ[PlaneIdx], EZ));
+            __m128 SphereDistance = _mm_add_ps(_mm_add_ps(_mm_mul_ps(PlaneX[PlaneIdx], SX), _mm_mul_ps(PlaneY[PlaneIdx], SY)),
+                _mm_add_ps(_mm_mul_ps(PlaneZ[PlaneIdx], SZ), PlaneW[PlaneIdx]));
+            Inside = _mm_and_ps(Inside, _mm_cmpge_ps(_mm_add_ps(BoxDistance, Reach), _mm_setzero_ps()));
+            Inside = _mm_and_ps(Inside, _mm_cmpge_ps(SphereDistance, NegRadius));
+        }
+
+        int Mask = _mm_movemask_ps(Inside);
+        for (unsigned Lane = 0; Lane < 4 && Idx + Lane < count; ++Lane) {
+            visible[Idx + Lane] = (Mask >> Lane) & 1;
+            VisibleCount += visible[Idx + Lane];
+        }
+    }
+    return VisibleCount;
+}
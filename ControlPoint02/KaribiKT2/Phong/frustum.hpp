@@ -0,0 +1,74 @@
+/**
+ * @file frustum.hpp
+ * @brief View frustum planes and visibility tests against them
+ *
+ */
+
+#pragma once
+#include <glm/glm.hpp>
+#include "bounds.hpp"
+
+enum EFrustumSide {
+    FRUSTUM_OUTSIDE,
+    FRUSTUM_INTERSECTS,
+    FRUSTUM_INSIDE
+};
+
+class Frustum {
+public:
+    /**
+     * @brief Ctor - frustum that contains everything
+     *
+     */
+    Frustum();
+
+    /**
+     * @brief Ctor - extracts the six planes from the rows of the matrix
+     *
+     * @param viewProjection Projection * view
+     */
+    Frustum(const glm::mat4& viewProjection);
+
+    /**
+     * @brief Returns false only if the box is fully outside one of the planes
+     *
+     * @param box World space box
+     */
+    bool IntersectsAABB(const AABB& box) const;
+
+    /**
+     * @brief Returns whether the box is outside, crossing or fully inside the frustum
+     *
+     * @param box World space box
+     *
+     * @returns One of EFrustumSide
+     */
+    int ClassifyAABB(const AABB& box) const;
+
+    /**
+     * @brief Returns false only if the sphere is fully outside one of the planes
+     *
+     * @param sphere World space sphere
+     */
+    bool IntersectsSphere(const BoundingSphere& sphere) const;
+
+    /**
+     * @brief Tests boxes packed as structure-of-arrays four at a time with SSE.
+     * An object is culled if either its box or its sphere is outside a plane.
+     * Arrays have to be readable up to count rounded up to a multiple of 4
+     *
+     * @param centers X, Y and Z arrays of box centers
+     * @param extents X, Y and Z arrays of box half sizes
+     * @param sphereCenters X, Y and Z arrays of sphere centers
+     * @param radii Sphere radii
+     * @param count Number of objects
+     * @param visible Output, 1 for objects that may be visible, 0 for culled ones
+     *
+     * @returns Number of visible objects
+     */
+    unsigned CullPacked(const float* const centers[3], const float* const extents[3],
+        const float* const sphereCenters[3], const float* radii, unsigned count, unsigned char* visible) const;
+
+private:
+    glm::vec4 mPlanes[6];
+};
@@ -0,0 +1,29 @@
+/**
+ * @file hash.hpp
+ * @brief String hashing that is stable between runs, for on-disk and source caches
+ *
+ */
+
+#pragma once
+#include <cstdint>
+#include <string>
+
+static const uint64_t FNV_OFFSET_BASIS = 0xCBF29CE484222325ull;
+
+/**
+ * @brief 64-bit FNV-1a. Chain calls by passing the previous result as hash
+ *
+ * @param str Data to hash
+ * @param hash Running hash
+ *
+ * @returns Updated hash
+ */
+inline uint64_t
+HashFNV1a(const std::string& str, uint64_t hash = FNV_OFFSET_BASIS) {
+    for (unsigned char C : str) {
+        hash ^= C;
+        hash *= 0x100000001B3ull;
+    }
+
+    return hash;
+}
@@ -0,0 +1,263 @@
+#include "light_manager.hpp"
+#include "shader_variants.hpp"
+
+// NOTE: Passed by reference to std::min/std::max, which needs a definition
+const unsigned LightManager::MAX_POINT_LIGHTS;
+const unsigned LightManager::MAX_SPOT_LIGHTS;
+
+LightManager::LightManager() {
+    mDirDirection = glm::vec3(0.0f, -1.0f, 0.0f);
+    mDirKa = glm::vec3(0.0f);
+    mDirKd = glm::vec3(0.0f);
+    mDirKs = glm::vec3(0.0f);
+    mDirEnabled = false;
+    for (unsigned LightIdx = 0; LightIdx < std::max(MAX_POINT_LIGHTS, MAX_SPOT_LIGHTS); ++LightIdx) {
+        mAllLights.push_back(LightIdx);
+    }
+}
+
+unsigned
+LightManager::AddPointLight(const glm::vec3& position, const glm::vec3& ka, const glm::vec3& kd, const glm::vec3& ks, const glm::vec3& attenuation) {
+    mPoint.Position.push_back(position);
+    mPoint.Ka.push_back(ka);
+    mPoint.Kd.push_back(kd);
+    mPoint.Ks.push_back(ks);
+    mPoint.Attenuation.push_back(attenuation);
+    mPoint.Enabled.push_back(true);
+    return mPoint.Position.size() - 1;
+}
+
+unsigned
+LightManager::AddSpotLight(const glm::vec3& position, const glm::vec3& direction, const glm::vec3& ka, const glm::vec3& kd, const glm::vec3& ks, const glm::vec3& attenuation, float innerCutOff, float outerCutOff) {
+    mSpot.Position.push_back(position);
+    mSpot.Direction.push_back(direction);
+    mSpot.Ka.push_back(ka);
+    mSpot.Kd.push_back(kd);
+    mSpot.Ks.push_back(ks);
+    mSpot.Attenuation.push_back(attenuation);
+    mSpot.CutOff.push_back(glm::vec2(innerCutOff, outerCutOff));
+    mSpot.Enabled.push_back(true);
+    return mSpot.Position.size() - 1;
+}
+
+void
+LightManager::SetPointPosition(unsigned light, const glm::vec3& position) {
+    mPoint.Position[light] = position;
+}
+
+void
+LightManager::SetPointAttenuation(unsigned light, const glm::vec3& attenuation) {
+    mPoint.Attenuation[light] = attenuation;
+}
+
+void
+LightManager::SetPointEnabled(unsigned light, bool enabled) {
+    mPoint.Enabled[light] = enabled;
+}
+
+void
+LightManager::SetSpotPosition(unsigned light, const glm::vec3& position) {
+    mSpot.Position[light] = position;
+}
+
+void
+LightManager::SetSpotDirection(unsigned light, const glm::vec3& direction) {
+    mSpot.Direction[light] = direction;
+}
+
+void
+LightManager::SetSpotEnabled(unsigned light, bool enabled) {
+    mSpot.Enabled[light] = enabled;
+}
+
+void
+LightManager::SetDirectional(const glm::vec3& direction, const glm::vec3& ka, const glm::vec3& kd, const glm::vec3& ks) {
+    mDirDirection = direction;
+    mDirKa = ka;
+    mDirKd = kd;
+    mDirKs = ks;
+}
+
+void
+LightManager::SetDirectionalEnabled(bool enabled) {
+    mDirEnabled = enabled;
+}
+
+unsigned
+LightManager::GetVariantMask() const {
+    unsigned Mask = mDirEnabled ? LIGHT_DIRECTIONAL : 0;
+    Mask |= mActivePoint.Position.empty() ? 0 : LIGHT_POINT;
+    Mask |= mActiveSpot.Position.empty() ? 0 : LIGHT_SPOT;
+    return Mask;
+}
+
+void
+LightManager::Update() {
+    mActivePoint.Position.clear();
+    mActivePoint.Ka.clear();
+    mActivePoint.Kd.clear();
+    mActivePoint.Ks.clear();
+    mActivePoint.Attenuation.clear();
+    mActivePoint.Radius.clear();
+    for (unsigned LightIdx = 0; LightIdx < mPoint.Position.size(); ++LightIdx) {
+        if (!mPoint.Enabled[LightIdx]) {
+            continue;
+        }
+        mActivePoint.Position.push_back(mPoint.Position[LightIdx]);
+        mActivePoint.Ka.push_back(mPoint.Ka[LightIdx]);
+        mActivePoint.Kd.push_back(mPoint.Kd[LightIdx]);
+        mActivePoint.Ks.push_back(mPoint.Ks[LightIdx]);
+        mActivePoint.Attenuation.push_back(mPoint.Attenuation[LightIdx]);
+        mActivePoint.Radius.push_back(ComputeRadius(mPoint.Attenuation[LightIdx], mPoint.Ka[LightIdx], mPoint.Kd[LightIdx], mPoint.Ks[LightIdx]));
+    }
+
+    mPointBounds.clear();
+    unsigned PointCount = std::min<unsigned>(mActivePoint.Position.size(), MAX_POINT_LIGHTS);
+    for (unsigned LightIdx = 0; LightIdx < PointCount; ++LightIdx) {
+        glm::vec3 Reach(mActivePoint.Radius[LightIdx]);
+        mPointBounds.push_back(AABB(mActivePoint.Position[LightIdx] - Reach, mActivePoint.Position[LightIdx] + Reach));
+    }
+    mPointTree.Build(mPointBounds.data(), mPointBounds.size());
+
+    mActiveSpot.Position.clear();
+    mActiveSpot.Direction.clear();
+    mActiveSpot.Ka.clear();
+    mActiveSpot.Kd.clear();
+    mActiveSpot.Ks.clear();
+    mActiveSpot.Attenuation.clear();
+    mActiveSpot.CutOff.clear();
+    mActiveSpot.Radius.clear();
+    for (unsigned LightIdx = 0; LightIdx < mSpot.Position.size(); ++LightIdx) {
+        if (!mSpot.Enabled[LightIdx]) {
+            continue;
+        }
+        mActiveSpot.Position.push_back(mSpot.Position[LightIdx]);
+        mActiveSpot.Direction.push_back(mSpot.Direction[LightIdx]);
+        mActiveSpot.Ka.push_back(mSpot.Ka[LightIdx]);
+        mActiveSpot.Kd.push_back(mSpot.Kd[LightIdx]);
+        mActiveSpot.Ks.push_back(mSpot.Ks[LightIdx]);
+        mActiveSpot.Attenuation.push_back(mSpot.Attenuation[LightIdx]);
+        mActiveSpot.CutOff.push_back(mSpot.CutOff[LightIdx]);
+        mActiveSpot.Radius.push_back(ComputeRadius(mSpot.Attenuation[LightIdx], mSpot.Ka[LightIdx], mSpot.Kd[LightIdx], mSpot.Ks[LightIdx]));
+    }
+}
+
+const LightManager::PointLights&
+LightManager::GetActivePointLights() const {
+    return mActivePoint;
+}
+
+const LightManager::SpotLights&
+LightManager::GetActiveSpotLights() const {
+    return mActiveSpot;
+}
+
+void
+LightManager::Upload(const Shader& shader) const {
+    // NOTE: A disabled sun is uploaded black so variants with HAS_DIR_LIGHT
+    // compiled in (fallbacks) still light the scene correctly
+    glm::vec3 DirScale(mDirEnabled ? 1.0f : 0.0f);
+    shader.SetUniform3f("uDirLight.Direction", mDirDirection);
+    shader.SetUniform3f("uDirLight.Ka", mDirKa * DirScale);
+    shader.SetUniform3f("uDirLight.Kd", mDirKd * DirScale);
+    shader.SetUniform3f("uDirLight.Ks", mDirKs * DirScale);
+
+    // NOTE: Until UploadForBounds narrows them down, draws loop over every uploaded light
+    unsigned PointCount = std::min<unsigned>(mActivePoint.Position.size(), MAX_POINT_LIGHTS);
+    shader.SetUniform1i("uPointLightCount", PointCount);
+    shader.SetUniform1iv("uPointLightIndices", MAX_POINT_LIGHTS, mAllLights.data());
+    if (PointCount) {
+        shader.SetUniform3fv("uPointLights.Position", PointCount, mActivePoint.Position.data());
+        shader.SetUniform3fv("uPointLights.Ka", PointCount, mActivePoint.Ka.data());
+        shader.SetUniform3fv("uPointLights.Kd", PointCount, mActivePoint.Kd.data());
+        shader.SetUniform3fv("uPointLights.Ks", PointCount, mActivePoint.Ks.data());
+        shader.SetUniform3fv("uPointLights.Attenuation", PointCount, mActivePoint.Attenuation.data());
+    }
+
+    unsigned SpotCount = std::min<unsigned>(mActiveSpot.Position.size(), MAX_SPOT_LIGHTS);
+    shader.SetUniform1i("uSpotLightCount", SpotCount);
+    shader.SetUniform1iv("uSpotLightIndices", MAX_SPOT_LIGHTS, mAllLights.data());
+    if (SpotCount) {
+        shader.SetUniform3fv("uSpotLights.Position", SpotCount, mActiveSpot.Position.data());
+        shader.SetUniform3fv("uSpotLights.Direction", SpotCount, mActiveSpot.Direction.data());
+        shader.SetUniform3fv("uSpotLights.Ka", SpotCount, mActiveSpot.Ka.data());
+        shader.SetUniform3fv("uSpotLights.Kd", SpotCount, mActiveSpot.Kd.data());
+        shader.SetUniform3fv("uSpotLights.Ks", SpotCount, mActiveSpot.Ks.data());
+        shader.SetUniform3fv("uSpotLights.Attenuation", SpotCount, mActiveSpot.Attenuation.data());
+        shader.SetUniform2fv("uSpotLights.CutOff", SpotCount, mActiveSpot.CutOff.data());
+    }
+}
+
+void
+LightManager::UploadForBounds(const Shader& shader, const AABB& bounds) {
+    glm::vec3 Center = bounds.GetCenter();
+    float Radius = glm::length(bounds.GetExtents());
+
+    // NOTE: Light boxes touching the object's bounding sphere are a superset of the lights reaching its box
+    mPointSelection.clear();
+    mPointCandidates.clear();
+    mPointTree.QuerySphere(Center, Radius, mPointCandidates);
+    for (unsigned CandidateIdx = 0; CandidateIdx < mPointCandidates.size(); ++CandidateIdx) {
+        unsigned LightIdx = mPointCandidates[CandidateIdx];
+        if (bounds.IntersectsSphere(mActivePoint.Position[LightIdx], mActivePoint.Radius[LightIdx])) {
+            mPointSelection.push_back(LightIdx);
+        }
+    }
+    std::sort(mPointSelection.begin(), mPointSelection.end());
+
+    mSpotSelection.clear();
+    unsigned SpotCount = std::min<unsigned>(mActiveSpot.Position.size(), MAX_SPOT_LIGHTS);
+    for (unsigned LightIdx = 0; LightIdx < SpotCount; ++LightIdx) {
+        const glm::vec3& Position = mActiveSpot.Position[LightIdx];
+        float Range = mActiveSpot.Radius[LightIdx];
+        if (bounds.IntersectsSphere(Position, Range)
+            && coneIntersectsSphere(Position, glm::normalize(mActiveSpot.Direction[LightIdx]), mActiveSpot.CutOff[LightIdx].y, Range, Center, Radius)) {
+            mSpotSelection.push_back(LightIdx);
+        }
+    }
+
+    shader.SetUniform1i("uPointLightCount", mPointSelection.size());
+    if (!mPointSelection.empty()) {
+        shader.SetUniform1iv("uPointLightIndices", mPointSelection.size(), mPointSelection.data());
+    }
+    shader.SetUniform1i("uSpotLightCount", mSpotSelection.size());
+    if (!mSpotSelection.empty()) {
+        shader.SetUniform1iv("uSpotLightIndices", mSpotSelection.size(), mSpotSelection.data());
+    }
+}
+
+bool
+LightManager::coneIntersectsSphere(const glm::vec3& apex, const glm::vec3& direction, float cosAngle, float range, const glm::vec3& center, float radius) {
+    // NOTE: Distance from the sphere center to the cone surface, measured perpendicular
+    // to the surface in the plane containing the axis and the center
+    glm::vec3 V = center - apex;
+    float AlongAxis = glm::dot(V, direction);
+    float FromAxis = std::sqrt(std::max(glm::dot(V, V) - AlongAxis * AlongAxis, 0.0f));
+    float SinAngle = std::sqrt(std::max(1.0f - cosAngle * cosAngle, 0.0f));
+    float DistanceToCone = cosAngle * FromAxis - AlongAxis * SinAngle;
+    return DistanceToCone <= radius && AlongAxis <= range + radius && AlongAxis >= -radius;
+}
+
+float
+LightManager::ComputeRadius(const glm::vec3& attenuation, const glm::vec3& ka, const glm::vec3& kd, const glm::vec3& ks) {
+    // NOTE: Intensity * 1 / (Kc + Kl * d + Kq * d^2) = Threshold, solved for d
+    const float Threshold = 1.0f / 256.0f;
+    const float MaxRadius = 1e4f;
+    glm::vec3 Sum = ka + kd + ks;
+    float Intensity = std::max(Sum.x, std::max(Sum.y, Sum.z));
+    float C = attenuation.x - Intensity / Threshold;
+    if (C >= 0.0f) {
+        return 0.0f;
+    }
+
+    float Kl = attenuation.y;
+    float Kq = attenuation.z;
+    if (Kq > 1e-6f) {
+        return std::min(MaxRadius, (-Kl + std::sqrt(Kl * Kl - 4.0f * Kq * C)) / (2.0f * Kq));
+    }
+    if (Kl > 1e-6f) {
+        return std::min(MaxRadius, -C / Kl);
+    }
+
+    return MaxRadius;
+}
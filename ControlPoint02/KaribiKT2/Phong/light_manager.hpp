@@ -0,0 +1,223 @@
+/**
+ * @file light_manager.hpp
+ * @brief Scene lights stored as structure-of-arrays and uploaded as uniform arrays
+ *
+ */
+
+#pragma once
+#include <vector>
+#include <cmath>
+#include <algorithm>
+#include <glm/glm.hpp>
+#include "shader.hpp"
+#include "bounds.hpp"
+#include "bvh.hpp"
+
+class LightManager {
+public:
+    // NOTE: Must match the array sizes injected into phong_material_texture.frag.
+    // Only the forward path is limited by these, clustered shading takes any count
+    static const unsigned MAX_POINT_LIGHTS = 32;
+    static const unsigned MAX_SPOT_LIGHTS = 8;
+
+    struct PointLights {
+        std::vector<glm::vec3> Position;
+        std::vector<glm::vec3> Ka;
+        std::vector<glm::vec3> Kd;
+        std::vector<glm::vec3> Ks;
+        std::vector<glm::vec3> Attenuation;
+        std::vector<float> Radius;
+        std::vector<bool> Enabled;
+    };
+
+    struct SpotLights {
+        std::vector<glm::vec3> Position;
+        std::vector<glm::vec3> Direction;
+        std::vector<glm::vec3> Ka;
+        std::vector<glm::vec3> Kd;
+        std::vector<glm::vec3> Ks;
+        std::vector<glm::vec3> Attenuation;
+        std::vector<glm::vec2> CutOff;
+        std::vector<float> Radius;
+        std::vector<bool> Enabled;
+    };
+
+    LightManager();
+
+    /**
+     * @brief Adds a point light
+     *
+     * @param position World space position
+     * @param ka Ambient color
+     * @param kd Diffuse color
+     * @param ks Specular color
+     * @param attenuation Constant, linear and quadratic attenuation terms
+     *
+     * @returns Light handle
+     */
+    unsigned AddPointLight(const glm::vec3& position, const glm::vec3& ka, const glm::vec3& kd, const glm::vec3& ks, const glm::vec3& attenuation);
+
+    /**
+     * @brief Adds a spot light
+     *
+     * @param position World space position
+     * @param direction Direction the cone points to
+     * @param ka Ambient color
+     * @param kd Diffuse color
+     * @param ks Specular color
+     * @param attenuation Constant, linear and quadratic attenuation terms
+     * @param innerCutOff Cosine of the full intensity cone angle
+     * @param outerCutOff Cosine of the falloff cone angle
+     *
+     * @returns Light handle
+     */
+    unsigned AddSpotLight(const glm::vec3& position, const glm::vec3& direction, const glm::vec3& ka, const glm::vec3& kd, const glm::vec3& ks, const glm::vec3& attenuation, float innerCutOff, float outerCutOff);
+
+    /**
+     * @brief Moves a point light
+     *
+     * @param light Point light handle
+     * @param position World space position
+     */
+    void SetPointPosition(unsigned light, const glm::vec3& position);
+
+    /**
+     * @brief Sets point light attenuation. Used for flickering
+     *
+     * @param light Point light handle
+     * @param attenuation Constant, linear and quadratic attenuation terms
+     */
+    void SetPointAttenuation(unsigned light, const glm::vec3& attenuation);
+
+    /**
+     * @brief Turns a point light on or off. Disabled lights are not uploaded
+     *
+     * @param light Point light handle
+     * @param enabled On/Off
+     */
+    void SetPointEnabled(unsigned light, bool enabled);
+
+    /**
+     * @brief Moves a spot light
+     *
+     * @param light Spot light handle
+     * @param position World space position
+     */
+    void SetSpotPosition(unsigned light, const glm::vec3& position);
+
+    /**
+     * @brief Points a spot light in a new direction
+     *
+     * @param light Spot light handle
+     * @param direction Direction the cone points to
+     */
+    void SetSpotDirection(unsigned light, const glm::vec3& direction);
+
+    /**
+     * @brief Turns a spot light on or off. Disabled lights are not uploaded
+     *
+     * @param light Spot light handle
+     * @param enabled On/Off
+     */
+    void SetSpotEnabled(unsigned light, bool enabled);
+
+    /**
+     * @brief Sets the single directional light
+     *
+     * @param direction Direction light travels in
+     * @param ka Ambient color
+     * @param kd Diffuse color
+     * @param ks Specular color
+     */
+    void SetDirectional(const glm::vec3& direction, const glm::vec3& ka, const glm::vec3& kd, const glm::vec3& ks);
+
+    /**
+     * @brief Turns the directional light on or off
+     *
+     * @param enabled On/Off
+     */
+    void SetDirectionalEnabled(bool enabled);
+
+    /**
+     * @brief Returns ELightFeature mask of light types that have at least
+     * one enabled light. Used to pick the shader variant
+     *
+     */
+    unsigned GetVariantMask() const;
+
+    /**
+     * @brief Compacts enabled lights into the active arrays and computes
+     * their radii. Call once per frame after all lights are updated
+     *
+     */
+    void Update();
+
+    /**
+     * @brief Returns enabled point lights as of the last Update
+     *
+     */
+    const PointLights& GetActivePointLights() const;
+
+    /**
+     * @brief Returns enabled spot lights as of the last Update
+     *
+     */
+    const SpotLights& GetActiveSpotLights() const;
+
+    /**
+     * @brief Uploads active lights to the bound shader as uniform arrays.
+     * Disabled lights are compacted out so the shader loops only over lights
+     * that contribute
+     *
+     * @param shader Currently bound shader
+     */
+    void Upload(const Shader& shader) const;
+
+    /**
+     * @brief Narrows the uploaded lights down to those that reach the box and
+     * uploads their indices and counts. Point lights are found through a BVH
+     * of their spheres and tested by radius, spot lights by radius and cone.
+     * Call before each draw, after Upload
+     *
+     * @param shader Currently bound shader
+     * @param bounds World space bounds of the object about to be drawn
+     */
+    void UploadForBounds(const Shader& shader, const AABB& bounds);
+
+    /**
+     * @brief Returns distance at which a light's contribution drops below
+     * 1/256 of full intensity. Lights are ignored past this distance
+     *
+     * @param attenuation Constant, linear and quadratic attenuation terms
+     * @param ka Ambient color
+     * @param kd Diffuse color
+     * @param ks Specular color
+     *
+     * @returns Effective radius
+     */
+    static float ComputeRadius(const glm::vec3& attenuation, const glm::vec3& ka, const glm::vec3& kd, const glm::vec3& ks);
+
+private:
+    PointLights mPoint;
+    SpotLights mSpot;
+    // NOTE: Compacted copies of the enabled lights, reused every frame to avoid allocations
+    PointLights mActivePoint;
+    SpotLights mActiveSpot;
+
+    glm::vec3 mDirDirection;
+    glm::vec3 mDirKa;
+    glm::vec3 mDirKd;
+    glm::vec3 mDirKs;
+    bool mDirEnabled;
+
+    // NOTE: Indices into the uploaded arrays of lights reaching the current object
+    std::vector<int> mAllLights;
+    std::vector<int> mPointSelection;
+    std::vector<int> mSpotSelection;
+    // NOTE: Boxes around the uploaded point lights' spheres, rebuilt by Update
+    BVH mPointTree;
+    std::vector<AABB> mPointBounds;
+    std::vector<unsigned> mPointCandidates;
+
+    static bool coneIntersectsSphere(const glm::vec3& apex, const glm::vec3& direction, float cosAngle, float range, const glm::vec3& center, float radius);
+};
@@ -5,10 +5,26 @@
 #include <glm/glm.hpp>
 #include <glm/gtc/matrix_transform.hpp>
 #include <thread>
+#include <chrono>
 #include "shader.hpp"
 #include "camera.hpp"
-#include "model.hpp"
 #include "texture.hpp"
+#include "shader_variants.hpp"
+#include "light_manager.hpp"
+#include "clustered_lighting.hpp"
+#include "thread_pool.hpp"
+#include "deferred_renderer.hpp"
+#include "transform.hpp"
+#include "transform_array.hpp"
+#include "program_cache.hpp"
+#include "scene.hpp"
+#include "render_queue.hpp"
+#include "bvh.hpp"
+#include "occlusion_culler.hpp"
+#include "software_occlusion.hpp"
+#include "ocean_clipmap.hpp"
+#include "ocean_maps.hpp"
+#include "triple_buffer.hpp"
 
 struct Input
 {
@@ -24,6 +40,13 @@ struct Input
 	bool GoDown;
 };
 
+enum RenderPath
+{
+	RENDER_FORWARD,
+	RENDER_CLUSTERED,
+	RENDER_DEFERRED,
+};
+
 struct EngineState
 {
 	Input* mInput;
@@ -31,6 +54,36 @@ struct EngineState
 	unsigned mShadingMode;
 	bool mDrawDebugLines;
 	double mDT;
+	int mFramebufferWidth;
+	int mFramebufferHeight;
+};
+
+// Everything the render thread needs to draw one frame, written by the main thread.
+// The render thread never sees the main thread's scene transforms or lights directly
+struct FrameSnapshot
+{
+	double Time;
+	glm::vec3 ViewPosition;
+	glm::vec3 ViewDirection;
+	glm::mat4 Projection;
+	glm::mat4 View;
+	int FramebufferWidth;
+	int FramebufferHeight;
+	RenderPath Path;
+	bool IsDay;
+	unsigned VisibleMask;
+	bool StressObjects;
+	bool OcclusionCulling;
+	bool SoftwareOcclusion;
+	bool ClipmapOcean;
+	bool IndirectDraw;
+	bool StaticBatching;
+	bool CommandReuse;
+	bool PrintStats;
+	LightManager Lights;
+	SceneTransforms Transforms;
+	std::vector<glm::mat4> Occluders;
+	double SimulationMs;
 };
 
 static void ErrorCallback(int error, const char* description)
@@ -66,13 +119,32 @@ static void KeyCallback(GLFWwindow* window, int key, int scancode, int action, i
 		}
 	} break;
 
+	case GLFW_KEY_B:
+	{
+		if (action == GLFW_PRESS)
+		{
+			TransformArray::Benchmark();
+		}
+	} break;
+
+	case GLFW_KEY_V:
+	{
+		if (action == GLFW_PRESS)
+		{
+			OceanSimulation::Benchmark();
+		}
+	} break;
+
 	case GLFW_KEY_ESCAPE: glfwSetWindowShouldClose(window, GLFW_TRUE); break;
 	}
 }
 
 static void FramebufferSizeCallback(GLFWwindow* window, int width, int height)
 {
-	glViewport(0, 0, width, height);
+	// The context belongs to the render thread, it sets the viewport from the next snapshot
+	EngineState* State = (EngineState*)glfwGetWindowUserPointer(window);
+	State->mFramebufferWidth = width;
+	State->mFramebufferHeight = height;
 }
 
 static void HandleInput(EngineState* state)
@@ -93,39 +165,143 @@ static void HandleInput(EngineState* state)
 	if (UserInput->GoDown) FPSCamera->UpDown(-1);
 }
 
-static void DrawSea(unsigned vao, const Shader& shader, unsigned diffuse, unsigned specular, double time)
+static unsigned CreateSeaVAO(unsigned cube_vbo, unsigned& instance_count)
 {
-	glUseProgram(shader.GetId());
-	glBindVertexArray(vao);
-	glActiveTexture(GL_TEXTURE0);
-	glBindTexture(GL_TEXTURE_2D, diffuse);
-	glActiveTexture(GL_TEXTURE1);
-	glBindTexture(GL_TEXTURE_2D, specular);
+	// One instance per cube, two layers per grid cell
 	constexpr int sea_size = 10;
+	std::vector<float> cells;
 	for (int i = -sea_size; i < sea_size; ++i)
 	{
 		for (int j = -sea_size; j < sea_size; ++j)
 		{
-			constexpr float size = 4.0f;
-			glm::mat4 model_matrix(1.0f);
+			float wave[] = { static_cast<float>(i), static_cast<float>(j), 1.0f };
+			float steady[] = { static_cast<float>(i), static_cast<float>(j), 0.0f };
+			cells.insert(cells.end(), wave, wave + 3);
+			cells.insert(cells.end(), steady, steady + 3);
+		}
+	}
+	instance_count = cells.size() / 3;
 
-			// Waves
-			model_matrix = glm::translate(model_matrix, glm::vec3(i * size, (abs(sin(time))) - size * 1.6, j * size));
-			model_matrix = glm::rotate(model_matrix, glm::radians(static_cast<float>(time * (45 + i))), glm::vec3(0.11, 0, 2));
-			model_matrix = glm::scale(model_matrix, glm::vec3(size, size, size));
-			shader.SetModel(model_matrix);
-			glDrawArrays(GL_TRIANGLES, 0, 36);
+	unsigned vao;
+	glGenVertexArrays(1, &vao);
+	glBindVertexArray(vao);
+	glBindBuffer(GL_ARRAY_BUFFER, cube_vbo);
+	glVertexAttribPointer(0, 3, GL_FLOAT, GL_FALSE, 8 * sizeof(float), static_cast<void*>(0));
+	glEnableVertexAttribArray(0);
+	glVertexAttribPointer(1, 3, GL_FLOAT, GL_FALSE, 8 * sizeof(float), (void*)(3 * sizeof(float)));
+	glEnableVertexAttribArray(1);
+	glVertexAttribPointer(2, 2, GL_FLOAT, GL_FALSE, 8 * sizeof(float), (void*)(6 * sizeof(float)));
+	glEnableVertexAttribArray(2);
+
+	unsigned instance_vbo;
+	glGenBuffers(1, &instance_vbo);
+	glBindBuffer(GL_ARRAY_BUFFER, instance_vbo);
+	glBufferData(GL_ARRAY_BUFFER, cells.size() * sizeof(float), cells.data(), GL_STATIC_DRAW);
+	glVertexAttribPointer(3, 3, GL_FLOAT, GL_FALSE, 3 * sizeof(float), static_cast<void*>(0));
+	glEnableVertexAttribArray(3);
+	glVertexAttribDivisor(3, 1);
+	glBindBuffer(GL_ARRAY_BUFFER, 0);
+	glBindVertexArray(0);
+	return vao;
+}
+
+static void SubmitSea(RenderQueue& queue, unsigned vao, unsigned instance_count, const Shader& shader, unsigned diffuse, unsigned specular)
+{
+	// Waves are computed in shaders/sea.vert, so the whole sea is one packet whatever its size
+	static const glm::mat4 model_matrix(1.0f);
+	static const glm::mat3 normal_matrix(1.0f);
+	// Rolling cubes reach sqrt(3) * 2 from their centers
+	static const AABB world_bounds(glm::vec3(-44.0f, -10.0f, -44.0f), glm::vec3(40.0f, -1.5f, 40.0f));
+
+	DrawPacket packet = { &shader, vao, 36, 0, diffuse, specular, LAYER_OPAQUE, &model_matrix, &normal_matrix, &world_bounds, 0, instance_count, 0 };
+	queue.Push(packet);
+}
 
-			// Steady sea
-			model_matrix = glm::mat4(1);
-			model_matrix = glm::translate(model_matrix, glm::vec3(i * size, (abs(sin(time))) - size * 1.5, j * size));
-			model_matrix = glm::scale(model_matrix, glm::vec3(size, size, size));
-			shader.SetModel(model_matrix);
-			glDrawArrays(GL_TRIANGLES, 0, 36);
+static void UseForwardShader(const Shader& shader, const glm::mat4& projection, const glm::mat4& view, const glm::vec3& view_pos,
+	const LightManager& lights, const ClusteredLighting* clusters, int width, int height)
+{
+	glUseProgram(shader.GetId());
+	shader.SetProjection(projection);
+	shader.SetView(view);
+	shader.SetUniform3f("uViewPos", view_pos);
+	lights.Upload(shader);
+	if (clusters)
+	{
+		clusters->Bind(shader, width, height);
+	}
+}
+
+static void SubmitStressObjects(RenderQueue& queue, unsigned vao, const Shader& shader, const AABB& cube_bounds, unsigned diffuse)
+{
+	// Static field of rocks around the islands, generated once
+	constexpr int grid_size = 128;
+	constexpr float extent = 200.0f;
+	static std::vector<glm::mat4> model_matrices;
+	static std::vector<glm::mat3> normal_matrices;
+	static std::vector<AABB> world_bounds;
+	static BVH tree;
+	static std::vector<unsigned> visible;
+	if (model_matrices.empty())
+	{
+		TransformArray transforms;
+		for (int i = 0; i < grid_size; ++i)
+		{
+			for (int j = 0; j < grid_size; ++j)
+			{
+				float height = 0.5f + ((i * 31 + j * 17) % 7) * 0.4f;
+				glm::vec3 position(-extent + (i + 0.5f) * 2 * extent / grid_size, -5.0f + height * 0.5f, -extent + (j + 0.5f) * 2 * extent / grid_size);
+				glm::quat rotation = glm::angleAxis(glm::radians(static_cast<float>((i * 53 + j * 29) % 360)), glm::vec3(0, 1, 0));
+				transforms.Add(position, rotation, glm::vec3(1.0f, height, 1.0f));
+			}
+		}
+		model_matrices.resize(transforms.GetCount());
+		normal_matrices.resize(transforms.GetCount());
+		transforms.ComputeMatrices(model_matrices.data());
+		Transform::NormalMatrices(model_matrices.data(), normal_matrices.data(), model_matrices.size());
+		for (unsigned k = 0; k < model_matrices.size(); ++k)
+		{
+			world_bounds.push_back(cube_bounds.Transformed(model_matrices[k]));
+		}
+		tree.Build(world_bounds.data(), world_bounds.size());
+	}
+
+	// Only rocks the hierarchy finds in the frustum are queued
+	visible.clear();
+	tree.QueryFrustum(queue.GetFrustum(), visible);
+	DrawPacket packet = { &shader, vao, 36, 0, diffuse, 0, LAYER_OPAQUE, 0, 0, 0, 0, 1, 0 };
+	for (unsigned k = 0; k < visible.size(); ++k)
+	{
+		packet.ModelMatrix = &model_matrices[visible[k]];
+		packet.NormalMatrix = &normal_matrices[visible[k]];
+		packet.Bounds = &world_bounds[visible[k]];
+		queue.Push(packet);
+	}
+}
+
+static void AddStressLights(LightManager& lights, std::vector<unsigned>& handles)
+{
+	// Grid of small campfires over the whole sea, off until stress mode is toggled on
+	constexpr int grid_size = 32;
+	constexpr float extent = 40.0f;
+	for (int i = 0; i < grid_size; ++i)
+	{
+		for (int j = 0; j < grid_size; ++j)
+		{
+			glm::vec3 position(-extent + (i + 0.5f) * 2 * extent / grid_size, -2.5f, -extent + (j + 0.5f) * 2 * extent / grid_size);
+			glm::vec3 color(1.0f, 0.3f + 0.3f * ((i * 7 + j * 13) % 10) / 10.0f, 0.05f);
+			unsigned handle = lights.AddPointLight(position, glm::vec3(0), color, color, glm::vec3(1.0f, 0.7f, 8.0f));
+			lights.SetPointEnabled(handle, false);
+			handles.push_back(handle);
 		}
 	}
-	glActiveTexture(GL_TEXTURE1);
-	glBindTexture(GL_TEXTURE_2D, 0);
+}
+
+static void SetMaterialDefaults(const Shader& shader)
+{
+	shader.SetUniform1i("uMaterial.Kd", 0);
+	shader.SetUniform1i("uMaterial.Ks", 1);
+	shader.SetUniform1f("uMaterial.Shininess", 64);
+	shader.SetUniform1i("uDrawData", RenderQueue::DRAW_DATA_TEXTURE_UNIT);
 }
 
 int main()
@@ -168,6 +344,7 @@ int main()
 	Input UserInput = { 0 };
 	State.mCamera = &FPSCamera;
 	State.mInput = &UserInput;
+	glfwGetFramebufferSize(Window, &State.mFramebufferWidth, &State.mFramebufferHeight);
 	glfwSetWindowUserPointer(Window, &State);
 
 	glfwSetErrorCallback(ErrorCallback);
@@ -176,20 +353,10 @@ int main()
 
 	glEnable(GL_DEPTH_TEST);
 	glEnable(GL_CULL_FACE);
-
-	Model woman("res/Woman/091_W_Aya_100K.obj");
-	if (!woman.Load())
+	if (GLEW_KHR_parallel_shader_compile)
 	{
-		std::cerr << "Failed to load model\n";
-		glfwTerminate();
-		return -1;
-	}
-	Model shark("res/Shark/SHARK.obj");
-	if (!shark.Load())
-	{
-		std::cerr << "Failed to load model\n";
-		glfwTerminate();
-		return -1;
+		// Let the driver use as many compiler threads as it wants
+		glMaxShaderCompilerThreadsKHR(0xFFFFFFFF);
 	}
 
 	std::vector<float> CubeVertices =
@@ -238,6 +405,7 @@ int main()
 		 0.5f,  0.5f, -0.5f, 0.0f, 0.0f, -1.0f, 0.0f, 1.0f, // L U
 	};
 
+	const AABB CubeBounds(glm::vec3(-0.5f), glm::vec3(0.5f));
 	unsigned CubeVAO;
 	glGenVertexArrays(1, &CubeVAO);
 	glBindVertexArray(CubeVAO);
@@ -254,108 +422,263 @@ int main()
 	glBindBuffer(GL_ARRAY_BUFFER, 0);
 	glBindVertexArray(0);
 
-	Shader PhongShaderMaterialTexture("shaders/basic.vert", "shaders/phong_material_texture.frag");
-	glUseProgram(PhongShaderMaterialTexture.GetId());
-
-	// Default for point light (Sun)
-	PhongShaderMaterialTexture.SetUniform3f("uSunLight.Ka", glm::vec3(1.00, 0.97, 0.00));
-	PhongShaderMaterialTexture.SetUniform3f("uSunLight.Kd", glm::vec3(1.00, 0.97, 0.00));
-	PhongShaderMaterialTexture.SetUniform3f("uSunLight.Ks", glm::vec3(0));
-
-	// Default for point light (Torch 1)
-	PhongShaderMaterialTexture.SetUniform3f("uTorchLight1.Ka", glm::vec3(1.00, 0.44, 0.00));
-	PhongShaderMaterialTexture.SetUniform3f("uTorchLight1.Kd", glm::vec3(1.00, 0.44, 0.00));
-	PhongShaderMaterialTexture.SetUniform3f("uTorchLight1.Ks", glm::vec3(1.00, 0.44, 0.00));
-
-	// Default for point light (Torch 2)
-	PhongShaderMaterialTexture.SetUniform3f("uTorchLight2.Ka", glm::vec3(1.00, 0.44, 0.00));
-	PhongShaderMaterialTexture.SetUniform3f("uTorchLight2.Kd", glm::vec3(1.00, 0.44, 0.00));
-	PhongShaderMaterialTexture.SetUniform3f("uTorchLight2.Ks", glm::vec3(1.00, 0.44, 0.00));
-
-	// Default for point light (Torch 3)
-	PhongShaderMaterialTexture.SetUniform3f("uTorchLight3.Ka", glm::vec3(1.00, 0.44, 0.00));
-	PhongShaderMaterialTexture.SetUniform3f("uTorchLight3.Kd", glm::vec3(1.00, 0.44, 0.00));
-	PhongShaderMaterialTexture.SetUniform3f("uTorchLight3.Ks", glm::vec3(1.00, 0.44, 0.00));
-
-	// Default for point light (Lighthouse top)
-	PhongShaderMaterialTexture.SetUniform3f("uLightHousePointLight.Ka", glm::vec3(1));
-	PhongShaderMaterialTexture.SetUniform3f("uLightHousePointLight.Kd", glm::vec3(1));
-	PhongShaderMaterialTexture.SetUniform3f("uLightHousePointLight.Ks", glm::vec3(1));
-	PhongShaderMaterialTexture.SetUniform1f("uLightHousePointLight.Kc", 1.0f);
-	PhongShaderMaterialTexture.SetUniform1f("uLightHousePointLight.Kl", 0.5f);
-	PhongShaderMaterialTexture.SetUniform1f("uLightHousePointLight.Kq", 0.7f);
-
-	// First light from the Lighthouse 
-	PhongShaderMaterialTexture.SetUniform3f("uLighthouseLight1.Ka", glm::vec3(0));
-	PhongShaderMaterialTexture.SetUniform3f("uLighthouseLight1.Kd", glm::vec3(1));
-	PhongShaderMaterialTexture.SetUniform3f("uLighthouseLight1.Ks", glm::vec3(1.0f));
-	PhongShaderMaterialTexture.SetUniform1f("uLighthouseLight1.Kc", 1.0f);
-	PhongShaderMaterialTexture.SetUniform1f("uLighthouseLight1.Kl", 0.0002f);
-	PhongShaderMaterialTexture.SetUniform1f("uLighthouseLight1.Kq", 0.0002f);
-	PhongShaderMaterialTexture.SetUniform1f("uLighthouseLight1.InnerCutOff", glm::cos(glm::radians(10.0f)));
-	PhongShaderMaterialTexture.SetUniform1f("uLighthouseLight1.OuterCutOff", glm::cos(glm::radians(35.0f)));
-
-	// Second light from the Lighthouse 
-	PhongShaderMaterialTexture.SetUniform3f("uLighthouseLight2.Ka", glm::vec3(0));
-	PhongShaderMaterialTexture.SetUniform3f("uLighthouseLight2.Kd", glm::vec3(1));
-	PhongShaderMaterialTexture.SetUniform3f("uLighthouseLight2.Ks", glm::vec3(1));
-	PhongShaderMaterialTexture.SetUniform1f("uLighthouseLight2.Kc", 1.0f);
-	PhongShaderMaterialTexture.SetUniform1f("uLighthouseLight2.Kl", 0.0002f);
-	PhongShaderMaterialTexture.SetUniform1f("uLighthouseLight2.Kq", 0.0002f);
-	PhongShaderMaterialTexture.SetUniform1f("uLighthouseLight2.InnerCutOff", glm::cos(glm::radians(10.0f)));
-	PhongShaderMaterialTexture.SetUniform1f("uLighthouseLight2.OuterCutOff", glm::cos(glm::radians(35.0f)));
-
-	// Light from the FlashLight 
-	PhongShaderMaterialTexture.SetUniform3f("uFlashLight.Ka", glm::vec3(0));
-	PhongShaderMaterialTexture.SetUniform3f("uFlashLight.Kd", glm::vec3(1));
-	PhongShaderMaterialTexture.SetUniform3f("uFlashLight.Ks", glm::vec3(1));
-	PhongShaderMaterialTexture.SetUniform1f("uFlashLight.Kc", 0.7f);
-	PhongShaderMaterialTexture.SetUniform1f("uFlashLight.Kl", 0.0002f);
-	PhongShaderMaterialTexture.SetUniform1f("uFlashLight.Kq", 0.0002f);
-	PhongShaderMaterialTexture.SetUniform1f("uFlashLight.InnerCutOff", glm::cos(glm::radians(1.0f)));
-	PhongShaderMaterialTexture.SetUniform1f("uFlashLight.OuterCutOff", glm::cos(glm::radians(30.0f)));
-
-	// Materials
-	PhongShaderMaterialTexture.SetUniform1i("uMaterial.Kd", 0);
-	PhongShaderMaterialTexture.SetUniform1i("uMaterial.Ks", 1);
-	PhongShaderMaterialTexture.SetUniform1f("uMaterial.Shininess", 64);
-
-	// Diffuse texture
-	unsigned SunDiffuseTexture = Texture::LoadImageToTexture("res/sun.jpg");
-	unsigned SandDiffuseTexture = Texture::LoadImageToTexture("res/sand.jpg");
-	unsigned RockDiffuseTexture = Texture::LoadImageToTexture("res/rock.jpg");
-	unsigned LighthouseDiffuseTexture = Texture::LoadImageToTexture("res/lighthouse.jpg");
-	unsigned LighthouseLampDiffuseTexture = Texture::LoadImageToTexture("res/lighthouseLamp_d.jpg");
-	unsigned CloudDiffuseTexture = Texture::LoadImageToTexture("res/cloud.jpg");
-	unsigned PalmTreeDiffuseTexture = Texture::LoadImageToTexture("res/palmTree.jpg");
-	unsigned PalmLeafDiffuseTexture = Texture::LoadImageToTexture("res/palmLeaf.jpg");
-	unsigned CampfireDiffuseTexture = Texture::LoadImageToTexture("res/campfire.jpg");
-	unsigned SeaDiffuseTexture = Texture::LoadImageToTexture("res/sea_d.jpg");
+	unsigned SeaInstanceCount;
+	unsigned SeaVAO = CreateSeaVAO(CubeVBO, SeaInstanceCount);
+	// Slab the cube sea always fills. The ocean's troughs have no fixed bottom, so it has none
+	const glm::mat4 SeaOccluder = glm::scale(glm::translate(glm::mat4(1.0f), glm::vec3(-2.0f, -5.5f, -2.0f)), glm::vec3(80.0f, 3.0f, 80.0f));
+
+	Scene World;
+	RenderQueue Queue;
+	OcclusionCuller Occlusion(CubeVAO, CubeVertices.size() / 8);
+	SoftwareOcclusion Rasterizer(256, 256 * WindowHeight / WindowWidth);
+	World.AddBuiltinMesh("cube", CubeVAO, CubeVertices.size() / 8, CubeBounds, CubeVertices.data());
+	if (!World.Load("res/scene.txt"))
+	{
+		std::cerr << "Failed to load scene\n";
+		glfwTerminate();
+		return -1;
+	}
+
+	std::vector<std::string> LightArrayDefines = ClusteredLighting::GetDefines();
+	LightArrayDefines.push_back("MAX_POINT_LIGHTS " + std::to_string(LightManager::MAX_POINT_LIGHTS));
+	LightArrayDefines.push_back("MAX_SPOT_LIGHTS " + std::to_string(LightManager::MAX_SPOT_LIGHTS));
+	ShaderVariants PhongVariants("shaders/basic.vert", "shaders/phong_material_texture.frag", LightArrayDefines, SetMaterialDefaults);
+	// NOTE: Fallbacks can draw any light set and are compiled right away, every other
+	// permutation is only submitted and gets picked up once the driver finishes it
+	const unsigned ForwardFallback = LIGHT_DIRECTIONAL | LIGHT_POINT | LIGHT_SPOT;
+	const unsigned ClusteredFallback = LIGHT_CLUSTERED | LIGHT_DIRECTIONAL;
+	for (unsigned Mask = 0; Mask < LIGHT_CLUSTERED; ++Mask)
+	{
+		PhongVariants.Request(Mask);
+	}
+	PhongVariants.Request(LIGHT_CLUSTERED);
+	PhongVariants.Get(ForwardFallback);
+	PhongVariants.Get(ClusteredFallback);
+	// NOTE: Forward draws upload lights per object, so only the clustered variants read draw data
+	const bool IndirectSupported = RenderQueue::IsIndirectSupported();
+	if (IndirectSupported)
+	{
+		PhongVariants.Request(LIGHT_CLUSTERED | DRAW_INDIRECT);
+		PhongVariants.Get(ClusteredFallback | DRAW_INDIRECT);
+	}
 
-	// Specular texture
+	// NOTE: Sea draws with the same fragment stages, only its vertex stage places the instances
+	ShaderVariants SeaVariants("shaders/sea.vert", "shaders/phong_material_texture.frag", LightArrayDefines, SetMaterialDefaults);
+	for (unsigned Mask = 0; Mask < LIGHT_CLUSTERED; ++Mask)
+	{
+		SeaVariants.Request(Mask);
+	}
+	SeaVariants.Request(LIGHT_CLUSTERED);
+	SeaVariants.Get(ForwardFallback);
+	SeaVariants.Get(ClusteredFallback);
+	Shader SeaGeometryShader("shaders/sea.vert", "shaders/gbuffer.frag");
+	glUseProgram(SeaGeometryShader.GetId());
+	SetMaterialDefaults(SeaGeometryShader);
+	glUseProgram(0);
+
+	// NOTE: Clipmap ocean replaces the cube sea by default, it reaches past the far plane
+	// with the same triangle count wherever the camera is
+	OceanClipmap Ocean(6, 64, 0.25f);
+	// NOTE: Waves are simulated on a 64 x 64 tile, a 256 grid gives a texel per innermost clipmap cell
+	OceanSimulation OceanWaves(256, 64.0f, glm::vec2(8.0f, 3.0f), 0.000007f, 1.0f);
+	OceanMaps OceanTextures(OceanWaves);
+	ShaderVariants::InitCallback SetOceanDefaults = [&OceanTextures](const Shader& shader)
+	{
+		SetMaterialDefaults(shader);
+		OceanTextures.SetDefaults(shader);
+	};
+	ShaderVariants OceanVariants("shaders/ocean.vert", "shaders/phong_material_texture.frag", LightArrayDefines, SetOceanDefaults);
+	for (unsigned Mask = 0; Mask < LIGHT_CLUSTERED; ++Mask)
+	{
+		OceanVariants.Request(Mask);
+	}
+	OceanVariants.Request(LIGHT_CLUSTERED);
+	OceanVariants.Get(ForwardFallback);
+	OceanVariants.Get(ClusteredFallback);
+	Shader OceanGeometryShader("shaders/ocean.vert", "shaders/gbuffer.frag");
+	glUseProgram(OceanGeometryShader.GetId());
+	SetOceanDefaults(OceanGeometryShader);
+	glUseProgram(0);
+
+	ThreadPool Workers;
+	ClusteredLighting Clusters;
+	DeferredRenderer Deferred(State.mFramebufferWidth, State.mFramebufferHeight, LightArrayDefines);
+	ProgramCache::PrintStats();
+
+	LightManager Lights;
+	const glm::vec3 TorchColor(1.00, 0.44, 0.00);
+	unsigned SunLight = Lights.AddPointLight(glm::vec3(0, 25, 0), glm::vec3(1.00, 0.97, 0.00), glm::vec3(1.00, 0.97, 0.00), glm::vec3(0), glm::vec3(1, 0, 0));
+	unsigned TorchLight1 = Lights.AddPointLight(glm::vec3(25.0f, -0.7f, 25.0f), TorchColor, TorchColor, TorchColor, glm::vec3(1, 0, 0));
+	unsigned TorchLight2 = Lights.AddPointLight(glm::vec3(-20.0f, -0.7f, -15.0f), TorchColor, TorchColor, TorchColor, glm::vec3(1, 0, 0));
+	unsigned TorchLight3 = Lights.AddPointLight(glm::vec3(3.5f, -1.4f, 3.5f), TorchColor, TorchColor, TorchColor, glm::vec3(1, 0, 0));
+	glm::vec3 LighthousePosition(-2.0f, 2.5f, -15.0f);
+	unsigned LighthousePointLight = Lights.AddPointLight(LighthousePosition, glm::vec3(1), glm::vec3(1), glm::vec3(1), glm::vec3(1.0f, 0.5f, 0.7f));
+	unsigned LighthouseLight1 = Lights.AddSpotLight(LighthousePosition, glm::vec3(0, -0.3, 1), glm::vec3(0), glm::vec3(1), glm::vec3(1), glm::vec3(1.0f, 0.0002f, 0.0002f), glm::cos(glm::radians(10.0f)), glm::cos(glm::radians(35.0f)));
+	unsigned LighthouseLight2 = Lights.AddSpotLight(LighthousePosition, glm::vec3(0, -0.3, -1), glm::vec3(0), glm::vec3(1), glm::vec3(1), glm::vec3(1.0f, 0.0002f, 0.0002f), glm::cos(glm::radians(10.0f)), glm::cos(glm::radians(35.0f)));
+	unsigned FlashLight = Lights.AddSpotLight(glm::vec3(0), glm::vec3(0, 0, 1), glm::vec3(0), glm::vec3(1), glm::vec3(1), glm::vec3(0.7f, 0.0002f, 0.0002f), glm::cos(glm::radians(1.0f)), glm::cos(glm::radians(30.0f)));
+	Lights.SetDirectional(glm::vec3(0, -0.1, 0), glm::vec3(0.68, 0.70, 0.51), glm::vec3(0.68, 0.70, 0.51), glm::vec3(1.0f));
+	std::vector<unsigned> StressLights;
+	AddStressLights(Lights, StressLights);
+
+	unsigned SeaDiffuseTexture = Texture::LoadImageToTexture("res/sea_d.jpg");
 	unsigned SeaSpecularTexture = Texture::LoadImageToTexture("res/sea_s.jpg");
-	unsigned LighthouseLampSpecularTexture = Texture::LoadImageToTexture("res/lighthouseLamp_s.jpg");
+	unsigned StressDiffuseTexture = Texture::LoadImageToTexture("res/rock.jpg");
 
 	// Start values of variables
-	Shader* CurrentShader = &PhongShaderMaterialTexture;
 	bool clouds_and_lighthouse_light_visibility = true;
 	bool is_day = true;
 	bool flash_light = false;
+	RenderPath render_path = RENDER_FORWARD;
+	bool stress_lights = false;
+	bool stress_objects = false;
+	bool pick_was_down = false;
+	bool occlusion_culling = true;
+	bool software_occlusion = true;
+	bool clipmap_ocean = true;
+	bool indirect_draw = IndirectSupported;
+	bool static_batching = true;
+	bool command_reuse = true;
 	double pi = atan(1) * 4;
 	double start_time;
-	glm::mat4 model_matrix(1.0f);
 	glClearColor(0.53f, 0.81f, 0.98f, 1.0f);
 
+	// From here on the context belongs to the render thread. It draws the latest snapshot
+	// while this thread handles input and simulates the next one
+	TripleBuffer<FrameSnapshot> Frames;
+	glfwMakeContextCurrent(0);
+	std::thread RenderThread([&]()
+	{
+		glfwMakeContextCurrent(Window);
+		// Set from the first snapshot, State is written by the main thread's callbacks
+		int viewport_width = 0;
+		int viewport_height = 0;
+		double render_ms = 0.0;
+		while (Frames.Acquire())
+		{
+			double render_start = glfwGetTime();
+			FrameSnapshot& Frame = Frames.GetReadSlot();
+			const Shader* CurrentShader = 0;
+			const glm::mat4& Projection = Frame.Projection;
+			const glm::mat4& View = Frame.View;
+			LightManager& FrameLights = Frame.Lights;
+			if (Frame.FramebufferWidth != viewport_width || Frame.FramebufferHeight != viewport_height)
+			{
+				viewport_width = Frame.FramebufferWidth;
+				viewport_height = Frame.FramebufferHeight;
+				glViewport(0, 0, viewport_width, viewport_height);
+				Deferred.Resize(viewport_width, viewport_height);
+			}
+
+			// Occluders are rasterized on their own thread while lights and the scene are prepared
+			if (Frame.SoftwareOcclusion)
+			{
+				Rasterizer.Begin(Projection * View, Frame.ViewPosition, Frame.Occluders);
+			}
+
+			// Pick the variant with only the active light types compiled in
+			unsigned LightMask = FrameLights.GetVariantMask();
+			if (Frame.Path != RENDER_FORWARD)
+			{
+				// NOTE: The deferred lighting pass walks the same cluster grid
+				Clusters.Build(FrameLights, View, Projection, Workers);
+				LightMask = (LightMask & LIGHT_DIRECTIONAL) | LIGHT_CLUSTERED;
+			}
+
+			LightManager* CulledLights = Frame.Path == RENDER_FORWARD ? &FrameLights : 0;
+			const Shader* SeaShader = 0;
+			if (Frame.Path == RENDER_DEFERRED)
+			{
+				// Scene below only fills the G-buffer, lighting happens after it
+				SeaShader = Frame.ClipmapOcean ? &OceanGeometryShader : &SeaGeometryShader;
+				glUseProgram(SeaShader->GetId());
+				SeaShader->SetProjection(Projection);
+				SeaShader->SetView(View);
+				SeaShader->SetUniform3f("uViewPos", Frame.ViewPosition);
+				SeaShader->SetUniform1f("uTime", static_cast<float>(Frame.Time));
+				CurrentShader = &Deferred.BeginGeometryPass(Frame.IndirectDraw);
+				CurrentShader->SetProjection(Projection);
+				CurrentShader->SetView(View);
+			}
+			else
+			{
+				unsigned fallback = (LightMask & LIGHT_CLUSTERED) ? ClusteredFallback : ForwardFallback;
+				const ClusteredLighting* clusters = Frame.Path == RENDER_CLUSTERED ? &Clusters : 0;
+				const unsigned indirect_mask = Frame.IndirectDraw && Frame.Path == RENDER_CLUSTERED ? DRAW_INDIRECT : 0;
+				CurrentShader = &PhongVariants.GetReady(LightMask | indirect_mask, fallback | indirect_mask);
+				SeaShader = &(Frame.ClipmapOcean ? OceanVariants : SeaVariants).GetReady(LightMask, fallback);
+				glClear(GL_COLOR_BUFFER_BIT | GL_DEPTH_BUFFER_BIT);
+				UseForwardShader(*SeaShader, Projection, View, Frame.ViewPosition, FrameLights, clusters, viewport_width, viewport_height);
+				SeaShader->SetUniform1f("uTime", static_cast<float>(Frame.Time));
+				UseForwardShader(*CurrentShader, Projection, View, Frame.ViewPosition, FrameLights, clusters, viewport_width, viewport_height);
+			}
+			// Scene transforms come from the queue's draw data and runs of cubes become one multi draw
+			Queue.SetIndirectProgram(Frame.IndirectDraw && Frame.Path != RENDER_FORWARD ? CurrentShader : 0);
+
+			if (Frame.IsDay)
+			{
+				glClearColor(0.53f, 0.81f, 0.98f, 1.0f);
+			}
+			else
+			{
+				glClearColor(0.0f, 0.0f, 0.0f, 1.0f);
+			}
+
+			Queue.Begin(Frame.ViewPosition, Frame.ViewDirection, 100.0f, Projection * View);
+			Occlusion.BeginFrame(View, Projection, Frame.ViewPosition);
+
+			// Sea
+			if (!Frame.ClipmapOcean)
+			{
+				SubmitSea(Queue, SeaVAO, SeaInstanceCount, *SeaShader, SeaDiffuseTexture, SeaSpecularTexture);
+			}
+
+			// Islands, sun, sharks, lighthouse and clouds
+			World.SetStaticBatching(Frame.StaticBatching);
+			World.Submit(Queue, *CurrentShader, Frame.VisibleMask, Frame.Transforms);
+			if (Frame.StressObjects)
+			{
+				SubmitStressObjects(Queue, CubeVAO, *CurrentShader, CubeBounds, StressDiffuseTexture);
+			}
+
+			// Ocean goes first so the queue's occlusion queries are tested against it as well
+			if (Frame.ClipmapOcean)
+			{
+				OceanTextures.Update(static_cast<float>(Frame.Time), Workers);
+				OceanTextures.Bind();
+				glUseProgram(SeaShader->GetId());
+				Ocean.Render(*SeaShader, Frame.ViewPosition, SeaDiffuseTexture, SeaSpecularTexture);
+			}
+
+			// Hidden models are skipped using the queries of the previous frame. Culling, sorting and
+			// command recording are split across the workers, this thread only merges and executes
+			Queue.SetCommandReuse(Frame.CommandReuse);
+			Queue.Submit(CulledLights, Frame.OcclusionCulling ? &Occlusion : 0, Frame.SoftwareOcclusion ? &Rasterizer : 0, &Workers);
+			if (Frame.PrintStats)
+			{
+				std::cout << "Main thread: " << Frame.SimulationMs << " ms simulating, render thread: " << render_ms << " ms last frame" << std::endl;
+				Queue.PrintStats();
+				Occlusion.PrintStats();
+				Rasterizer.PrintStats();
+				std::cout << "Ocean simulation: " << OceanWaves.GetLastSimulationMs() << " ms on " << Workers.GetThreadCount() << " threads" << std::endl;
+			}
+
+			if (Frame.Path == RENDER_DEFERRED)
+			{
+				Deferred.LightingPass(FrameLights, Clusters, View, Projection, Frame.ViewPosition);
+			}
+
+			glBindVertexArray(0);
+			glUseProgram(0);
+			render_ms = (glfwGetTime() - render_start) * 1000.0;
+			glfwSwapBuffers(Window);
+		}
+		glfwMakeContextCurrent(0);
+	});
 
 	while (!glfwWindowShouldClose(Window)) {
 		start_time = glfwGetTime();
 		glfwPollEvents();
 		HandleInput(&State);
-		glClear(GL_COLOR_BUFFER_BIT | GL_DEPTH_BUFFER_BIT);
-		glUseProgram(CurrentShader->GetId());
-		CurrentShader->SetProjection(glm::perspective(90.0f, static_cast<float>(WindowWidth) / static_cast<float>(WindowHeight), 0.1f, 100.0f));
-		CurrentShader->SetView(glm::lookAt(FPSCamera.GetPosition(), FPSCamera.GetTarget(), FPSCamera.GetUp()));
-		CurrentShader->SetUniform3f("uViewPos", FPSCamera.GetPosition());
 
 		if (glfwGetKey(Window, GLFW_KEY_P) == GLFW_PRESS)
 		{
@@ -384,315 +707,198 @@ int main()
 			flash_light = false;
 		}
 
-		if (flash_light)
+		if (glfwGetKey(Window, GLFW_KEY_1) == GLFW_PRESS)
+		{
+			render_path = RENDER_FORWARD;
+		}
+		if (glfwGetKey(Window, GLFW_KEY_2) == GLFW_PRESS)
+		{
+			render_path = RENDER_CLUSTERED;
+		}
+		if (glfwGetKey(Window, GLFW_KEY_3) == GLFW_PRESS)
+		{
+			render_path = RENDER_DEFERRED;
+		}
+
+		if (glfwGetKey(Window, GLFW_KEY_4) == GLFW_PRESS)
+		{
+			indirect_draw = IndirectSupported;
+		}
+		if (glfwGetKey(Window, GLFW_KEY_5) == GLFW_PRESS)
+		{
+			indirect_draw = false;
+		}
+
+		if (glfwGetKey(Window, GLFW_KEY_6) == GLFW_PRESS)
+		{
+			static_batching = true;
+		}
+		if (glfwGetKey(Window, GLFW_KEY_7) == GLFW_PRESS)
 		{
-			glm::vec3 pos = FPSCamera.GetTarget() - FPSCamera.GetPosition();
-			CurrentShader->SetUniform3f("uFlashLight.Position", glm::vec3(FPSCamera.GetPosition()));
-			CurrentShader->SetUniform3f("uFlashLight.Direction", glm::vec3(pos.x, pos.y, pos.z));
+			static_batching = false;
 		}
-		if (!flash_light)
+
+		if (glfwGetKey(Window, GLFW_KEY_8) == GLFW_PRESS)
+		{
+			command_reuse = true;
+		}
+		if (glfwGetKey(Window, GLFW_KEY_9) == GLFW_PRESS)
 		{
-			CurrentShader->SetUniform3f("uFlashLight.Position", glm::vec3(-999));
-			CurrentShader->SetUniform3f("uFlashLight.Direction", glm::vec3(-998));
+			command_reuse = false;
 		}
 
-		if (is_day)
+		if (glfwGetKey(Window, GLFW_KEY_T) == GLFW_PRESS)
+		{
+			stress_lights = true;
+		}
+		if (glfwGetKey(Window, GLFW_KEY_Y) == GLFW_PRESS)
+		{
+			stress_lights = false;
+		}
+		if (glfwGetKey(Window, GLFW_KEY_M) == GLFW_PRESS)
+		{
+			stress_objects = true;
+		}
+		if (glfwGetKey(Window, GLFW_KEY_N) == GLFW_PRESS)
 		{
-			glClearColor(0.53f, 0.81f, 0.98f, 1.0f);
-			CurrentShader->SetUniform3f("uDirLight.Direction", glm::vec3(0, -0.1, 0));
-			CurrentShader->SetUniform3f("uDirLight.Ka", glm::vec3(0.68, 0.70, 0.51));
-			CurrentShader->SetUniform3f("uDirLight.Kd", glm::vec3(0.68, 0.70, 0.51));
-			CurrentShader->SetUniform3f("uDirLight.Ks", glm::vec3(1.0f));
+			stress_objects = false;
+		}
 
-			// Sun
-			glm::vec3 point_light_position_sun(0, 25, 0);
-			CurrentShader->SetUniform1f("uSunLight.Kc", 0.1 / abs(sin(start_time)));
-			CurrentShader->SetUniform1f("uSunLight.Kq", 0.1 / abs(sin(start_time)));
-			CurrentShader->SetUniform3f("uSunLight.Position", point_light_position_sun);
-			model_matrix = glm::mat4(1.0f);
-			model_matrix = glm::translate(model_matrix, point_light_position_sun);
-			model_matrix = glm::scale(model_matrix, glm::vec3(7));
-			CurrentShader->SetModel(model_matrix);
-			glActiveTexture(GL_TEXTURE0);
-			glBindTexture(GL_TEXTURE_2D, SunDiffuseTexture);
-			glBindVertexArray(CubeVAO);
-			glDrawArrays(GL_TRIANGLES, 0, CubeVertices.size() / 8);
+		if (glfwGetKey(Window, GLFW_KEY_U) == GLFW_PRESS)
+		{
+			occlusion_culling = true;
+		}
+		if (glfwGetKey(Window, GLFW_KEY_I) == GLFW_PRESS)
+		{
+			occlusion_culling = false;
 		}
 
-		if (!is_day)
+		if (glfwGetKey(Window, GLFW_KEY_Z) == GLFW_PRESS)
+		{
+			software_occlusion = true;
+		}
+		if (glfwGetKey(Window, GLFW_KEY_X) == GLFW_PRESS)
 		{
-			glClearColor(0.0f, 0.0f, 0.0f, 1.0f);
-			CurrentShader->SetUniform3f("uDirLight.Ka", glm::vec3(is_day));
-			CurrentShader->SetUniform3f("uDirLight.Kd", glm::vec3(is_day));
-			CurrentShader->SetUniform3f("uDirLight.Ks", glm::vec3(is_day));
-			CurrentShader->SetUniform3f("uSunLight.Position", glm::vec3(999));
+			software_occlusion = false;
+		}
 
-			// Sharks
-			int number_of_sharks = 4;
-			for (int i = 0; i < number_of_sharks; i++)
+		if (glfwGetKey(Window, GLFW_KEY_H) == GLFW_PRESS)
+		{
+			clipmap_ocean = true;
+		}
+		if (glfwGetKey(Window, GLFW_KEY_J) == GLFW_PRESS)
+		{
+			clipmap_ocean = false;
+		}
+
+		// Print what the center of the screen points at, once per press
+		bool pick_down = glfwGetKey(Window, GLFW_KEY_E) == GLFW_PRESS;
+		if (pick_down && !pick_was_down)
+		{
+			float distance;
+			glm::vec3 direction = glm::normalize(FPSCamera.GetTarget() - FPSCamera.GetPosition());
+			int entity = World.Pick(FPSCamera.GetPosition(), direction, 100.0f, distance);
+			if (entity >= 0)
+			{
+				std::cout << "Picked entity " << entity << " (" << World.GetMeshName(entity) << ") at " << distance << std::endl;
+			}
+			else
 			{
-				float angle_of_shark = (2 * pi / number_of_sharks) * i;
-				float distance_from_island = 10;
-				model_matrix = glm::mat4(1.0f);
-				model_matrix = glm::translate(model_matrix, glm::vec3(distance_from_island * sin(angle_of_shark + start_time), -4.25f, distance_from_island * cos(angle_of_shark + start_time)));
-				model_matrix = glm::scale(model_matrix, glm::vec3(1.5));
-				model_matrix = glm::rotate(model_matrix, glm::radians(static_cast<float>(start_time) * 100), glm::vec3(0, 1, 0));
-				model_matrix = glm::rotate(model_matrix, glm::radians(-45.0f), glm::vec3(0, 0, 1));
-				CurrentShader->SetModel(model_matrix);
-				shark.Render();
+				std::cout << "Picked nothing" << std::endl;
 			}
 		}
-		// Sea
-		DrawSea(CubeVAO, *CurrentShader, SeaDiffuseTexture, SeaSpecularTexture, start_time);
-
-		// Small island (Far)
-		model_matrix = glm::mat4(1.0f);
-		model_matrix = glm::translate(model_matrix, glm::vec3(25.0f, -2.7f, 25.0f));
-		model_matrix = glm::scale(model_matrix, glm::vec3(4));
-		CurrentShader->SetModel(model_matrix);
-		glActiveTexture(GL_TEXTURE0);
-		glBindTexture(GL_TEXTURE_2D, SandDiffuseTexture);
-		glBindVertexArray(CubeVAO);
-		glDrawArrays(GL_TRIANGLES, 0, CubeVertices.size() / 8);
-
-		// Torch on small island (Far)
-		glm::vec3 PointLightPositionTorch1(25.0f, -0.7, 25.0f);
-		CurrentShader->SetUniform3f("uTorchLight1.Position", PointLightPositionTorch1);
-		CurrentShader->SetUniform1f("uTorchLight1.Kc", 0.1 / abs(sin(start_time * 2)));
-		CurrentShader->SetUniform1f("uTorchLight1.Kl", 0.1 / abs(sin(start_time * 3)));
-		CurrentShader->SetUniform1f("uTorchLight1.Kq", 1.0 / abs(sin(start_time * 5)));
-		model_matrix = glm::mat4(1.0f);
-		model_matrix = glm::translate(model_matrix, PointLightPositionTorch1);
-		model_matrix = glm::scale(model_matrix, glm::vec3(1));
-		CurrentShader->SetModel(model_matrix);
-		glActiveTexture(GL_TEXTURE0);
-		glBindTexture(GL_TEXTURE_2D, CampfireDiffuseTexture);
-		glActiveTexture(GL_TEXTURE1);
-		glDrawArrays(GL_TRIANGLES, 0, CubeVertices.size() / 8);
-
-		// Small island (Near)
-		model_matrix = glm::mat4(1.0f);
-		model_matrix = glm::translate(model_matrix, glm::vec3(-20.0f, -2.7f, -15.0f));
-		model_matrix = glm::scale(model_matrix, glm::vec3(4));
-		CurrentShader->SetModel(model_matrix);
-		glActiveTexture(GL_TEXTURE0);
-		glBindTexture(GL_TEXTURE_2D, SandDiffuseTexture);
-		glActiveTexture(GL_TEXTURE1);
-		glDrawArrays(GL_TRIANGLES, 0, CubeVertices.size() / 8);
-
-		// Torch on small island (Near)
-		glm::vec3 PointLightPositionSunTorch2(-20.0f, -0.7f, -15.0f);
-		CurrentShader->SetUniform3f("uTorchLight2.Position", PointLightPositionSunTorch2);
-		CurrentShader->SetUniform1f("uTorchLight2.Kc", 0.1 / abs(sin(start_time * 2)));
-		CurrentShader->SetUniform1f("uTorchLight2.Kl", 0.091 / abs(sin(start_time * 3)));
-		CurrentShader->SetUniform1f("uTorchLight2.Kq", 0.1 / abs(sin(start_time * 5)));
-		model_matrix = glm::mat4(1.0f);
-		model_matrix = glm::translate(model_matrix, PointLightPositionSunTorch2);
-		model_matrix = glm::scale(model_matrix, glm::vec3(1));
-		CurrentShader->SetModel(model_matrix);
-		glActiveTexture(GL_TEXTURE0);
-		glBindTexture(GL_TEXTURE_2D, CampfireDiffuseTexture);
-		glBindVertexArray(CubeVAO);
-		glDrawArrays(GL_TRIANGLES, 0, CubeVertices.size() / 8);
-
-		// Big island
-		model_matrix = glm::mat4(1.0f);
-		model_matrix = glm::translate(model_matrix, glm::vec3(0.0f, -3.0f, 0.0f));
-		model_matrix = glm::scale(model_matrix, glm::vec3(10, 3, 10));
-		CurrentShader->SetModel(model_matrix);
-		glActiveTexture(GL_TEXTURE0);
-		glBindTexture(GL_TEXTURE_2D, SandDiffuseTexture);
-		glBindVertexArray(CubeVAO);
-		glDrawArrays(GL_TRIANGLES, 0, CubeVertices.size() / 8);
-
-		// Torch on big island
-		glm::vec3 PointLightPositionSunTorch3(3.5f, -1.4f, 3.5f);
-		CurrentShader->SetUniform3f("uTorchLight3.Position", PointLightPositionSunTorch3);
-		CurrentShader->SetUniform1f("uTorchLight3.Kc", 1 / abs(sin(start_time * 2)));
-		CurrentShader->SetUniform1f("uTorchLight3.Kl", 0.1 / abs(sin(start_time * 3)));
-		CurrentShader->SetUniform1f("uTorchLight3.Kq", 0.1 / abs(sin(start_time * 5)));
-		model_matrix = glm::mat4(1.0f);
-		model_matrix = glm::translate(model_matrix, PointLightPositionSunTorch3);
-		model_matrix = glm::scale(model_matrix, glm::vec3(1));
-		CurrentShader->SetModel(model_matrix);
-		glActiveTexture(GL_TEXTURE0);
-		glBindTexture(GL_TEXTURE_2D, CampfireDiffuseTexture);
-		glBindVertexArray(CubeVAO);
-		glDrawArrays(GL_TRIANGLES, 0, CubeVertices.size() / 8);
-
-		// Model on island (Woman)
-		model_matrix = glm::mat4(1.0f);
-		model_matrix = glm::translate(model_matrix, glm::vec3(-4.5f, -2.25f, -4.5f));
-		model_matrix = glm::scale(model_matrix, glm::vec3(0.002));
-		model_matrix = glm::rotate(model_matrix, glm::radians(155.0f), glm::vec3(0, 1, 0));
-		CurrentShader->SetModel(model_matrix);
-		woman.Render();
-
-		// Palm tree
-		model_matrix = glm::mat4(1.0f);
-		model_matrix = glm::translate(model_matrix, glm::vec3(0.0f, 1.5f, 0.0f));
-		model_matrix = glm::scale(model_matrix, glm::vec3(1, 10, 1));
-		CurrentShader->SetModel(model_matrix);
-		glActiveTexture(GL_TEXTURE0);
-		glBindTexture(GL_TEXTURE_2D, PalmTreeDiffuseTexture);
-		glBindVertexArray(CubeVAO);
-		glDrawArrays(GL_TRIANGLES, 0, CubeVertices.size() / 8);
-
-		// Palm tree top leaf
-		model_matrix = glm::mat4(1.0f);
-		model_matrix = glm::translate(model_matrix, glm::vec3(0.0f, 6.0f, 0.0f));
-		model_matrix = glm::scale(model_matrix, glm::vec3(2));
-		model_matrix = glm::rotate(model_matrix, glm::radians(45.0f), glm::vec3(0, 1, 0));
-		CurrentShader->SetModel(model_matrix);
-		glActiveTexture(GL_TEXTURE0);
-		glBindTexture(GL_TEXTURE_2D, PalmLeafDiffuseTexture);
-		glBindVertexArray(CubeVAO);
-		glDrawArrays(GL_TRIANGLES, 0, CubeVertices.size() / 8);
-
-		// Palm tree leaf 1
-		model_matrix = glm::mat4(1.0f);
-		model_matrix = glm::translate(model_matrix, glm::vec3(1.5f, 4.75f, -1.5f));
-		model_matrix = glm::rotate(model_matrix, glm::radians(45.0f), glm::vec3(0, 1, 0));
-		model_matrix = glm::rotate(model_matrix, glm::radians(45.0f), glm::vec3(0, 0, 1));
-		model_matrix = glm::scale(model_matrix, glm::vec3(0.1, 6, 1.75));
-		CurrentShader->SetModel(model_matrix);
-		glActiveTexture(GL_TEXTURE0);
-		glBindTexture(GL_TEXTURE_2D, PalmLeafDiffuseTexture);
-		glBindVertexArray(CubeVAO);
-		glDrawArrays(GL_TRIANGLES, 0, CubeVertices.size() / 8);
-
-		// Palm tree leaf 2
-		model_matrix = glm::mat4(1.0f);
-		model_matrix = glm::translate(model_matrix, glm::vec3(-1.0f, 4.75f, -1.0));
-		model_matrix = glm::rotate(model_matrix, glm::radians(135.0f), glm::vec3(0, 1, 0));
-		model_matrix = glm::rotate(model_matrix, glm::radians(45.0f), glm::vec3(0, 0, 1));
-		model_matrix = glm::scale(model_matrix, glm::vec3(0.1, 6, 1.75));
-		CurrentShader->SetModel(model_matrix);
-		glActiveTexture(GL_TEXTURE0);
-		glBindTexture(GL_TEXTURE_2D, PalmLeafDiffuseTexture);
-		glBindVertexArray(CubeVAO);
-		glDrawArrays(GL_TRIANGLES, 0, CubeVertices.size() / 8);
-
-		// Palm tree leaf 3
-		model_matrix = glm::mat4(1.0f);
-		model_matrix = glm::translate(model_matrix, glm::vec3(1.75f, 4.75f, 1.75));
-		model_matrix = glm::rotate(model_matrix, glm::radians(-45.0f), glm::vec3(0, 1, 0));
-		model_matrix = glm::rotate(model_matrix, glm::radians(45.0f), glm::vec3(0, 0, 1));
-		model_matrix = glm::scale(model_matrix, glm::vec3(0.1, 6, 1.75));
-		CurrentShader->SetModel(model_matrix);
-		glActiveTexture(GL_TEXTURE0);
-		glBindTexture(GL_TEXTURE_2D, PalmLeafDiffuseTexture);
-		glBindVertexArray(CubeVAO);
-		glDrawArrays(GL_TRIANGLES, 0, CubeVertices.size() / 8);
-
-		// Island for lighthouse 
-		model_matrix = glm::mat4(1.0f);
-		model_matrix = glm::translate(model_matrix, glm::vec3(-2.0f, -2.55f, -15.0f));
-		model_matrix = glm::scale(model_matrix, glm::vec3(3.25));
-		CurrentShader->SetModel(model_matrix);
-		glActiveTexture(GL_TEXTURE0);
-		glBindTexture(GL_TEXTURE_2D, RockDiffuseTexture);
-		glBindVertexArray(CubeVAO);
-		glDrawArrays(GL_TRIANGLES, 0, CubeVertices.size() / 8);
-
-		// Lighthouse Top
-		model_matrix = glm::mat4(1.0f);
-		model_matrix = glm::translate(model_matrix, glm::vec3(-2.0f, 1.5f, -15.0f));
-		model_matrix = glm::scale(model_matrix, glm::vec3(1, 1, 1));
-		CurrentShader->SetModel(model_matrix);
-		glActiveTexture(GL_TEXTURE0);
-		glBindTexture(GL_TEXTURE_2D, LighthouseDiffuseTexture);
-		glBindVertexArray(CubeVAO);
-		glDrawArrays(GL_TRIANGLES, 0, CubeVertices.size() / 8);
-
-		// Lighthouse Middle
-		model_matrix = glm::mat4(1.0f);
-		model_matrix = glm::translate(model_matrix, glm::vec3(-2.0f, 0.5f, -15.0f));
-		model_matrix = glm::scale(model_matrix, glm::vec3(1.0));
-		CurrentShader->SetModel(model_matrix);
-		glActiveTexture(GL_TEXTURE0);
-		glBindTexture(GL_TEXTURE_2D, LighthouseDiffuseTexture);
-		glBindVertexArray(CubeVAO);
-		glDrawArrays(GL_TRIANGLES, 0, CubeVertices.size() / 8);
-
-		// Lighthouse Bottom
-		model_matrix = glm::mat4(1.0f);
-		model_matrix = glm::translate(model_matrix, glm::vec3(-2.0f, -0.5f, -15.0f));
-		model_matrix = glm::scale(model_matrix, glm::vec3(1, 1, 1));
-		CurrentShader->SetModel(model_matrix);
-		glActiveTexture(GL_TEXTURE0);
-		glBindTexture(GL_TEXTURE_2D, LighthouseDiffuseTexture);
-		glBindVertexArray(CubeVAO);
-		glDrawArrays(GL_TRIANGLES, 0, CubeVertices.size() / 8);
-
-		// Lighthouse Lamp
-		glm::vec3 LighthousePosition(-2.0f, 2.5f, -15.0f);
-		model_matrix = glm::mat4(1.0f);
-		model_matrix = glm::translate(model_matrix, LighthousePosition);
-		model_matrix = glm::scale(model_matrix, glm::vec3(1.42));
-		double speed_of_rotation = 250;
-		model_matrix = glm::rotate(model_matrix, glm::radians(static_cast<float>(start_time * speed_of_rotation)), glm::vec3(0, 1, 0));
-		CurrentShader->SetModel(model_matrix);
-		glActiveTexture(GL_TEXTURE0);
-		glBindTexture(GL_TEXTURE_2D, LighthouseLampDiffuseTexture);
-		glActiveTexture(GL_TEXTURE1);
-		glBindTexture(GL_TEXTURE_2D, LighthouseLampSpecularTexture);
-		glBindVertexArray(CubeVAO);
-		glDrawArrays(GL_TRIANGLES, 0, CubeVertices.size() / 8);
-		glActiveTexture(GL_TEXTURE1);
-		glBindTexture(GL_TEXTURE_2D, 0);
+		pick_was_down = pick_down;
 
-		if (clouds_and_lighthouse_light_visibility)
+		// NOTE: The forward path only has room for MAX_POINT_LIGHTS, stress mode needs clusters
+		if (stress_lights && render_path == RENDER_FORWARD)
+		{
+			render_path = RENDER_CLUSTERED;
+		}
+
+		// Lights
+		Lights.SetDirectionalEnabled(is_day);
+		Lights.SetPointEnabled(SunLight, is_day);
+		Lights.SetPointAttenuation(SunLight, glm::vec3(0.1 / abs(sin(start_time)), 0.0f, 0.1 / abs(sin(start_time))));
+
+		Lights.SetPointAttenuation(TorchLight1, glm::vec3(0.1 / abs(sin(start_time * 2)), 0.1 / abs(sin(start_time * 3)), 1.0 / abs(sin(start_time * 5))));
+		Lights.SetPointAttenuation(TorchLight2, glm::vec3(0.1 / abs(sin(start_time * 2)), 0.091 / abs(sin(start_time * 3)), 0.1 / abs(sin(start_time * 5))));
+		Lights.SetPointAttenuation(TorchLight3, glm::vec3(1 / abs(sin(start_time * 2)), 0.1 / abs(sin(start_time * 3)), 0.1 / abs(sin(start_time * 5))));
+
+		double speed_of_rotation = 250;
+		bool lighthouse_lights = !clouds_and_lighthouse_light_visibility;
+		Lights.SetPointEnabled(LighthousePointLight, lighthouse_lights);
+		Lights.SetSpotEnabled(LighthouseLight1, lighthouse_lights);
+		Lights.SetSpotEnabled(LighthouseLight2, lighthouse_lights);
+		if (lighthouse_lights)
 		{
-			// Removing lighthouse lights
-			CurrentShader->SetUniform3f("uLighthouseLight1.Position", glm::vec3(-10));
-			CurrentShader->SetUniform3f("uLighthouseLight1.Direction", glm::vec3(-20));
-			CurrentShader->SetUniform3f("uLighthouseLight2.Position", glm::vec3(-10));
-			CurrentShader->SetUniform3f("uLighthouseLight2.Direction", glm::vec3(-20));
-			CurrentShader->SetUniform3f("uLightHousePointLight.Position", glm::vec3(-20));
-
-			// Fixed size cloud
-			model_matrix = glm::mat4(1.0f);
-			model_matrix = glm::translate(model_matrix, glm::vec3(-7.0f, 5.0f, -20.0f));
-			model_matrix = glm::rotate(model_matrix, glm::radians(static_cast<float>(start_time) * 15), glm::vec3(0.5, 1, 1));
-			model_matrix = glm::scale(model_matrix, glm::vec3(3, 1, 1));
-			CurrentShader->SetModel(model_matrix);
-			glActiveTexture(GL_TEXTURE0);
-			glBindTexture(GL_TEXTURE_2D, CloudDiffuseTexture);
-			glBindVertexArray(CubeVAO);
-			glDrawArrays(GL_TRIANGLES, 0, CubeVertices.size() / 8);
-
-			// Changing size cloud
-			model_matrix = glm::mat4(1.0f);
-			model_matrix = glm::translate(model_matrix, glm::vec3(7.1f, 5.2f, -21.0f));
-			model_matrix = glm::rotate(model_matrix, glm::radians(static_cast<float>(start_time) * 15), glm::vec3(0.5, 1, 1));
-			model_matrix = glm::scale(model_matrix, glm::vec3(abs(sin(start_time)) * 2 + 2, abs(sin(start_time * 2)) * 2 + 2, abs(sin(start_time)) + 2));
-			model_matrix = glm::rotate(model_matrix, glm::radians(static_cast<float>(start_time) * 15), glm::vec3(0.5, 1, 1));
-			CurrentShader->SetModel(model_matrix);
-			glActiveTexture(GL_TEXTURE0);
-			glBindTexture(GL_TEXTURE_2D, CloudDiffuseTexture);
-			glBindVertexArray(CubeVAO);
-			glDrawArrays(GL_TRIANGLES, 0, CubeVertices.size() / 8);
-		}
-		else
-		{
-			// Add lighthouse lights
 			double light_house_light_rotation_speed = (pi / 180.0) * speed_of_rotation;
-			CurrentShader->SetUniform3f("uLightHousePointLight.Position", LighthousePosition);
+			Lights.SetSpotDirection(LighthouseLight1, glm::vec3(sin(start_time * light_house_light_rotation_speed), -0.3, cos(start_time * light_house_light_rotation_speed)));
+			Lights.SetSpotDirection(LighthouseLight2, glm::vec3(sin(start_time * light_house_light_rotation_speed + pi), -0.3, cos(start_time * light_house_light_rotation_speed + pi)));
+		}
 
-			CurrentShader->SetUniform3f("uLighthouseLight1.Position", LighthousePosition);
-			CurrentShader->SetUniform3f("uLighthouseLight1.Direction", glm::vec3(sin(start_time * light_house_light_rotation_speed), -0.3, cos(start_time * light_house_light_rotation_speed)));
+		Lights.SetSpotEnabled(FlashLight, flash_light);
+		if (flash_light)
+		{
+			Lights.SetSpotPosition(FlashLight, FPSCamera.GetPosition());
+			Lights.SetSpotDirection(FlashLight, FPSCamera.GetTarget() - FPSCamera.GetPosition());
+		}
 
-			CurrentShader->SetUniform3f("uLighthouseLight2.Position", LighthousePosition);
-			CurrentShader->SetUniform3f("uLighthouseLight2.Direction", glm::vec3(sin(start_time * light_house_light_rotation_speed + pi), -0.3, cos(start_time * light_house_light_rotation_speed + pi)));
+		for (unsigned i = 0; i < StressLights.size(); ++i)
+		{
+			Lights.SetPointEnabled(StressLights[i], stress_lights);
+			if (stress_lights)
+			{
+				Lights.SetPointAttenuation(StressLights[i], glm::vec3(1.0f + 0.5f * abs(sin(start_time * (3 + i % 5) + i)), 0.7f, 8.0f));
+			}
+		}
+		Lights.Update();
+
+		World.Update(start_time);
+
+		// Hand this frame's state to the render thread
+		FrameSnapshot& frame = Frames.GetWriteSlot();
+		frame.Time = start_time;
+		frame.ViewPosition = FPSCamera.GetPosition();
+		frame.ViewDirection = FPSCamera.GetTarget() - FPSCamera.GetPosition();
+		frame.Projection = glm::perspective(90.0f, static_cast<float>(WindowWidth) / static_cast<float>(WindowHeight), 0.1f, 100.0f);
+		frame.View = glm::lookAt(FPSCamera.GetPosition(), FPSCamera.GetTarget(), FPSCamera.GetUp());
+		frame.FramebufferWidth = State.mFramebufferWidth;
+		frame.FramebufferHeight = State.mFramebufferHeight;
+		frame.Path = render_path;
+		frame.IsDay = is_day;
+		frame.VisibleMask = is_day ? VISIBLE_DAY : VISIBLE_NIGHT;
+		if (clouds_and_lighthouse_light_visibility)
+		{
+			frame.VisibleMask |= VISIBLE_CLOUDS;
+		}
+		frame.StressObjects = stress_objects;
+		frame.OcclusionCulling = occlusion_culling;
+		frame.SoftwareOcclusion = software_occlusion;
+		frame.ClipmapOcean = clipmap_ocean;
+		frame.IndirectDraw = indirect_draw;
+		frame.StaticBatching = static_batching;
+		frame.CommandReuse = command_reuse;
+		frame.PrintStats = glfwGetKey(Window, GLFW_KEY_R) == GLFW_PRESS;
+		frame.Lights = Lights;
+		World.Capture(frame.Transforms);
+		if (software_occlusion)
+		{
+			World.GetOccluders(frame.Occluders);
+			if (!clipmap_ocean)
+			{
+				frame.Occluders.push_back(SeaOccluder);
+			}
 		}
+		frame.SimulationMs = (glfwGetTime() - start_time) * 1000.0;
+		Frames.Publish();
 
-		glBindVertexArray(0);
-		glUseProgram(0);
-		glfwSwapBuffers(Window);
+		// Stays a frame ahead of the render thread, but keeps polling input when a frame takes long
+		Frames.WaitForTake(std::chrono::milliseconds(8));
 		State.mDT = glfwGetTime() - start_time;
 	}
 
+	Frames.Close();
+	RenderThread.join();
 	glfwTerminate();
 	return 0;
 }
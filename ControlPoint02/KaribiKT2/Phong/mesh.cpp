@@ -1,4 +1,5 @@
 #include "mesh.hpp"
+#include <algorithm>
 
 Mesh::Mesh(const aiMesh* mesh, const aiMaterial* material, const std::string &resPath) {
     processMesh(mesh, material, resPath);
@@ -29,6 +30,16 @@ Mesh::Render() const {
     glBindVertexArray(0);
 }
 
+const AABB&
+Mesh::GetBounds() const {
+    return mBounds;
+}
+
+const BoundingSphere&
+Mesh::GetBoundingSphere() const {
+    return mSphere;
+}
+
 unsigned
 Mesh::loadMeshTexture(const aiMaterial* material, const std::string& resPath, aiTextureType type) {
     if (material && material->GetTextureCount(type) > 0) {
@@ -50,6 +61,7 @@ Mesh::processMesh(const aiMesh* mesh, const aiMaterial* material, const std::str
     for (unsigned VertexIndex = 0; VertexIndex < mesh->mNumVertices; ++VertexIndex) {
         std::vector<float> Position = { mesh->mVertices[VertexIndex].x, mesh->mVertices[VertexIndex].y, mesh->mVertices[VertexIndex].z };
         mVertices.insert(mVertices.end(), Position.begin(), Position.end());
+        mBounds.Extend(glm::vec3(Position[0], Position[1], Position[2]));
         std::vector<float> Normals = { mesh->mNormals[VertexIndex].x, mesh->mNormals[VertexIndex].y, mesh->mNormals[VertexIndex].z };
         mVertices.insert(mVertices.end(), Normals.begin(), Normals.end());
         const aiVector3D* TexCoords = mesh->HasTextureCoords(0) ? &(mesh->mTextureCoords[0][VertexIndex]) : &Zero3D;
@@ -64,6 +76,13 @@ Mesh::processMesh(const aiMesh* mesh, const aiMaterial* material, const std::str
         mIndices.push_back(Face.mIndices[2]);
     }
 
+    // NOTE: Centering on the box keeps the sphere within sqrt(3) of optimal with one extra pass
+    mSphere.Center = mBounds.GetCenter();
+    for (unsigned VertexIndex = 0; VertexIndex < mesh->mNumVertices; ++VertexIndex) {
+        glm::vec3 Position(mesh->mVertices[VertexIndex].x, mesh->mVertices[VertexIndex].y, mesh->mVertices[VertexIndex].z);
+        mSphere.Radius = std::max(mSphere.Radius, glm::length(Position - mSphere.Center));
+    }
+
     mVertexCount = mVertices.size() / 6;
     mIndexCount = mIndices.size();
 
@@ -16,6 +16,7 @@
 #include <GL/glew.h>
 #include <iostream>
 #include "texture.hpp"
+#include "bounds.hpp"
 
 class Mesh {
 public:
@@ -38,6 +39,18 @@ public:
      */
     void Render() const;
 
+    /**
+     * @brief Returns object space bounds of the mesh vertices
+     *
+     */
+    const AABB& GetBounds() const;
+
+    /**
+     * @brief Returns object space sphere around the mesh vertices, centered on the box
+     *
+     */
+    const BoundingSphere& GetBoundingSphere() const;
+
 private:
     unsigned mVAO;
     unsigned mVBO;
@@ -46,6 +59,8 @@ private:
     unsigned mIndexCount;
     unsigned mDiffuseTexture;
     unsigned mSpecularTexture;
+    AABB mBounds;
+    BoundingSphere mSphere;
     unsigned loadMeshTexture(const aiMaterial* material, const std::string& resPath, aiTextureType type);
     void processMesh(const aiMesh* mesh, const aiMaterial* material, const std::string& resPath);
 };
@@ -19,8 +19,14 @@ Model::Load() {
         aiMesh* CurrAIMesh = Scene->mMeshes[MeshIdx];
         Mesh CurrMesh(CurrAIMesh, Scene->mMaterials[CurrAIMesh->mMaterialIndex], mDirectory);
         mMeshes.push_back(CurrMesh);
+        mBounds.Extend(CurrMesh.GetBounds());
 
     }
+    mSphere.Center = mBounds.GetCenter();
+    for (unsigned MeshIdx = 0; MeshIdx < mMeshes.size(); ++MeshIdx) {
+        const BoundingSphere& MeshSphere = mMeshes[MeshIdx].GetBoundingSphere();
+        mSphere.Radius = std::max(mSphere.Radius, glm::length(MeshSphere.Center - mSphere.Center) + MeshSphere.Radius);
+    }
     std::cout << mFilename << " Loaded " << mMeshes.size() << " meshes" << std::endl;
     return true;
 }
@@ -32,3 +38,13 @@ Model::Render() {
         mMeshes[MeshIdx].Render();
     }
 }
+
+const AABB&
+Model::GetBounds() const {
+    return mBounds;
+}
+
+const BoundingSphere&
+Model::GetBoundingSphere() const {
+    return mSphere;
+}
@@ -41,6 +41,8 @@ enum EBufferType {
 class Model {
 private:
     std::vector<Mesh> mMeshes;
+    AABB mBounds;
+    BoundingSphere mSphere;
 
 public:
     std::string mFilename;
@@ -67,7 +69,19 @@ public:
      */
     void Render();
 
+    /**
+     * @brief Returns object space bounds of all meshes
+     *
+     */
+    const AABB& GetBounds() const;
+
+    /**
+     * @brief Returns object space sphere around all meshes
+     *
+     */
+    const BoundingSphere& GetBoundingSphere() const;
+
 };
 
-#define MESH_HP
+#define MESH_H
 #endif
@@ -0,0 +1,129 @@
+#include "occlusion_culler.hpp"
+#include <glm/gtc/matrix_transform.hpp>
+
+// NOTE: Proxies are grown a little so they are never hidden by the surface of the object they bound
+static const float ProxyPadding = 0.05f;
+// NOTE: More than the near plane, so a box the camera is in or next to is never clipped away
+static const float CameraMargin = 0.5f;
+
+OcclusionCuller::OcclusionCuller(unsigned boxVAO, unsigned boxVertexCount)
+    : mProxyShader("shaders/basic.vert", "shaders/occlusion_proxy.frag") {
+    mBoxVAO = boxVAO;
+    mBoxVertexCount = boxVertexCount;
+    mFrame = 0;
+    mLastTestedCount = 0;
+    mLastOccludedCount = 0;
+    mFramesWithSavings = 0;
+    mTotalDrawsSaved = 0;
+}
+
+void
+OcclusionCuller::BeginFrame(const glm::mat4& view, const glm::mat4& projection, const glm::vec3& viewPosition) {
+    mView = view;
+    mProjection = projection;
+    mViewPosition = viewPosition;
+
+    // NOTE: Only read back for statistics, conditional rendering does not need the CPU to see the result
+    mLastTestedCount = 0;
+    mLastOccludedCount = 0;
+    for (unsigned QueryIdx = 0; QueryIdx < mQueries.size(); ++QueryIdx) {
+        Query& Current = mQueries[QueryIdx];
+        if (Current.IssuedFrame != mFrame) {
+            continue;
+        }
+        ++mLastTestedCount;
+        GLuint Available = 0;
+        glGetQueryObjectuiv(Current.Id, GL_QUERY_RESULT_AVAILABLE, &Available);
+        if (Available) {
+            GLuint AnySamples = 1;
+            glGetQueryObjectuiv(Current.Id, GL_QUERY_RESULT, &AnySamples);
+            Current.Visible = AnySamples != 0;
+        }
+        mLastOccludedCount += !Current.Visible;
+    }
+    mTotalDrawsSaved += mLastOccludedCount;
+    mFramesWithSavings += mLastOccludedCount != 0;
+
+    mRequests.clear();
+    ++mFrame;
+}
+
+bool
+OcclusionCuller::BeginDraw(const void* object) {
+    std::unordered_map<const void*, unsigned>::const_iterator It = mQueryIndices.find(object);
+    if (It == mQueryIndices.end() || mQueries[It->second].IssuedFrame + 1 != mFrame) {
+        return false;
+    }
+
+    // NOTE: If the GPU has not finished the query yet the object is simply drawn
+    glBeginConditionalRender(mQueries[It->second].Id, GL_QUERY_NO_WAIT);
+    return true;
+}
+
+void
+OcclusionCuller::EndDraw() {
+    glEndConditionalRender();
+}
+
+void
+OcclusionCuller::Test(const void* object, const AABB& bounds) {
+    glm::vec3 Closest = glm::clamp(mViewPosition, bounds.Min, bounds.Max);
+    glm::vec3 Delta = Closest - mViewPosition;
+    if (glm::dot(Delta, Delta) < CameraMargin * CameraMargin) {
+        return;
+    }
+
+    std::unordered_map<const void*, unsigned>::const_iterator It = mQueryIndices.find(object);
+    unsigned QueryIdx;
+    if (It == mQueryIndices.end()) {
+        Query NewQuery = { 0, 0, true };
+        glGenQueries(1, &NewQuery.Id);
+        QueryIdx = mQueries.size();
+        mQueries.push_back(NewQuery);
+        mQueryIndices[object] = QueryIdx;
+    } else {
+        QueryIdx = It->second;
+    }
+
+    Request NewRequest = { QueryIdx, bounds };
+    mRequests.push_back(NewRequest);
+}
+
+void
+OcclusionCuller::IssueQueries() {
+    if (mRequests.empty()) {
+        return;
+    }
+
+    glUseProgram(mProxyShader.GetId());
+    mProxyShader.SetProjection(mProjection);
+    mProxyShader.SetView(mView);
+    glBindVertexArray(mBoxVAO);
+    glColorMask(GL_FALSE, GL_FALSE, GL_FALSE, GL_FALSE);
+    glDepthMask(GL_FALSE);
+    // NOTE: Back faces still count if the front ones end up behind the near plane
+    glDisable(GL_CULL_FACE);
+
+    for (unsigned RequestIdx = 0; RequestIdx < mRequests.size(); ++RequestIdx) {
+        const Request& Current = mRequests[RequestIdx];
+        glm::vec3 Size = Current.Bounds.Max - Current.Bounds.Min + glm::vec3(2.0f * ProxyPadding);
+        glm::mat4 Model = glm::scale(glm::translate(glm::mat4(1.0f), Current.Bounds.GetCenter()), Size);
+        mProxyShader.SetModel(Model, glm::mat3(1.0f));
+
+        Query& Target = mQueries[Current.Query];
+        glBeginQuery(GL_ANY_SAMPLES_PASSED, Target.Id);
+        glDrawArrays(GL_TRIANGLES, 0, mBoxVertexCount);
+        glEndQuery(GL_ANY_SAMPLES_PASSED);
+        Target.IssuedFrame = mFrame;
+    }
+
+    glEnable(GL_CULL_FACE);
+    glDepthMask(GL_TRUE);
+    glColorMask(GL_TRUE, GL_TRUE, GL_TRUE, GL_TRUE);
+}
+
+void
+OcclusionCuller::PrintStats() const {
+    std::cout << "Occlusion: " << mLastTestedCount << " objects tested last frame, " << mLastOccludedCount << " draws skipped, "
+        << mTotalDrawsSaved << " draws skipped in " << mFramesWithSavings << " of " << mFrame << " frames" << std::endl;
+}
@@ -0,0 +1,101 @@
+/**
+ * @file occlusion_culler.hpp
+ * @brief Hardware occlusion queries on bounding box proxies, consumed a frame
+ * later through conditional rendering so the CPU never waits on the GPU
+ *
+ */
+
+#pragma once
+#include <vector>
+#include <unordered_map>
+#include <GL/glew.h>
+#include <glm/glm.hpp>
+#include "shader.hpp"
+#include "bounds.hpp"
+
+class OcclusionCuller {
+public:
+    /**
+     * @brief Ctor - compiles the proxy program
+     *
+     * @param boxVAO Unit cube centered on the origin, drawn as the proxy of every box
+     * @param boxVertexCount Number of vertices drawn with glDrawArrays
+     */
+    OcclusionCuller(unsigned boxVAO, unsigned boxVertexCount);
+    OcclusionCuller(const OcclusionCuller&) = delete;
+    OcclusionCuller& operator=(const OcclusionCuller&) = delete;
+
+    /**
+     * @brief Starts a frame and collects, without waiting, results of the queries issued last frame
+     *
+     * @param view View matrix
+     * @param projection Projection matrix
+     * @param viewPosition Camera position, objects around the camera are never tested
+     */
+    void BeginFrame(const glm::mat4& view, const glm::mat4& projection, const glm::vec3& viewPosition);
+
+    /**
+     * @brief Call before drawing an object. If the object was tested last frame its draw is
+     * made conditional on that query, which the GPU resolves without the CPU reading it back
+     *
+     * @param object Identity of the object that stays the same between frames
+     *
+     * @returns true - EndDraw has to be called after the draw
+     */
+    bool BeginDraw(const void* object);
+
+    /**
+     * @brief Ends the conditional draw started by BeginDraw
+     *
+     */
+    void EndDraw();
+
+    /**
+     * @brief Requests a query on the object's box, issued by IssueQueries
+     *
+     * @param object Identity of the object that stays the same between frames
+     * @param bounds World space bounds
+     */
+    void Test(const void* object, const AABB& bounds);
+
+    /**
+     * @brief Draws the proxies of the requested objects against the depth drawn so far.
+     * Leaves the proxy program and box VAO bound
+     *
+     */
+    void IssueQueries();
+
+    /**
+     * @brief Prints tested and occluded objects of the last frame and totals since start
+     *
+     */
+    void PrintStats() const;
+
+private:
+    struct Query {
+        unsigned Id;
+        // NOTE: Frame the query was last issued in, results older than the previous frame are stale
+        unsigned IssuedFrame;
+        bool Visible;
+    };
+
+    struct Request {
+        unsigned Query;
+        AABB Bounds;
+    };
+
+    Shader mProxyShader;
+    unsigned mBoxVAO;
+    unsigned mBoxVertexCount;
+    std::unordered_map<const void*, unsigned> mQueryIndices;
+    std::vector<Query> mQueries;
+    std::vector<Request> mRequests;
+    glm::mat4 mView;
+    glm::mat4 mProjection;
+    glm::vec3 mViewPosition;
+    unsigned mFrame;
+    unsigned mLastTestedCount;
+    unsigned mLastOccludedCount;
+    unsigned mFramesWithSavings;
+    unsigned long long mTotalDrawsSaved;
+};
@@ -0,0 +1,109 @@
+#include "ocean_clipmap.hpp"
+#include <cmath>
+
+OceanClipmap::OceanClipmap(unsigned levelCount, unsigned gridSize, float spacing) {
+    mLevelCount = levelCount;
+    mHalfSize = static_cast<int>((gridSize + 3) / 4 * 2);
+    mSpacing = spacing;
+
+    // NOTE: Vertices only hold grid coordinates, every level scales and moves the same grid
+    std::vector<float> Vertices;
+    for (int Z = -mHalfSize; Z <= mHalfSize; ++Z) {
+        for (int X = -mHalfSize; X <= mHalfSize; ++X) {
+            Vertices.push_back(static_cast<float>(X));
+            Vertices.push_back(static_cast<float>(Z));
+        }
+    }
+
+    std::vector<unsigned> Indices;
+    appendCells(Indices, 0, 0, false);
+    mBlockCount = Indices.size();
+    for (unsigned Variant = 0; Variant < 4; ++Variant) {
+        mRingOffsets[Variant] = Indices.size();
+        appendCells(Indices, Variant & 1, Variant >> 1, true);
+    }
+    mRingCount = Indices.size() - mRingOffsets[3];
+
+    glGenVertexArrays(1, &mVAO);
+    glBindVertexArray(mVAO);
+    glGenBuffers(1, &mVBO);
+    glBindBuffer(GL_ARRAY_BUFFER, mVBO);
+    glBufferData(GL_ARRAY_BUFFER, Vertices.size() * sizeof(float), Vertices.data(), GL_STATIC_DRAW);
+    glVertexAttribPointer(0, 2, GL_FLOAT, GL_FALSE, 2 * sizeof(float), (void*)0);
+    glEnableVertexAttribArray(0);
+    glGenBuffers(1, &mEBO);
+    glBindBuffer(GL_ELEMENT_ARRAY_BUFFER, mEBO);
+    glBufferData(GL_ELEMENT_ARRAY_BUFFER, Indices.size() * sizeof(unsigned), Indices.data(), GL_STATIC_DRAW);
+    glBindVertexArray(0);
+    glBindBuffer(GL_ARRAY_BUFFER, 0);
+    glBindBuffer(GL_ELEMENT_ARRAY_BUFFER, 0);
+}
+
+void
+OceanClipmap::Render(const Shader& shader, const glm::vec3& viewPosition, unsigned diffuse, unsigned specular) const {
+    glActiveTexture(GL_TEXTURE0);
+    glBindTexture(GL_TEXTURE_2D, diffuse);
+    glActiveTexture(GL_TEXTURE1);
+    glBindTexture(GL_TEXTURE_2D, specular);
+    glBindVertexArray(mVAO);
+    shader.SetUniform1f("uGridHalfSize", static_cast<float>(mHalfSize));
+
+    // NOTE: A level snaps to twice its spacing, which is the spacing of the level around it,
+    // so every level boundary falls on grid lines of both levels and vertices never swim
+    float Spacing = mSpacing;
+    float FinerX = 0.0f;
+    float FinerZ = 0.0f;
+    for (unsigned Level = 0; Level < mLevelCount; ++Level, Spacing *= 2.0f) {
+        float OriginX = std::floor(viewPosition.x / (2.0f * Spacing)) * 2.0f * Spacing;
+        float OriginZ = std::floor(viewPosition.z / (2.0f * Spacing)) * 2.0f * Spacing;
+        shader.SetUniform2f("uLevelOrigin", glm::vec2(OriginX, OriginZ));
+        shader.SetUniform1f("uLevelSpacing", Spacing);
+
+        if (!Level) {
+            glDrawElements(GL_TRIANGLES, mBlockCount, GL_UNSIGNED_INT, (void*)0);
+        } else {
+            unsigned Variant = (FinerX != OriginX ? 1 : 0) | (FinerZ != OriginZ ? 2 : 0);
+            glDrawElements(GL_TRIANGLES, mRingCount, GL_UNSIGNED_INT, (void*)(mRingOffsets[Variant] * sizeof(unsigned)));
+        }
+        FinerX = OriginX;
+        FinerZ = OriginZ;
+    }
+
+    glBindVertexArray(0);
+    glActiveTexture(GL_TEXTURE1);
+    glBindTexture(GL_TEXTURE_2D, 0);
+    glActiveTexture(GL_TEXTURE0);
+    glBindTexture(GL_TEXTURE_2D, 0);
+}
+
+unsigned
+OceanClipmap::GetTriangleCount() const {
+    return (mBlockCount + (mLevelCount - 1) * mRingCount) / 3;
+}
+
+float
+OceanClipmap::GetExtent() const {
+    return mHalfSize * mSpacing * static_cast<float>(1u << (mLevelCount - 1));
+}
+
+void
+OceanClipmap::appendCells(std::vector<unsigned>& indices, int holeX, int holeZ, bool hole) const {
+    const int Row = 2 * mHalfSize + 1;
+    const int HoleHalf = mHalfSize / 2;
+    for (int Z = -mHalfSize; Z < mHalfSize; ++Z) {
+        for (int X = -mHalfSize; X < mHalfSize; ++X) {
+            if (hole && X >= holeX - HoleHalf && X < holeX + HoleHalf && Z >= holeZ - HoleHalf && Z < holeZ + HoleHalf) {
+                continue;
+            }
+
+            unsigned Corner = (Z + mHalfSize) * Row + (X + mHalfSize);
+            // NOTE: Counter-clockwise seen from above
+            indices.push_back(Corner);
+            indices.push_back(Corner + Row);
+            indices.push_back(Corner + 1);
+            indices.push_back(Corner + 1);
+            indices.push_back(Corner + Row);
+            indices.push_back(Corner + Row + 1);
+        }
+    }
+}
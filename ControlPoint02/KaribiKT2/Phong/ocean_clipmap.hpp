@@ -0,0 +1,65 @@
+/**
+ * @file ocean_clipmap.hpp
+ * @brief Camera centered ocean surface made of nested grid rings (geometry clipmaps),
+ * each level twice as coarse and twice as wide as the one inside it
+ *
+ */
+
+#pragma once
+#include <vector>
+#include <GL/glew.h>
+#include <glm/glm.hpp>
+#include "shader.hpp"
+
+class OceanClipmap {
+public:
+    /**
+     * @brief Ctor - builds the shared level grid and its index sets
+     *
+     * @param levelCount Number of levels, each one doubles the covered distance
+     * @param gridSize Cells along a level side, rounded up to a multiple of 4
+     * @param spacing Cell size of the innermost level
+     */
+    OceanClipmap(unsigned levelCount, unsigned gridSize, float spacing);
+    OceanClipmap(const OceanClipmap&) = delete;
+    OceanClipmap& operator=(const OceanClipmap&) = delete;
+
+    /**
+     * @brief Draws every level around the camera. Waves are added by the vertex stage
+     * (shaders/ocean.vert), so the shader has to be in use with its frame uniforms set
+     *
+     * @param shader Ocean program
+     * @param viewPosition Camera position the levels are centered on
+     * @param diffuse Diffuse texture
+     * @param specular Specular texture
+     */
+    void Render(const Shader& shader, const glm::vec3& viewPosition, unsigned diffuse, unsigned specular) const;
+
+    /**
+     * @brief Returns the number of triangles drawn per frame, which does not depend on the view
+     *
+     */
+    unsigned GetTriangleCount() const;
+
+    /**
+     * @brief Returns the distance from the camera to the edge of the outermost level
+     *
+     */
+    float GetExtent() const;
+
+private:
+    unsigned mVAO;
+    unsigned mVBO;
+    unsigned mEBO;
+    unsigned mLevelCount;
+    // NOTE: Levels span [-mHalfSize, mHalfSize] cells around their origin on both axes
+    int mHalfSize;
+    float mSpacing;
+    // NOTE: The inner block is a full grid, rings leave a hole for the level inside them.
+    // The hole sits one cell off center on an axis when the finer level snapped the other way
+    unsigned mBlockCount;
+    unsigned mRingCount;
+    unsigned mRingOffsets[4];
+
+    void appendCells(std::vector<unsigned>& indices, int holeX, int holeZ, bool hole) const;
+};
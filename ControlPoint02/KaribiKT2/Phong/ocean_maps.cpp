@@ -0,0 +1,77 @@
+#include "ocean_maps.hpp"
+#include <iostream>
+
+OceanMaps::OceanMaps(OceanSimulation& simulation)
+    : mSimulation(simulation) {
+    mDisplacementTexture = createTexture();
+    mNormalTexture = createTexture();
+
+    // NOTE: One buffer holds both maps, displacement first
+    const unsigned Size = mSimulation.GetSize();
+    glGenBuffers(2, mUploadBuffers);
+    for (unsigned BufferIdx = 0; BufferIdx < 2; ++BufferIdx) {
+        glBindBuffer(GL_PIXEL_UNPACK_BUFFER, mUploadBuffers[BufferIdx]);
+        glBufferData(GL_PIXEL_UNPACK_BUFFER, 2 * 4 * Size * Size * sizeof(float), 0, GL_STREAM_DRAW);
+    }
+    glBindBuffer(GL_PIXEL_UNPACK_BUFFER, 0);
+    mNextBuffer = 0;
+}
+
+void
+OceanMaps::Update(float time, ThreadPool& workers) {
+    const unsigned Size = mSimulation.GetSize();
+    const size_t MapBytes = 4 * Size * Size * sizeof(float);
+    glBindBuffer(GL_PIXEL_UNPACK_BUFFER, mUploadBuffers[mNextBuffer]);
+    // NOTE: Invalidating lets the driver hand out fresh memory instead of waiting on a pending copy
+    float* Mapped = static_cast<float*>(glMapBufferRange(GL_PIXEL_UNPACK_BUFFER, 0, 2 * MapBytes, GL_MAP_WRITE_BIT | GL_MAP_INVALIDATE_BUFFER_BIT));
+    if (!Mapped) {
+        std::cerr << "[Err] Failed to map ocean upload buffer" << std::endl;
+        glBindBuffer(GL_PIXEL_UNPACK_BUFFER, 0);
+        return;
+    }
+
+    mSimulation.Simulate(time, workers, Mapped, Mapped + 4 * Size * Size);
+    if (glUnmapBuffer(GL_PIXEL_UNPACK_BUFFER) == GL_TRUE) {
+        glBindTexture(GL_TEXTURE_2D, mDisplacementTexture);
+        glTexSubImage2D(GL_TEXTURE_2D, 0, 0, 0, Size, Size, GL_RGBA, GL_FLOAT, (void*)0);
+        glGenerateMipmap(GL_TEXTURE_2D);
+        glBindTexture(GL_TEXTURE_2D, mNormalTexture);
+        glTexSubImage2D(GL_TEXTURE_2D, 0, 0, 0, Size, Size, GL_RGBA, GL_FLOAT, (void*)MapBytes);
+        glGenerateMipmap(GL_TEXTURE_2D);
+        glBindTexture(GL_TEXTURE_2D, 0);
+    }
+    glBindBuffer(GL_PIXEL_UNPACK_BUFFER, 0);
+    mNextBuffer ^= 1;
+}
+
+void
+OceanMaps::Bind() const {
+    glActiveTexture(GL_TEXTURE0 + DISPLACEMENT_TEXTURE_UNIT);
+    glBindTexture(GL_TEXTURE_2D, mDisplacementTexture);
+    glActiveTexture(GL_TEXTURE0 + NORMAL_TEXTURE_UNIT);
+    glBindTexture(GL_TEXTURE_2D, mNormalTexture);
+    glActiveTexture(GL_TEXTURE0);
+}
+
+void
+OceanMaps::SetDefaults(const Shader& shader) const {
+    shader.SetUniform1i("uDisplacementMap", DISPLACEMENT_TEXTURE_UNIT);
+    shader.SetUniform1i("uNormalMap", NORMAL_TEXTURE_UNIT);
+    shader.SetUniform1f("uPatchSize", mSimulation.GetPatchSize());
+}
+
+unsigned
+OceanMaps::createTexture() const {
+    const unsigned Size = mSimulation.GetSize();
+    unsigned Texture;
+    glGenTextures(1, &Texture);
+    glBindTexture(GL_TEXTURE_2D, Texture);
+    glTexImage2D(GL_TEXTURE_2D, 0, GL_RGBA32F, Size, Size, 0, GL_RGBA, GL_FLOAT, 0);
+    glTexParameteri(GL_TEXTURE_2D, GL_TEXTURE_WRAP_S, GL_REPEAT);
+    glTexParameteri(GL_TEXTURE_2D, GL_TEXTURE_WRAP_T, GL_REPEAT);
+    glTexParameteri(GL_TEXTURE_2D, GL_TEXTURE_MIN_FILTER, GL_LINEAR_MIPMAP_LINEAR);
+    glTexParameteri(GL_TEXTURE_2D, GL_TEXTURE_MAG_FILTER, GL_LINEAR);
+    glGenerateMipmap(GL_TEXTURE_2D);
+    glBindTexture(GL_TEXTURE_2D, 0);
+    return Texture;
+}
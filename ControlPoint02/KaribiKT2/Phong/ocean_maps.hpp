@@ -0,0 +1,57 @@
+/**
+ * @file ocean_maps.hpp
+ * @brief Displacement and normal textures of an OceanSimulation, refilled every frame
+ * through two pixel buffers so writing a frame never waits on the upload of the last one
+ *
+ */
+
+#pragma once
+#include <GL/glew.h>
+#include "ocean_simulation.hpp"
+#include "shader.hpp"
+
+class OceanMaps {
+public:
+    // NOTE: Past the units taken by the clustered and deferred renderers
+    static const unsigned DISPLACEMENT_TEXTURE_UNIT = 10;
+    static const unsigned NORMAL_TEXTURE_UNIT = 11;
+
+    /**
+     * @brief Ctor - creates both textures and the upload buffers
+     *
+     * @param simulation Simulation the maps are filled from, has to outlive the maps
+     */
+    OceanMaps(OceanSimulation& simulation);
+    OceanMaps(const OceanMaps&) = delete;
+    OceanMaps& operator=(const OceanMaps&) = delete;
+
+    /**
+     * @brief Runs the simulation straight into the next upload buffer and starts copying it
+     * into the textures
+     *
+     * @param time Seconds
+     * @param workers Pool the simulation runs on
+     */
+    void Update(float time, ThreadPool& workers);
+
+    /**
+     * @brief Binds the textures to their units
+     *
+     */
+    void Bind() const;
+
+    /**
+     * @brief Sets the sampler units and patch size uniforms of a program using the maps
+     *
+     */
+    void SetDefaults(const Shader& shader) const;
+
+private:
+    OceanSimulation& mSimulation;
+    unsigned mDisplacementTexture;
+    unsigned mNormalTexture;
+    unsigned mUploadBuffers[2];
+    unsigned mNextBuffer;
+
+    unsigned createTexture() const;
+};
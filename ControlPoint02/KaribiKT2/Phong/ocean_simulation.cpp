@@ -0,0 +1,325 @@
+#include "ocean_simulation.hpp"
+#include <xmmintrin.h>
+#include <algorithm>
+#include <chrono>
+#include <cmath>
+#include <iomanip>
+#include <iostream>
+#include <random>
+#include <utility>
+
+static const float Gravity = 9.81f;
+static const float Pi = 3.14159265f;
+
+OceanSimulation::OceanSimulation(unsigned size, float patchSize, const glm::vec2& wind, float amplitude, float choppiness) {
+    mSize = std::max(4u, size);
+    mLogSize = 0;
+    while ((1u << mLogSize) < mSize) {
+        ++mLogSize;
+    }
+    mSize = 1u << mLogSize;
+    mPatchSize = patchSize;
+    mChoppiness = choppiness;
+    mLastSimulationMs = 0.0;
+
+    const unsigned Count = mSize * mSize;
+    for (unsigned Field = 0; Field < FIELD_COUNT; ++Field) {
+        mFieldRe[Field].resize(Count);
+        mFieldIm[Field].resize(Count);
+    }
+
+    mBitReverse.resize(mSize);
+    for (unsigned Idx = 0; Idx < mSize; ++Idx) {
+        unsigned Reversed = 0;
+        for (unsigned Bit = 0; Bit < mLogSize; ++Bit) {
+            Reversed |= ((Idx >> Bit) & 1) << (mLogSize - 1 - Bit);
+        }
+        mBitReverse[Idx] = Reversed;
+    }
+
+    // NOTE: Inverse transform, so twiddles turn counter-clockwise
+    mTwiddleRe.resize(mSize - 1);
+    mTwiddleIm.resize(mSize - 1);
+    for (unsigned Half = 1; Half < mSize; Half *= 2) {
+        for (unsigned K = 0; K < Half; ++K) {
+            double Angle = Pi * static_cast<double>(K) / Half;
+            mTwiddleRe[Half - 1 + K] = static_cast<float>(std::cos(Angle));
+            mTwiddleIm[Half - 1 + K] = static_cast<float>(std::sin(Angle));
+        }
+    }
+
+    // Phillips spectrum, waves shorter than a thousandth of the largest one are damped away
+    const float WindSpeed = glm::length(wind);
+    const glm::vec2 WindDirection = WindSpeed > 0.0f ? wind / WindSpeed : glm::vec2(1.0f, 0.0f);
+    const float LargestWave = WindSpeed * WindSpeed / Gravity;
+    const float SmallestWave = LargestWave / 1000.0f;
+    std::vector<float> Re(Count);
+    std::vector<float> Im(Count);
+    mOmega.resize(Count);
+    std::mt19937 Generator(1337);
+    std::normal_distribution<float> Gaussian;
+    for (unsigned Row = 0; Row < mSize; ++Row) {
+        for (unsigned Column = 0; Column < mSize; ++Column) {
+            glm::vec2 K(2.0f * Pi * (static_cast<int>(Column) - static_cast<int>(mSize / 2)) / mPatchSize,
+                        2.0f * Pi * (static_cast<int>(Row) - static_cast<int>(mSize / 2)) / mPatchSize);
+            float Length = glm::length(K);
+            unsigned Idx = Row * mSize + Column;
+            float Phillips = 0.0f;
+            if (Length > 0.0f) {
+                float Alignment = glm::dot(K / Length, WindDirection);
+                float KL = Length * LargestWave;
+                Phillips = amplitude * std::exp(-1.0f / (KL * KL)) / (Length * Length * Length * Length) * Alignment * Alignment
+                    * std::exp(-Length * Length * SmallestWave * SmallestWave);
+            }
+            float Scale = std::sqrt(Phillips * 0.5f);
+            Re[Idx] = Gaussian(Generator) * Scale;
+            Im[Idx] = Gaussian(Generator) * Scale;
+            mOmega[Idx] = std::sqrt(Gravity * Length);
+        }
+    }
+
+    mH0Re = Re;
+    mH0Im = Im;
+    mH0ConjRe.resize(Count);
+    mH0ConjIm.resize(Count);
+    for (unsigned Row = 0; Row < mSize; ++Row) {
+        for (unsigned Column = 0; Column < mSize; ++Column) {
+            unsigned Mirrored = ((mSize - Row) % mSize) * mSize + (mSize - Column) % mSize;
+            mH0ConjRe[Row * mSize + Column] = Re[Mirrored];
+            mH0ConjIm[Row * mSize + Column] = -Im[Mirrored];
+        }
+    }
+}
+
+void
+OceanSimulation::Simulate(float time, ThreadPool& workers, float* displacement, float* normals) {
+    std::chrono::high_resolution_clock::time_point Start = std::chrono::high_resolution_clock::now();
+
+    workers.ParallelFor(mSize, [&](unsigned begin, unsigned end, unsigned) {
+        computeSpectrum(begin, end, time);
+    }, 8);
+
+    // NOTE: Columns are transformed four at a time, transposing turns rows into columns
+    const unsigned Groups = mSize / 4;
+    ThreadPool::RangeJob Columns = [&](unsigned begin, unsigned end, unsigned) {
+        for (unsigned Job = begin; Job < end; ++Job) {
+            unsigned Field = Job / Groups;
+            inverseColumns(mFieldRe[Field].data(), mFieldIm[Field].data(), (Job % Groups) * 4);
+        }
+    };
+    workers.ParallelFor(FIELD_COUNT * Groups, Columns, 2);
+    workers.ParallelFor(FIELD_COUNT * mSize, [&](unsigned begin, unsigned end, unsigned) {
+        for (unsigned Job = begin; Job < end; ++Job) {
+            unsigned Field = Job / mSize;
+            transpose(mFieldRe[Field].data(), mFieldIm[Field].data(), Job % mSize);
+        }
+    }, 16);
+    workers.ParallelFor(FIELD_COUNT * Groups, Columns, 2);
+
+    workers.ParallelFor(mSize, [&](unsigned begin, unsigned end, unsigned) {
+        writeMaps(begin, end, displacement, normals);
+    }, 8);
+
+    std::chrono::duration<double, std::milli> Elapsed = std::chrono::high_resolution_clock::now() - Start;
+    mLastSimulationMs = Elapsed.count();
+}
+
+unsigned
+OceanSimulation::GetSize() const {
+    return mSize;
+}
+
+float
+OceanSimulation::GetPatchSize() const {
+    return mPatchSize;
+}
+
+double
+OceanSimulation::GetLastSimulationMs() const {
+    return mLastSimulationMs;
+}
+
+void
+OceanSimulation::computeSpectrum(unsigned rowBegin, unsigned rowEnd, float time) {
+    for (unsigned Row = rowBegin; Row < rowEnd; ++Row) {
+        float KZ = 2.0f * Pi * (static_cast<int>(Row) - static_cast<int>(mSize / 2)) / mPatchSize;
+        for (unsigned Column = 0; Column < mSize; ++Column) {
+            unsigned Idx = Row * mSize + Column;
+            float KX = 2.0f * Pi * (static_cast<int>(Column) - static_cast<int>(mSize / 2)) / mPatchSize;
+            float Length = std::sqrt(KX * KX + KZ * KZ);
+            if (Length == 0.0f) {
+                for (unsigned Field = 0; Field < FIELD_COUNT; ++Field) {
+                    mFieldRe[Field][Idx] = 0.0f;
+                    mFieldIm[Field][Idx] = 0.0f;
+                }
+                continue;
+            }
+
+            // h(k, t) = h0(k) * e^(iwt) + conj(h0(-k)) * e^(-iwt)
+            float Cos = std::cos(mOmega[Idx] * time);
+            float Sin = std::sin(mOmega[Idx] * time);
+            float HRe = (mH0Re[Idx] + mH0ConjRe[Idx]) * Cos + (mH0ConjIm[Idx] - mH0Im[Idx]) * Sin;
+            float HIm = (mH0Re[Idx] - mH0ConjRe[Idx]) * Sin + (mH0Im[Idx] + mH0ConjIm[Idx]) * Cos;
+
+            // Offsets are -i * k / |k| * h, slopes are i * k * h
+            float DirX = KX / Length;
+            float DirZ = KZ / Length;
+            float OffsetXRe = HIm * DirX;
+            float OffsetXIm = -HRe * DirX;
+            float OffsetZRe = HIm * DirZ;
+            float OffsetZIm = -HRe * DirZ;
+            float SlopeXRe = -HIm * KX;
+            float SlopeXIm = HRe * KX;
+
+            mFieldRe[FIELD_HEIGHT_OFFSET_X][Idx] = HRe - OffsetXIm;
+            mFieldIm[FIELD_HEIGHT_OFFSET_X][Idx] = HIm + OffsetXRe;
+            mFieldRe[FIELD_OFFSET_Z_SLOPE_X][Idx] = OffsetZRe - SlopeXIm;
+            mFieldIm[FIELD_OFFSET_Z_SLOPE_X][Idx] = OffsetZIm + SlopeXRe;
+            mFieldRe[FIELD_SLOPE_Z][Idx] = -HIm * KZ;
+            mFieldIm[FIELD_SLOPE_Z][Idx] = HRe * KZ;
+        }
+    }
+}
+
+void
+OceanSimulation::inverseColumns(float* re, float* im, unsigned column) const {
+    // NOTE: Radix-2 decimation in time, every butterfly runs on four neighbouring columns at once
+    const unsigned Stride = mSize;
+    for (unsigned Row = 0; Row < mSize; ++Row) {
+        unsigned Reversed = mBitReverse[Row];
+        if (Row < Reversed) {
+            float* ReA = re + Row * Stride + column;
+            float* ReB = re + Reversed * Stride + column;
+            float* ImA = im + Row * Stride + column;
+            float* ImB = im + Reversed * Stride + column;
+            __m128 TempRe = _mm_loadu_ps(ReA);
+            __m128 TempIm = _mm_loadu_ps(ImA);
+            _mm_storeu_ps(ReA, _mm_loadu_ps(ReB));
+            _mm_storeu_ps(ImA, _mm_loadu_ps(ImB));
+            _mm_storeu_ps(ReB, TempRe);
+            _mm_storeu_ps(ImB, TempIm);
+        }
+    }
+
+    for (unsigned Half = 1; Half < mSize; Half *= 2) {
+        for (unsigned Start = 0; Start < mSize; Start += 2 * Half) {
+            for (unsigned K = 0; K < Half; ++K) {
+                __m128 WRe = _mm_set1_ps(mTwiddleRe[Half - 1 + K]);
+                __m128 WIm = _mm_set1_ps(mTwiddleIm[Half - 1 + K]);
+                float* ReA = re + (Start + K) * Stride + column;
+                float* ImA = im + (Start + K) * Stride + column;
+                float* ReB = ReA + Half * Stride;
+                float* ImB = ImA + Half * Stride;
+                __m128 ARe = _mm_loadu_ps(ReA);
+                __m128 AIm = _mm_loadu_ps(ImA);
+                __m128 BRe = _mm_loadu_ps(ReB);
+                __m128 BIm = _mm_loadu_ps(ImB);
+                __m128 TRe = _mm_sub_ps(_mm_mul_ps(BRe, WRe), _mm_mul_ps(BIm, WIm));
+                __m128 TIm = _mm_add_ps(_mm_mul_ps(BRe, WIm), _mm_mul_ps(BIm, WRe));
+                _mm_storeu_ps(ReA, _mm_add_ps(ARe, TRe));
+                _mm_storeu_ps(ImA, _mm_add_ps(AIm, TIm));
+                _mm_storeu_ps(ReB, _mm_sub_ps(ARe, TRe));
+                _mm_storeu_ps(ImB, _mm_sub_ps(AIm, TIm));
+            }
+        }
+    }
+}
+
+void
+OceanSimulation::transpose(float* re, float* im, unsigned row) const {
+    // NOTE: Each row swaps with the part of its column below the diagonal, so rows never overlap
+    for (unsigned Column = row + 1; Column < mSize; ++Column) {
+        std::swap(re[row * mSize + Column], re[Column * mSize + row]);
+        std::swap(im[row * mSize + Column], im[Column * mSize + row]);
+    }
+}
+
+void
+OceanSimulation::writeMaps(unsigned rowBegin, unsigned rowEnd, float* displacement, float* normals) const {
+    // NOTE: The transforms leave the grid transposed, and the spectrum being stored from
+    // -size / 2 instead of 0 flips the sign of every other sample
+    for (unsigned Row = rowBegin; Row < rowEnd; ++Row) {
+        for (unsigned Column = 0; Column < mSize; ++Column) {
+            unsigned Idx = Column * mSize + Row;
+            float Sign = ((Row + Column) & 1) ? -1.0f : 1.0f;
+            float Height = Sign * mFieldRe[FIELD_HEIGHT_OFFSET_X][Idx];
+            float OffsetX = Sign * mFieldIm[FIELD_HEIGHT_OFFSET_X][Idx];
+            float OffsetZ = Sign * mFieldRe[FIELD_OFFSET_Z_SLOPE_X][Idx];
+            float SlopeX = Sign * mFieldIm[FIELD_OFFSET_Z_SLOPE_X][Idx];
+            float SlopeZ = Sign * mFieldRe[FIELD_SLOPE_Z][Idx];
+
+            float* Displacement = displacement + 4 * (Row * mSize + Column);
+            Displacement[0] = mChoppiness * OffsetX;
+            Displacement[1] = Height;
+            Displacement[2] = mChoppiness * OffsetZ;
+            Displacement[3] = 0.0f;
+
+            float InvLength = 1.0f / std::sqrt(SlopeX * SlopeX + 1.0f + SlopeZ * SlopeZ);
+            float* Normal = normals + 4 * (Row * mSize + Column);
+            Normal[0] = -SlopeX * InvLength;
+            Normal[1] = InvLength;
+            Normal[2] = -SlopeZ * InvLength;
+            Normal[3] = 0.0f;
+        }
+    }
+}
+
+void
+OceanSimulation::Benchmark() {
+    const unsigned Size = 256;
+    const unsigned Steps = 60;
+    OceanSimulation Simulation(Size, 64.0f, glm::vec2(8.0f, 3.0f), 0.000007f, 1.0f);
+    std::vector<float> Displacement(4 * Size * Size);
+    std::vector<float> Normals(4 * Size * Size);
+
+    // NOTE: Reference is a direct sum for a handful of samples, checking sign flip and transpose as well
+    {
+        ThreadPool Single(1);
+        Simulation.Simulate(1.5f, Single, Displacement.data(), Normals.data());
+        Simulation.computeSpectrum(0, Size, 1.5f);
+        float MaxError = 0.0f;
+        float MaxHeight = 0.0f;
+        const unsigned Samples[][2] = { { 0, 0 }, { 1, 0 }, { 0, 1 }, { 17, 200 }, { 255, 3 }, { 128, 129 } };
+        for (unsigned SampleIdx = 0; SampleIdx < sizeof(Samples) / sizeof(Samples[0]); ++SampleIdx) {
+            unsigned Row = Samples[SampleIdx][0];
+            unsigned Column = Samples[SampleIdx][1];
+            double Height = 0.0;
+            for (unsigned KRow = 0; KRow < Size; ++KRow) {
+                for (unsigned KColumn = 0; KColumn < Size; ++KColumn) {
+                    unsigned Idx = KRow * Size + KColumn;
+                    double Angle = 2.0 * Pi * ((static_cast<double>(KRow) - Size / 2) * Row + (static_cast<double>(KColumn) - Size / 2) * Column) / Size;
+                    Height += Simulation.mFieldRe[FIELD_HEIGHT_OFFSET_X][Idx] * std::cos(Angle) - Simulation.mFieldIm[FIELD_HEIGHT_OFFSET_X][Idx] * std::sin(Angle);
+                }
+            }
+            MaxError = std::max(MaxError, std::fabs(static_cast<float>(Height) - Displacement[4 * (Row * Size + Column) + 1]));
+            MaxHeight = std::max(MaxHeight, std::fabs(static_cast<float>(Height)));
+        }
+        std::cout << "Ocean FFT " << Size << "x" << Size << ", max error against direct sum " << MaxError << " of heights up to " << MaxHeight << std::endl;
+    }
+
+    const unsigned MaxThreads = std::max(1u, std::thread::hardware_concurrency());
+    std::vector<unsigned> ThreadCounts;
+    for (unsigned Threads = 1; Threads < MaxThreads; Threads *= 2) {
+        ThreadCounts.push_back(Threads);
+    }
+    ThreadCounts.push_back(MaxThreads);
+
+    std::cout << std::setw(8) << "Threads" << std::setw(12) << "ms/step" << std::setw(12) << "Speedup" << std::endl;
+    double SingleThreadMs = 0.0;
+    for (unsigned CountIdx = 0; CountIdx < ThreadCounts.size(); ++CountIdx) {
+        const unsigned Threads = ThreadCounts[CountIdx];
+        ThreadPool Workers(Threads);
+        Simulation.Simulate(0.0f, Workers, Displacement.data(), Normals.data());
+        std::chrono::high_resolution_clock::time_point Start = std::chrono::high_resolution_clock::now();
+        for (unsigned Step = 0; Step < Steps; ++Step) {
+            Simulation.Simulate(Step / 60.0f, Workers, Displacement.data(), Normals.data());
+        }
+        std::chrono::duration<double, std::milli> Elapsed = std::chrono::high_resolution_clock::now() - Start;
+        double StepMs = Elapsed.count() / Steps;
+        if (Threads == 1) {
+            SingleThreadMs = StepMs;
+        }
+        std::cout << std::setw(8) << Threads << std::fixed << std::setprecision(2) << std::setw(12) << StepMs
+            << std::setw(12) << SingleThreadMs / StepMs << std::defaultfloat << std::endl;
+    }
+}
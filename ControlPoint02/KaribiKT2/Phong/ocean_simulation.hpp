@@ -0,0 +1,86 @@
+/**
+ * @file ocean_simulation.hpp
+ * @brief Tessendorf ocean on the CPU: a Phillips spectrum advanced in time and turned
+ * into heights, choppy displacement and normals by inverse FFTs split across a thread pool
+ *
+ */
+
+#pragma once
+#include <vector>
+#include <glm/glm.hpp>
+#include "thread_pool.hpp"
+
+class OceanSimulation {
+public:
+    /**
+     * @brief Ctor - generates the initial spectrum from a fixed seed
+     *
+     * @param size Grid resolution, a power of two of at least 4
+     * @param patchSize World size of the tile the grid covers, the result repeats after it
+     * @param wind Wind velocity, sets the direction and size of the largest waves
+     * @param amplitude Phillips spectrum constant
+     * @param choppiness Scale of the horizontal displacement, 0 gives plain height waves
+     */
+    OceanSimulation(unsigned size, float patchSize, const glm::vec2& wind, float amplitude, float choppiness);
+    OceanSimulation(const OceanSimulation&) = delete;
+    OceanSimulation& operator=(const OceanSimulation&) = delete;
+
+    /**
+     * @brief Computes the surface at the given time
+     *
+     * @param time Seconds
+     * @param workers Pool the rows and columns are split across
+     * @param displacement Output, size * size RGBA: x, height, z offsets and 0
+     * @param normals Output, size * size RGBA: normal and 0
+     */
+    void Simulate(float time, ThreadPool& workers, float* displacement, float* normals);
+
+    unsigned GetSize() const;
+    float GetPatchSize() const;
+
+    /**
+     * @brief Returns the duration of the last Simulate in milliseconds
+     *
+     */
+    double GetLastSimulationMs() const;
+
+    /**
+     * @brief Times a 256 x 256 step on 1 thread up to one per hardware thread, checks
+     * the SIMD FFT against a direct transform and prints the results
+     *
+     */
+    static void Benchmark();
+
+private:
+    // NOTE: Five real outputs packed into three complex transforms. An inverse FFT of a
+    // Hermitian spectrum is real, so height + i * x offset comes out as two real fields
+    enum EField {
+        FIELD_HEIGHT_OFFSET_X,
+        FIELD_OFFSET_Z_SLOPE_X,
+        FIELD_SLOPE_Z,
+        FIELD_COUNT
+    };
+
+    unsigned mSize;
+    unsigned mLogSize;
+    float mPatchSize;
+    float mChoppiness;
+    // NOTE: h0(k) and conj(h0(-k)), together with the dispersion they give h(k, t) for any t
+    std::vector<float> mH0Re;
+    std::vector<float> mH0Im;
+    std::vector<float> mH0ConjRe;
+    std::vector<float> mH0ConjIm;
+    std::vector<float> mOmega;
+    std::vector<float> mFieldRe[FIELD_COUNT];
+    std::vector<float> mFieldIm[FIELD_COUNT];
+    std::vector<unsigned> mBitReverse;
+    // NOTE: Twiddles of the stage with half size H start at H - 1
+    std::vector<float> mTwiddleRe;
+    std::vector<float> mTwiddleIm;
+    double mLastSimulationMs;
+
+    void computeSpectrum(unsigned rowBegin, unsigned rowEnd, float time);
+    void inverseColumns(float* re, float* im, unsigned column) const;
+    void transpose(float* re, float* im, unsigned row) const;
+    void writeMaps(unsigned rowBegin, unsigned rowEnd, float* displacement, float* normals) const;
+};
@@ -0,0 +1,146 @@
+#include "program_cache.hpp"
+#include "hash.hpp"
+#include <fstream>
+#include <iostream>
+#include <vector>
+#ifdef _WIN32
+#include <direct.h>
+#else
+#include <sys/stat.h>
+#endif
+
+static const char* CacheDirectory = "shader_cache";
+static const uint32_t CacheMagic = 0x4B504243; // "CBPK"
+
+static unsigned CacheHits = 0;
+static unsigned CacheMisses = 0;
+static unsigned CacheRejects = 0;
+
+static std::string
+GetCachePath(const std::string& key) {
+    return std::string(CacheDirectory) + "/" + key + ".bin";
+}
+
+static std::string
+GetGLString(GLenum name) {
+    const GLubyte* Str = glGetString(name);
+    return Str ? reinterpret_cast<const char*>(Str) : "";
+}
+
+std::string
+ProgramCache::MakeKey(const std::string& vSource, const std::string& fSource) {
+    uint64_t Hash = HashFNV1a(GetGLString(GL_VENDOR));
+    Hash = HashFNV1a(GetGLString(GL_RENDERER), Hash);
+    Hash = HashFNV1a(GetGLString(GL_VERSION), Hash);
+    // NOTE: Separator keeps "ab" + "c" and "a" + "bc" apart
+    Hash = HashFNV1a(vSource, Hash);
+    Hash = HashFNV1a(std::string(1, '\0'), Hash);
+    Hash = HashFNV1a(fSource, Hash);
+
+    static const char* Digits = "0123456789abcdef";
+    std::string Key(16, '0');
+    for (unsigned DigitIdx = 0; DigitIdx < 16; ++DigitIdx) {
+        Key[15 - DigitIdx] = Digits[(Hash >> (DigitIdx * 4)) & 0xF];
+    }
+
+    return Key;
+}
+
+unsigned
+ProgramCache::Load(const std::string& key) {
+    if (!IsSupported()) {
+        return 0;
+    }
+
+    std::ifstream In(GetCachePath(key), std::ios::binary);
+    uint32_t Magic = 0;
+    uint32_t Format = 0;
+    uint32_t Length = 0;
+    In.read(reinterpret_cast<char*>(&Magic), sizeof(Magic));
+    In.read(reinterpret_cast<char*>(&Format), sizeof(Format));
+    In.read(reinterpret_cast<char*>(&Length), sizeof(Length));
+    if (!In || Magic != CacheMagic || !Length) {
+        ++CacheMisses;
+        return 0;
+    }
+
+    std::vector<char> Binary(Length);
+    In.read(Binary.data(), Length);
+    if (!In) {
+        ++CacheMisses;
+        return 0;
+    }
+
+    unsigned ProgramID = glCreateProgram();
+    glProgramBinary(ProgramID, Format, Binary.data(), Length);
+    int Success;
+    glGetProgramiv(ProgramID, GL_LINK_STATUS, &Success);
+    if (!Success) {
+        // NOTE: Driver refused the binary, caller compiles from source and overwrites the entry
+        glDeleteProgram(ProgramID);
+        ++CacheRejects;
+        ++CacheMisses;
+        return 0;
+    }
+
+    ++CacheHits;
+    return ProgramID;
+}
+
+void
+ProgramCache::Store(const std::string& key, unsigned program) {
+    if (!IsSupported()) {
+        return;
+    }
+
+    int Length = 0;
+    glGetProgramiv(program, GL_PROGRAM_BINARY_LENGTH, &Length);
+    if (Length <= 0) {
+        return;
+    }
+
+    std::vector<char> Binary(Length);
+    GLenum Format = 0;
+    glGetProgramBinary(program, Length, 0, &Format, Binary.data());
+
+#ifdef _WIN32
+    _mkdir(CacheDirectory);
+#else
+    mkdir(CacheDirectory, 0755);
+#endif
+    std::ofstream Out(GetCachePath(key), std::ios::binary | std::ios::trunc);
+    uint32_t Format32 = Format;
+    uint32_t Length32 = Length;
+    Out.write(reinterpret_cast<const char*>(&CacheMagic), sizeof(CacheMagic));
+    Out.write(reinterpret_cast<const char*>(&Format32), sizeof(Format32));
+    Out.write(reinterpret_cast<const char*>(&Length32), sizeof(Length32));
+    Out.write(Binary.data(), Length);
+    if (!Out) {
+        std::cerr << "[Err] Failed to write shader cache entry " << key << std::endl;
+    }
+}
+
+bool
+ProgramCache::IsSupported() {
+    if (!GLEW_ARB_get_program_binary) {
+        return false;
+    }
+
+    // NOTE: Drivers may expose the extension with zero binary formats, in which case nothing can be saved
+    int FormatCount = 0;
+    glGetIntegerv(GL_NUM_PROGRAM_BINARY_FORMATS, &FormatCount);
+    return FormatCount > 0;
+}
+
+void
+ProgramCache::PrintStats() {
+    unsigned Lookups = CacheHits + CacheMisses;
+    std::cout << "Shader cache: " << CacheHits << " hits, " << CacheMisses << " misses";
+    if (CacheRejects) {
+        std::cout << " (" << CacheRejects << " rejected by driver)";
+    }
+    if (Lookups) {
+        std::cout << ", " << (100 * CacheHits) / Lookups << "% hit rate";
+    }
+    std::cout << std::endl;
+}
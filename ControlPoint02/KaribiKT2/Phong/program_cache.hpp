@@ -0,0 +1,53 @@
+/**
+ * @file program_cache.hpp
+ * @brief On-disk cache of linked shader program binaries
+ *
+ */
+
+#pragma once
+#include <string>
+#include <GL/glew.h>
+
+class ProgramCache {
+public:
+    /**
+     * @brief Returns cache key for a program. Hashes both stages' final source
+     * (defines included) together with the driver vendor, renderer and version,
+     * so a driver update invalidates old binaries
+     *
+     * @param vSource Vertex shader source
+     * @param fSource Fragment shader source
+     *
+     * @returns Hex string key
+     */
+    static std::string MakeKey(const std::string& vSource, const std::string& fSource);
+
+    /**
+     * @brief Creates a program from a cached binary
+     *
+     * @param key Cache key
+     *
+     * @returns Linked program ID, 0 if missing or rejected by the driver
+     */
+    static unsigned Load(const std::string& key);
+
+    /**
+     * @brief Saves a linked program's binary under the key
+     *
+     * @param key Cache key
+     * @param program Linked program, should be linked with the retrievable hint
+     */
+    static void Store(const std::string& key, unsigned program);
+
+    /**
+     * @brief Returns whether the driver can save and load program binaries
+     *
+     */
+    static bool IsSupported();
+
+    /**
+     * @brief Prints hits, misses and hit rate since startup
+     *
+     */
+    static void PrintStats();
+};
@@ -0,0 +1,592 @@
+#include "render_queue.hpp"
+#include <algorithm>
+#include <chrono>
+#include <iostream>
+
+// NOTE: Key layout from the most significant bit. Opaque draws are grouped by state and
+// go front-to-back inside a group, translucent ones go strictly back-to-front
+//   opaque:      layer:2 | program:8 | material:16 | vao:8 | depth:24
+//   translucent: layer:2 | inverted depth:24 | program:8 | material:16
+static const unsigned DepthBits = 24;
+static const uint64_t DepthMask = (1ull << DepthBits) - 1;
+// NOTE: Model matrix columns followed by normal matrix columns
+static const unsigned DrawDataTexels = 7;
+// NOTE: Below this many packets per thread the hand off costs more than it saves
+static const unsigned MinSliceSize = 256;
+
+static double
+MsSince(const std::chrono::high_resolution_clock::time_point& start) {
+    return std::chrono::duration<double, std::milli>(std::chrono::high_resolution_clock::now() - start).count();
+}
+
+static uint64_t
+MaterialBits(const DrawPacket& packet) {
+    return ((packet.DiffuseTexture & 0xFF) << 8) | (packet.SpecularTexture & 0xFF);
+}
+
+RenderQueue::RenderQueue() : mFarPlane(1.0f), mLastDrawCount(0), mLastCulledCount(0), mLastUnsortedChanges(0), mLastSortedChanges(0),
+    mLastMergeMs(0.0), mIndirectProgram(0), mDrawDataBuffer(0), mDrawDataTexture(0), mCommandBuffer(0), mDrawIdBuffer(0), mDrawIdCapacity(0),
+    mLastIndirectCalls(0), mLastIndirectDraws(0), mRecordedSliceCount(0), mRecordedIndirectProgram(0), mRecordedLights(false), mRecordedOcclusion(false),
+    mCommandReuse(true), mLights(0), mOcclusion(0), mRecordCount(0), mReplayCount(0) {}
+
+bool
+RenderQueue::IsIndirectSupported() {
+    return GLEW_VERSION_4_3 || (GLEW_ARB_draw_indirect && GLEW_ARB_base_instance);
+}
+
+void
+RenderQueue::SetIndirectProgram(const Shader* program) {
+    mIndirectProgram = program;
+}
+
+void
+RenderQueue::SetCommandReuse(bool reuse) {
+    mCommandReuse = reuse;
+}
+
+void
+RenderQueue::Begin(const glm::vec3& viewPosition, const glm::vec3& viewDirection, float farPlane, const glm::mat4& viewProjection) {
+    mPackets.clear();
+    mItems.clear();
+    mFrustum = Frustum(viewProjection);
+    mViewPosition = viewPosition;
+    mViewDirection = glm::normalize(viewDirection);
+    mFarPlane = farPlane;
+}
+
+void
+RenderQueue::Push(const DrawPacket& packet) {
+    mPackets.push_back(packet);
+}
+
+void
+RenderQueue::cullSlice(Slice& slice, unsigned begin, unsigned end, SoftwareOcclusion* occluders) {
+    // NOTE: Padding lets the SIMD test read whole groups of four
+    const unsigned Count = end - begin;
+    const unsigned Padded = (Count + 3) & ~3u;
+    for (unsigned Axis = 0; Axis < 3; ++Axis) {
+        slice.Centers[Axis].assign(Padded, 0.0f);
+        slice.Extents[Axis].assign(Padded, 0.0f);
+        slice.SphereCenters[Axis].assign(Padded, 0.0f);
+    }
+    slice.Radii.assign(Padded, 0.0f);
+    slice.Visible.resize(Count);
+    for (unsigned PacketIdx = begin; PacketIdx < end; ++PacketIdx) {
+        const DrawPacket& Packet = mPackets[PacketIdx];
+        glm::vec3 Center = Packet.Bounds->GetCenter();
+        glm::vec3 Extents = Packet.Bounds->GetExtents();
+        BoundingSphere Sphere = Packet.Sphere ? *Packet.Sphere : BoundingSphere(Center, glm::length(Extents));
+        for (unsigned Axis = 0; Axis < 3; ++Axis) {
+            slice.Centers[Axis][PacketIdx - begin] = Center[Axis];
+            slice.Extents[Axis][PacketIdx - begin] = Extents[Axis];
+            slice.SphereCenters[Axis][PacketIdx - begin] = Sphere.Center[Axis];
+        }
+        slice.Radii[PacketIdx - begin] = Sphere.Radius;
+    }
+
+    const float* Centers[3] = { slice.Centers[0].data(), slice.Centers[1].data(), slice.Centers[2].data() };
+    const float* Extents[3] = { slice.Extents[0].data(), slice.Extents[1].data(), slice.Extents[2].data() };
+    const float* SphereCenters[3] = { slice.SphereCenters[0].data(), slice.SphereCenters[1].data(), slice.SphereCenters[2].data() };
+    mFrustum.CullPacked(Centers, Extents, SphereCenters, slice.Radii.data(), Count, slice.Visible.data());
+
+    slice.Items.clear();
+    for (unsigned PacketIdx = begin; PacketIdx < end; ++PacketIdx) {
+        const DrawPacket& Packet = mPackets[PacketIdx];
+        if (slice.Visible[PacketIdx - begin] && (!occluders || occluders->IsVisible(*Packet.Bounds))) {
+            SortItem Item = { makeKey(Packet), PacketIdx };
+            slice.Items.push_back(Item);
+        }
+    }
+    slice.CulledCount = Count - slice.Items.size();
+    slice.UnsortedChanges = countStateChanges(slice.Items);
+    if (!slice.Items.empty()) {
+        radixSort(slice.Items, slice.Scratch);
+    }
+}
+
+uint64_t
+RenderQueue::makeKey(const DrawPacket& packet) const {
+    float Depth = glm::dot(packet.Bounds->GetCenter() - mViewPosition, mViewDirection) / mFarPlane;
+    uint64_t DepthKey = static_cast<uint64_t>(std::min(std::max(Depth, 0.0f), 1.0f) * DepthMask);
+    uint64_t Program = packet.Program->GetId() & 0xFF;
+    uint64_t Layer = packet.Layer & 0x3;
+
+    if (packet.Layer == LAYER_OPAQUE) {
+        return (Layer << 62) | (Program << 54) | (MaterialBits(packet) << 38) | ((packet.VAO & 0xFFull) << 30) | DepthKey;
+    }
+    return (Layer << 62) | ((DepthMask - DepthKey) << 38) | (Program << 30) | (MaterialBits(packet) << 14);
+}
+
+void
+RenderQueue::radixSort(std::vector<SortItem>& items, std::vector<SortItem>& scratch) {
+    // NOTE: LSD radix sort, one pass per key byte. Passes where every key has the
+    // same byte are skipped, which is most of them for a scene this size
+    const unsigned Count = items.size();
+    scratch.resize(Count);
+    for (unsigned Shift = 0; Shift < 64; Shift += 8) {
+        unsigned Histogram[256] = { 0 };
+        for (unsigned ItemIdx = 0; ItemIdx < Count; ++ItemIdx) {
+            ++Histogram[(items[ItemIdx].Key >> Shift) & 0xFF];
+        }
+        if (Histogram[(items[0].Key >> Shift) & 0xFF] == Count) {
+            continue;
+        }
+
+        unsigned Offset = 0;
+        for (unsigned Bucket = 0; Bucket < 256; ++Bucket) {
+            unsigned BucketSize = Histogram[Bucket];
+            Histogram[Bucket] = Offset;
+            Offset += BucketSize;
+        }
+        for (unsigned ItemIdx = 0; ItemIdx < Count; ++ItemIdx) {
+            scratch[Histogram[(items[ItemIdx].Key >> Shift) & 0xFF]++] = items[ItemIdx];
+        }
+        items.swap(scratch);
+    }
+}
+
+unsigned
+RenderQueue::countStateChanges(const std::vector<SortItem>& items) const {
+    const Shader* Program = 0;
+    unsigned VAO = 0;
+    unsigned Diffuse = 0;
+    unsigned Specular = 0;
+    unsigned Changes = 0;
+    for (unsigned ItemIdx = 0; ItemIdx < items.size(); ++ItemIdx) {
+        const DrawPacket& Packet = mPackets[items[ItemIdx].Packet];
+        Changes += Packet.Program != Program;
+        Program = Packet.Program;
+        if (Packet.Mesh) {
+            // NOTE: Counted as one change, the model rebinds everything itself
+            ++Changes;
+            VAO = Diffuse = Specular = 0xFFFFFFFF;
+            continue;
+        }
+        Changes += Packet.VAO != VAO;
+        Changes += Packet.DiffuseTexture != Diffuse;
+        Changes += Packet.SpecularTexture != Specular;
+        VAO = Packet.VAO;
+        Diffuse = Packet.DiffuseTexture;
+        Specular = Packet.SpecularTexture;
+    }
+    return Changes;
+}
+
+void
+RenderQueue::merge() {
+    // NOTE: Slices are in submission order and ties go to the earlier slice, so the
+    // result is the same as sorting all items at once
+    mHeads.assign(mSlices.size(), 0);
+    mItems.clear();
+    for (;;) {
+        const SortItem* Best = 0;
+        unsigned BestSlice = 0;
+        for (unsigned SliceIdx = 0; SliceIdx < mSlices.size(); ++SliceIdx) {
+            const std::vector<SortItem>& Items = mSlices[SliceIdx].Items;
+            if (mHeads[SliceIdx] < Items.size() && (!Best || Items[mHeads[SliceIdx]].Key < Best->Key)) {
+                Best = &Items[mHeads[SliceIdx]];
+                BestSlice = SliceIdx;
+            }
+        }
+        if (!Best) {
+            return;
+        }
+        mItems.push_back(*Best);
+        ++mHeads[BestSlice];
+    }
+}
+
+void
+RenderQueue::Submit(LightManager* lights, OcclusionCuller* occlusion, SoftwareOcclusion* occluders, ThreadPool* workers) {
+    const unsigned ThreadCount = workers ? workers->GetThreadCount() : 1;
+    const unsigned PacketCount = mPackets.size();
+    mCullMs.assign(ThreadCount, 0.0);
+    mRecordMs.assign(ThreadCount, 0.0);
+    mSlices.resize(std::max(1u, std::min(ThreadCount, PacketCount / MinSliceSize)));
+
+    // NOTE: Rasterization ran alongside everything since Begin, usually it is already done here
+    if (occluders) {
+        occluders->Wait();
+    }
+    ThreadPool::RangeJob Cull = [&](unsigned begin, unsigned end, unsigned thread) {
+        std::chrono::high_resolution_clock::time_point Start = std::chrono::high_resolution_clock::now();
+        for (unsigned SliceIdx = begin; SliceIdx < end; ++SliceIdx) {
+            cullSlice(mSlices[SliceIdx], PacketCount * SliceIdx / mSlices.size(), PacketCount * (SliceIdx + 1) / mSlices.size(), occluders);
+        }
+        mCullMs[thread] += MsSince(Start);
+    };
+    if (workers) {
+        workers->ParallelFor(mSlices.size(), Cull);
+    } else {
+        Cull(0, mSlices.size(), 0);
+    }
+
+    std::chrono::high_resolution_clock::time_point MergeStart = std::chrono::high_resolution_clock::now();
+    mLastCulledCount = 0;
+    mLastUnsortedChanges = 0;
+    for (unsigned SliceIdx = 0; SliceIdx < mSlices.size(); ++SliceIdx) {
+        mLastCulledCount += mSlices[SliceIdx].CulledCount;
+        mLastUnsortedChanges += mSlices[SliceIdx].UnsortedChanges;
+    }
+    merge();
+    mLastMergeMs = MsSince(MergeStart);
+    mLastDrawCount = mItems.size();
+    mLastSortedChanges = countStateChanges(mItems);
+    if (mItems.empty()) {
+        return;
+    }
+    if (mIndirectProgram) {
+        // NOTE: Per object lights are uniforms, so with them every draw is its own run
+        prepareIndirect(lights != 0);
+    }
+
+    if (mCommandReuse && matchesRecording(lights != 0, occlusion != 0)) {
+        patch();
+    } else {
+        record(lights != 0, occlusion != 0, workers);
+    }
+    ++mReplayCount;
+    mLights = lights;
+    mOcclusion = occlusion;
+    for (unsigned SliceIdx = 0; SliceIdx < mRecordedSliceCount; ++SliceIdx) {
+        mSlices[SliceIdx].Commands.Execute();
+    }
+    mLights = 0;
+    mOcclusion = 0;
+
+    if (mIndirectProgram) {
+        glBindBuffer(GL_DRAW_INDIRECT_BUFFER, 0);
+    }
+    glActiveTexture(GL_TEXTURE1);
+    glBindTexture(GL_TEXTURE_2D, 0);
+    glBindVertexArray(0);
+}
+
+bool
+RenderQueue::matchesRecording(bool lights, bool occlusion) const {
+    if (mRecorded.size() != mItems.size() || mRecordedSliceCount != mSlices.size() || mRecordedIndirectProgram != mIndirectProgram
+        || mRecordedLights != lights || mRecordedOcclusion != occlusion) {
+        return false;
+    }
+    for (unsigned ItemIdx = 0; ItemIdx < mItems.size(); ++ItemIdx) {
+        const DrawPacket& Packet = mPackets[mItems[ItemIdx].Packet];
+        const RecordedDraw& Draw = mRecorded[ItemIdx];
+        if (Draw.Program != Packet.Program->GetId() || Draw.Mesh != Packet.Mesh || Draw.VAO != Packet.VAO
+            || Draw.VertexCount != Packet.VertexCount || Draw.InstanceCount != Packet.InstanceCount
+            || Draw.DiffuseTexture != Packet.DiffuseTexture || Draw.SpecularTexture != Packet.SpecularTexture
+            || Draw.Layer != Packet.Layer) {
+            return false;
+        }
+    }
+    return true;
+}
+
+void
+RenderQueue::record(bool lights, bool occlusion, ThreadPool* workers) {
+    // NOTE: Everything that may differ between replays of the same draws goes through
+    // a patch or a callback: matrices, per object lights, occlusion and model draws
+    mRecorded.resize(mItems.size());
+    MatrixPatch NoPatch = { 0, ~0u, ~0u };
+    mPatches.assign(mItems.size(), NoPatch);
+    mRecordedSliceCount = mSlices.size();
+    mRecordedIndirectProgram = mIndirectProgram;
+    mRecordedLights = lights;
+    mRecordedOcclusion = occlusion;
+    ++mRecordCount;
+
+    // NOTE: Looked up here, recording itself makes no GL calls so it can run on any thread
+    const Shader* Program = 0;
+    for (unsigned ItemIdx = 0; ItemIdx < mItems.size(); ++ItemIdx) {
+        const Shader* ItemProgram = mPackets[mItems[ItemIdx].Packet].Program;
+        if (ItemProgram != Program && !mLocations.count(ItemProgram->GetId())) {
+            UniformLocations Locations = { glGetUniformLocation(ItemProgram->GetId(), "uModel"),
+                glGetUniformLocation(ItemProgram->GetId(), "uNormalMatrix") };
+            mLocations[ItemProgram->GetId()] = Locations;
+        }
+        Program = ItemProgram;
+    }
+
+    ThreadPool::RangeJob Record = [&](unsigned begin, unsigned end, unsigned thread) {
+        std::chrono::high_resolution_clock::time_point Start = std::chrono::high_resolution_clock::now();
+        for (unsigned SliceIdx = begin; SliceIdx < end; ++SliceIdx) {
+            recordSlice(SliceIdx, lights, occlusion);
+        }
+        mRecordMs[thread] += MsSince(Start);
+    };
+    if (workers) {
+        workers->ParallelFor(mSlices.size(), Record);
+    } else {
+        Record(0, mSlices.size(), 0);
+    }
+
+    mLastIndirectCalls = 0;
+    mLastIndirectDraws = 0;
+    for (unsigned SliceIdx = 0; SliceIdx < mSlices.size(); ++SliceIdx) {
+        mLastIndirectCalls += mSlices[SliceIdx].IndirectCalls;
+        mLastIndirectDraws += mSlices[SliceIdx].IndirectDraws;
+    }
+}
+
+void
+RenderQueue::recordSlice(unsigned sliceIdx, bool lights, bool occlusion) {
+    Slice& Current = mSlices[sliceIdx];
+    CommandList& Commands = Current.Commands;
+    Commands.Clear();
+    Current.IndirectCalls = 0;
+    Current.IndirectDraws = 0;
+    const unsigned Begin = mItems.size() * sliceIdx / mSlices.size();
+    const unsigned End = mItems.size() * (sliceIdx + 1) / mSlices.size();
+
+    // NOTE: 0xFFFFFFFF marks state as unknown, e.g. at the start of a slice or after a model bound its own
+    const Shader* Program = 0;
+    UniformLocations Locations = { -1, -1 };
+    unsigned VAO = 0xFFFFFFFF;
+    unsigned Diffuse = 0xFFFFFFFF;
+    unsigned Specular = 0xFFFFFFFF;
+    for (unsigned ItemIdx = Begin; ItemIdx < End; ++ItemIdx) {
+        const DrawPacket& Packet = mPackets[mItems[ItemIdx].Packet];
+        RecordedDraw Draw = { Packet.Program->GetId(), Packet.Mesh, Packet.VAO, Packet.VertexCount, Packet.InstanceCount,
+            Packet.DiffuseTexture, Packet.SpecularTexture, Packet.Layer };
+        mRecorded[ItemIdx] = Draw;
+        const bool Indirect = Packet.Program == mIndirectProgram;
+        if (Indirect && !Packet.Mesh && Packet.InstanceCount <= 1 && !mRuns[ItemIdx].Count) {
+            // NOTE: Drawn by a run that started in an earlier slice
+            continue;
+        }
+
+        // NOTE: Translucent draws must not hide anything from the queries. Layers are
+        // the top key bits, so the first translucent item follows the last opaque one
+        if (occlusion && Packet.Layer != LAYER_OPAQUE && (!ItemIdx || mPackets[mItems[ItemIdx - 1].Packet].Layer == LAYER_OPAQUE)) {
+            Commands.Call(&RenderQueue::issueQueriesCommand, this, 0);
+            Program = 0;
+            VAO = 0xFFFFFFFF;
+        }
+        if (Packet.Program != Program) {
+            Program = Packet.Program;
+            Commands.UseProgram(Program->GetId());
+            Locations = mLocations.find(Program->GetId())->second;
+        }
+        if (!Indirect) {
+            MatrixPatch Patch = { sliceIdx, Commands.UniformMatrix4(Locations.Model, *Packet.ModelMatrix),
+                Commands.UniformMatrix3(Locations.Normal, *Packet.NormalMatrix) };
+            mPatches[ItemIdx] = Patch;
+        }
+        // NOTE: Only the forward path culls per object, clusters already limit lights per fragment
+        if (lights) {
+            Commands.Call(&RenderQueue::uploadLightsCommand, this, ItemIdx);
+        }
+
+        if (Packet.DiffuseTexture && Packet.DiffuseTexture != Diffuse) {
+            Commands.BindTexture(0, Packet.DiffuseTexture);
+            Diffuse = Packet.DiffuseTexture;
+        }
+        if (Packet.SpecularTexture != Specular) {
+            Commands.BindTexture(1, Packet.SpecularTexture);
+            Specular = Packet.SpecularTexture;
+        }
+
+        if (Packet.Mesh) {
+            Commands.Call(&RenderQueue::drawModelCommand, this, ItemIdx);
+            VAO = Diffuse = Specular = 0xFFFFFFFF;
+            continue;
+        }
+        if (Packet.VAO != VAO) {
+            Commands.BindVertexArray(Packet.VAO);
+            VAO = Packet.VAO;
+        }
+        if (Indirect) {
+            recordIndirect(Current, mRuns[ItemIdx]);
+            continue;
+        }
+        if (Packet.InstanceCount > 1) {
+            Commands.DrawArraysInstanced(0, Packet.VertexCount, Packet.InstanceCount);
+        } else {
+            Commands.DrawArrays(0, Packet.VertexCount);
+        }
+    }
+    if (occlusion && End == mItems.size() && mPackets[mItems[End - 1].Packet].Layer == LAYER_OPAQUE) {
+        Commands.Call(&RenderQueue::issueQueriesCommand, this, 0);
+    }
+}
+
+void
+RenderQueue::patch() {
+    for (unsigned ItemIdx = 0; ItemIdx < mItems.size(); ++ItemIdx) {
+        const MatrixPatch& Patch = mPatches[ItemIdx];
+        if (Patch.Model != ~0u) {
+            const DrawPacket& Packet = mPackets[mItems[ItemIdx].Packet];
+            CommandList& Commands = mSlices[Patch.List].Commands;
+            Commands.PatchMatrix4(Patch.Model, *Packet.ModelMatrix);
+            Commands.PatchMatrix3(Patch.Normal, *Packet.NormalMatrix);
+        }
+    }
+}
+
+void
+RenderQueue::uploadLightsCommand(void* queue, unsigned item) {
+    RenderQueue* Queue = static_cast<RenderQueue*>(queue);
+    const DrawPacket& Packet = Queue->mPackets[Queue->mItems[item].Packet];
+    Queue->mLights->UploadForBounds(*Packet.Program, *Packet.Bounds);
+}
+
+void
+RenderQueue::drawModelCommand(void* queue, unsigned item) {
+    RenderQueue* Queue = static_cast<RenderQueue*>(queue);
+    const DrawPacket& Packet = Queue->mPackets[Queue->mItems[item].Packet];
+    OcclusionCuller* Occlusion = Queue->mOcclusion;
+    const void* Identity = Packet.Identity ? Packet.Identity : Packet.ModelMatrix;
+    // NOTE: Only models are worth a query, a proxy box costs as much as drawing a cube
+    bool Conditional = Occlusion && Occlusion->BeginDraw(Identity);
+    if (Packet.Program == Queue->mIndirectProgram) {
+        // NOTE: Model VAOs have no draw id array, so the attribute's current value is read instead
+        glVertexAttrib1f(DRAW_ID_ATTRIBUTE, static_cast<float>(Queue->mRuns[item].DrawId));
+    }
+    Packet.Mesh->Render();
+    if (Conditional) {
+        Occlusion->EndDraw();
+    }
+    if (Occlusion) {
+        Occlusion->Test(Identity, *Packet.Bounds);
+    }
+}
+
+void
+RenderQueue::issueQueriesCommand(void* queue, unsigned) {
+    static_cast<RenderQueue*>(queue)->mOcclusion->IssueQueries();
+}
+
+void
+RenderQueue::prepareIndirect(bool splitRuns) {
+    if (!mDrawDataBuffer) {
+        glGenBuffers(1, &mDrawDataBuffer);
+        glGenTextures(1, &mDrawDataTexture);
+        glGenBuffers(1, &mCommandBuffer);
+        glGenBuffers(1, &mDrawIdBuffer);
+    }
+
+    // NOTE: Draw ids are assigned in sorted order and commands of a run are consecutive,
+    // so one multi draw covers the run
+    mDrawData.clear();
+    mCommands.clear();
+    IndirectRun Empty = { 0, 0, 0 };
+    mRuns.assign(mItems.size(), Empty);
+    unsigned DrawId = 0;
+    unsigned RunStart = 0;
+    bool InRun = false;
+    for (unsigned ItemIdx = 0; ItemIdx < mItems.size(); ++ItemIdx) {
+        const DrawPacket& Packet = mPackets[mItems[ItemIdx].Packet];
+        if (Packet.Program != mIndirectProgram) {
+            InRun = false;
+            continue;
+        }
+
+        const glm::mat4& Model = *Packet.ModelMatrix;
+        const glm::mat3& Normal = *Packet.NormalMatrix;
+        mDrawData.push_back(Model[0]);
+        mDrawData.push_back(Model[1]);
+        mDrawData.push_back(Model[2]);
+        mDrawData.push_back(Model[3]);
+        mDrawData.push_back(glm::vec4(Normal[0], 0.0f));
+        mDrawData.push_back(glm::vec4(Normal[1], 0.0f));
+        mDrawData.push_back(glm::vec4(Normal[2], 0.0f));
+        mRuns[ItemIdx].DrawId = DrawId;
+        if (Packet.Mesh || Packet.InstanceCount > 1) {
+            InRun = false;
+            ++DrawId;
+            continue;
+        }
+
+        const DrawPacket* First = InRun ? &mPackets[mItems[RunStart].Packet] : 0;
+        if (!First || splitRuns || First->VAO != Packet.VAO || First->DiffuseTexture != Packet.DiffuseTexture
+            || First->SpecularTexture != Packet.SpecularTexture || First->Layer != Packet.Layer) {
+            RunStart = ItemIdx;
+            mRuns[RunStart].FirstCommand = mCommands.size();
+            InRun = true;
+            if (mDrawIdVAOs.insert(Packet.VAO).second) {
+                attachDrawIds(Packet.VAO);
+            }
+        }
+        ++mRuns[RunStart].Count;
+        DrawArraysCommand Command = { Packet.VertexCount, 1, 0, DrawId++ };
+        mCommands.push_back(Command);
+    }
+
+    if (DrawId > mDrawIdCapacity) {
+        mDrawIdCapacity = std::max(DrawId, 2 * mDrawIdCapacity);
+        std::vector<float> Ids(mDrawIdCapacity);
+        for (unsigned Id = 0; Id < mDrawIdCapacity; ++Id) {
+            Ids[Id] = static_cast<float>(Id);
+        }
+        glBindBuffer(GL_ARRAY_BUFFER, mDrawIdBuffer);
+        glBufferData(GL_ARRAY_BUFFER, Ids.size() * sizeof(float), Ids.data(), GL_STATIC_DRAW);
+        glBindBuffer(GL_ARRAY_BUFFER, 0);
+    }
+
+    // NOTE: Orphaning first, last frame's draws may still be reading the old contents
+    glBindBuffer(GL_TEXTURE_BUFFER, mDrawDataBuffer);
+    glBufferData(GL_TEXTURE_BUFFER, mDrawData.size() * sizeof(glm::vec4), 0, GL_STREAM_DRAW);
+    glBufferSubData(GL_TEXTURE_BUFFER, 0, mDrawData.size() * sizeof(glm::vec4), mDrawData.data());
+    glBindBuffer(GL_TEXTURE_BUFFER, 0);
+    glActiveTexture(GL_TEXTURE0 + DRAW_DATA_TEXTURE_UNIT);
+    glBindTexture(GL_TEXTURE_BUFFER, mDrawDataTexture);
+    glTexBuffer(GL_TEXTURE_BUFFER, GL_RGBA32F, mDrawDataBuffer);
+    glActiveTexture(GL_TEXTURE0);
+
+    glBindBuffer(GL_DRAW_INDIRECT_BUFFER, mCommandBuffer);
+    glBufferData(GL_DRAW_INDIRECT_BUFFER, mCommands.size() * sizeof(DrawArraysCommand), 0, GL_STREAM_DRAW);
+    glBufferSubData(GL_DRAW_INDIRECT_BUFFER, 0, mCommands.size() * sizeof(DrawArraysCommand), mCommands.data());
+}
+
+void
+RenderQueue::attachDrawIds(unsigned vao) {
+    // NOTE: Done once per VAO, base instance then picks each draw's element of the array
+    glBindVertexArray(vao);
+    glBindBuffer(GL_ARRAY_BUFFER, mDrawIdBuffer);
+    glVertexAttribPointer(DRAW_ID_ATTRIBUTE, 1, GL_FLOAT, GL_FALSE, sizeof(float), (void*)0);
+    glEnableVertexAttribArray(DRAW_ID_ATTRIBUTE);
+    glVertexAttribDivisor(DRAW_ID_ATTRIBUTE, 1);
+    glBindBuffer(GL_ARRAY_BUFFER, 0);
+    glBindVertexArray(0);
+}
+
+void
+RenderQueue::recordIndirect(Slice& slice, const IndirectRun& run) {
+    const unsigned Offset = run.FirstCommand * sizeof(DrawArraysCommand);
+    if (GLEW_VERSION_4_3 || GLEW_ARB_multi_draw_indirect) {
+        slice.Commands.MultiDrawArraysIndirect(Offset, run.Count);
+        ++slice.IndirectCalls;
+    } else {
+        for (unsigned CommandIdx = 0; CommandIdx < run.Count; ++CommandIdx) {
+            slice.Commands.DrawArraysIndirect(Offset + CommandIdx * sizeof(DrawArraysCommand));
+        }
+        slice.IndirectCalls += run.Count;
+    }
+    slice.IndirectDraws += run.Count;
+}
+
+void
+RenderQueue::PrintStats() const {
+    std::cout << "Render queue: " << mLastDrawCount << " draws submitted, " << mLastCulledCount << " culled, state changes "
+        << mLastUnsortedChanges << " in submission order, " << mLastSortedChanges << " sorted" << std::endl;
+    if (mIndirectProgram) {
+        std::cout << "Indirect: " << mLastIndirectDraws << " draws in " << mLastIndirectCalls << " calls" << std::endl;
+    }
+    unsigned CommandCount = 0;
+    unsigned CommandBytes = 0;
+    for (unsigned SliceIdx = 0; SliceIdx < mRecordedSliceCount; ++SliceIdx) {
+        CommandCount += mSlices[SliceIdx].Commands.GetCommandCount();
+        CommandBytes += mSlices[SliceIdx].Commands.GetSize();
+    }
+    std::cout << "Command lists: " << CommandCount << " commands in " << CommandBytes << " bytes over " << mRecordedSliceCount
+        << " slices, recorded in " << mRecordCount << " of " << mReplayCount << " frames" << std::endl;
+    std::cout << "Queue threads (cull and sort / record ms):";
+    for (unsigned Thread = 0; Thread < mCullMs.size(); ++Thread) {
+        std::cout << " " << Thread << ": " << mCullMs[Thread] << " / " << mRecordMs[Thread];
+    }
+    std::cout << ", merge " << mLastMergeMs << " ms" << std::endl;
+}
+
+const Frustum&
+RenderQueue::GetFrustum() const {
+    return mFrustum;
+}
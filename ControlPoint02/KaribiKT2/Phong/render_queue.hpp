@@ -0,0 +1,255 @@
+/**
+ * @file render_queue.hpp
+ * @brief Collects draw packets for a frame, culls them against the view frustum and
+ * submits the rest ordered by a 64 bit sort key
+ *
+ */
+
+#pragma once
+#include <cstdint>
+#include <unordered_map>
+#include <unordered_set>
+#include <vector>
+#include <GL/glew.h>
+#include <glm/glm.hpp>
+#include "shader.hpp"
+#include "model.hpp"
+#include "bounds.hpp"
+#include "command_list.hpp"
+#include "frustum.hpp"
+#include "light_manager.hpp"
+#include "occlusion_culler.hpp"
+#include "software_occlusion.hpp"
+#include "thread_pool.hpp"
+
+enum ERenderLayer {
+    LAYER_OPAQUE = 0,
+    LAYER_TRANSLUCENT = 1,
+};
+
+/**
+ * @brief Everything needed to issue one draw. Matrices and bounds are pointed to,
+ * so they have to stay alive until RenderQueue::Submit
+ */
+struct DrawPacket {
+    const Shader* Program;
+    unsigned VAO;
+    unsigned VertexCount;
+    // NOTE: If set, the model is drawn instead of VAO and binds its own buffers and textures
+    Model* Mesh;
+    unsigned DiffuseTexture;
+    unsigned SpecularTexture;
+    unsigned Layer;
+    const glm::mat4* ModelMatrix;
+    const glm::mat3* NormalMatrix;
+    const AABB* Bounds;
+    // NOTE: Optional, tightens culling of objects that fill their box poorly
+    const BoundingSphere* Sphere;
+    // NOTE: Above 1 the VAO is drawn instanced, Bounds must then cover every instance.
+    // Instanced packets cannot use the indirect program
+    unsigned InstanceCount;
+    // NOTE: Keys the model's occlusion query, it has to be the same every frame.
+    // 0 uses ModelMatrix, which is wrong when the matrix is a per frame copy
+    const void* Identity;
+};
+
+class RenderQueue {
+public:
+    // NOTE: Past the units of the ocean maps
+    static const unsigned DRAW_DATA_TEXTURE_UNIT = 12;
+    // NOTE: Per draw attribute holding the draw's index into the draw data, see shaders/basic.vert
+    static const unsigned DRAW_ID_ATTRIBUTE = 4;
+
+    RenderQueue();
+
+    /**
+     * @brief Returns true if the driver can source draws from GL_DRAW_INDIRECT_BUFFER with a base instance
+     *
+     */
+    static bool IsIndirectSupported();
+
+    /**
+     * @brief Packets using this program have their matrices written to a shared draw data buffer
+     * and runs of them with the same state are drawn with one glMultiDrawArraysIndirect.
+     * The program reads its transforms from there (INDIRECT_DRAW), so uniforms are not set per draw
+     *
+     * @param program Indirect program, 0 draws every packet one by one
+     */
+    void SetIndirectProgram(const Shader* program);
+
+    /**
+     * @brief Submit records its draws into a command list. While the sorted draws keep
+     * the same state from frame to frame, only their matrices are patched into the
+     * recorded list and it is replayed, otherwise it is recorded again
+     *
+     * @param reuse False records the list every frame
+     */
+    void SetCommandReuse(bool reuse);
+
+    /**
+     * @brief Clears the queue for a new frame
+     *
+     * @param viewPosition Camera position
+     * @param viewDirection Camera forward direction
+     * @param farPlane Depth that maps to the end of the key depth range
+     * @param viewProjection Projection * view, packets outside its frustum are dropped
+     */
+    void Begin(const glm::vec3& viewPosition, const glm::vec3& viewDirection, float farPlane, const glm::mat4& viewProjection);
+
+    /**
+     * @brief Queues a draw, its depth is taken from the center of its bounds. Bounds
+     * and key are only looked at in Submit
+     *
+     */
+    void Push(const DrawPacket& packet);
+
+    /**
+     * @brief Culls the queued packets, sorts the visible ones and draws them
+     *
+     * @param lights If set, each draw gets only the lights reaching its bounds
+     * @param occlusion If set, model draws are skipped when last frame's query on
+     * their box found them hidden. New queries are issued once the opaque layer is drawn
+     * @param occluders If set, packets that survive the frustum are also tested against
+     * this frame's software depth buffer, waiting for its rasterization to finish
+     * @param workers If set, the packets are split into slices that are culled, keyed, sorted
+     * and recorded into command lists on the pool's threads. The calling thread merges the
+     * sorted slices and executes the lists
+     */
+    void Submit(LightManager* lights, OcclusionCuller* occlusion = 0, SoftwareOcclusion* occluders = 0, ThreadPool* workers = 0);
+
+    /**
+     * @brief Prints submitted and culled counts and state changes of the last
+     * frame, in submission order and in sorted order, and the time each thread spent on it
+     *
+     */
+    void PrintStats() const;
+
+    /**
+     * @brief Returns the frustum set by Begin, callers may use it to skip pushing invisible packets
+     *
+     */
+    const Frustum& GetFrustum() const;
+
+private:
+    // NOTE: Everything a recorded command list depends on besides matrices and lights
+    struct RecordedDraw {
+        unsigned Program;
+        Model* Mesh;
+        unsigned VAO;
+        unsigned VertexCount;
+        unsigned InstanceCount;
+        unsigned DiffuseTexture;
+        unsigned SpecularTexture;
+        unsigned Layer;
+    };
+
+    // NOTE: Offsets of a draw's matrices in the command list of its slice, ~0u if it has none
+    struct MatrixPatch {
+        unsigned List;
+        unsigned Model;
+        unsigned Normal;
+    };
+
+    struct SortItem {
+        uint64_t Key;
+        unsigned Packet;
+    };
+
+    struct UniformLocations {
+        int Model;
+        int Normal;
+    };
+
+    // NOTE: Work of one thread. Packets are culled and sorted in submission order slices,
+    // commands are recorded for slices of the merged sorted items
+    struct Slice {
+        // NOTE: Bounds of the slice's packets packed for the SIMD frustum test
+        std::vector<float> Centers[3];
+        std::vector<float> Extents[3];
+        std::vector<float> SphereCenters[3];
+        std::vector<float> Radii;
+        std::vector<unsigned char> Visible;
+        std::vector<SortItem> Items;
+        std::vector<SortItem> Scratch;
+        unsigned CulledCount;
+        unsigned UnsortedChanges;
+        CommandList Commands;
+        unsigned IndirectCalls;
+        unsigned IndirectDraws;
+    };
+
+    // NOTE: Layout fixed by GL_DRAW_INDIRECT_BUFFER
+    struct DrawArraysCommand {
+        GLuint Count;
+        GLuint InstanceCount;
+        GLuint First;
+        GLuint BaseInstance;
+    };
+
+    // NOTE: Run starting at a sorted item, Count is 0 for items inside a run or outside the indirect program
+    struct IndirectRun {
+        unsigned FirstCommand;
+        unsigned Count;
+        unsigned DrawId;
+    };
+
+    std::vector<DrawPacket> mPackets;
+    std::vector<SortItem> mItems;
+    std::vector<Slice> mSlices;
+    std::vector<unsigned> mHeads;
+    Frustum mFrustum;
+    glm::vec3 mViewPosition;
+    glm::vec3 mViewDirection;
+    float mFarPlane;
+    unsigned mLastDrawCount;
+    unsigned mLastCulledCount;
+    unsigned mLastUnsortedChanges;
+    unsigned mLastSortedChanges;
+    // NOTE: Per pool thread, 0 being the calling thread
+    std::vector<double> mCullMs;
+    std::vector<double> mRecordMs;
+    double mLastMergeMs;
+
+    const Shader* mIndirectProgram;
+    std::vector<glm::vec4> mDrawData;
+    std::vector<DrawArraysCommand> mCommands;
+    std::vector<IndirectRun> mRuns;
+    std::unordered_set<unsigned> mDrawIdVAOs;
+    unsigned mDrawDataBuffer;
+    unsigned mDrawDataTexture;
+    unsigned mCommandBuffer;
+    unsigned mDrawIdBuffer;
+    unsigned mDrawIdCapacity;
+    unsigned mLastIndirectCalls;
+    unsigned mLastIndirectDraws;
+
+    std::unordered_map<unsigned, UniformLocations> mLocations;
+    std::vector<RecordedDraw> mRecorded;
+    std::vector<MatrixPatch> mPatches;
+    unsigned mRecordedSliceCount;
+    const Shader* mRecordedIndirectProgram;
+    bool mRecordedLights;
+    bool mRecordedOcclusion;
+    bool mCommandReuse;
+    // NOTE: Read by the list's callbacks while it is replayed
+    LightManager* mLights;
+    OcclusionCuller* mOcclusion;
+    unsigned mRecordCount;
+    unsigned mReplayCount;
+
+    uint64_t makeKey(const DrawPacket& packet) const;
+    void cullSlice(Slice& slice, unsigned begin, unsigned end, SoftwareOcclusion* occluders);
+    static void radixSort(std::vector<SortItem>& items, std::vector<SortItem>& scratch);
+    unsigned countStateChanges(const std::vector<SortItem>& items) const;
+    void merge();
+    void prepareIndirect(bool splitRuns);
+    void attachDrawIds(unsigned vao);
+    void recordIndirect(Slice& slice, const IndirectRun& run);
+    bool matchesRecording(bool lights, bool occlusion) const;
+    void record(bool lights, bool occlusion, ThreadPool* workers);
+    void recordSlice(unsigned sliceIdx, bool lights, bool occlusion);
+    void patch();
+    static void uploadLightsCommand(void* queue, unsigned item);
+    static void drawModelCommand(void* queue, unsigned item);
+    static void issueQueriesCommand(void* queue, unsigned item);
+};
@@ -0,0 +1,849 @@
+#include "scene.hpp"
+#include "hash.hpp"
+#include "texture.hpp"
+#include "transform.hpp"
+#include <fstream>
+#include <sstream>
+#include <iostream>
+#include <cmath>
+#include <algorithm>
+
+static const uint32_t SceneMagic = 0x4E435353; // "SSCN"
+static const uint32_t SceneVersion = 4;
+
+template<typename T>
+static void
+WriteValue(std::ofstream& out, const T& value) {
+    out.write(reinterpret_cast<const char*>(&value), sizeof(T));
+}
+
+template<typename T>
+static bool
+ReadValue(std::ifstream& in, T& value) {
+    return static_cast<bool>(in.read(reinterpret_cast<char*>(&value), sizeof(T)));
+}
+
+static void
+WriteString(std::ofstream& out, const std::string& str) {
+    WriteValue(out, static_cast<uint32_t>(str.size()));
+    out.write(str.data(), str.size());
+}
+
+static bool
+ReadString(std::ifstream& in, std::string& str) {
+    uint32_t Length;
+    if (!ReadValue(in, Length)) {
+        return false;
+    }
+    str.resize(Length);
+    return Length == 0 || static_cast<bool>(in.read(&str[0], Length));
+}
+
+// NOTE: Only used for plain data (ids, vectors, quaternions, animations)
+template<typename T>
+static void
+WriteArray(std::ofstream& out, const std::vector<T>& values) {
+    WriteValue(out, static_cast<uint32_t>(values.size()));
+    out.write(reinterpret_cast<const char*>(values.data()), values.size() * sizeof(T));
+}
+
+template<typename T>
+static bool
+ReadArray(std::ifstream& in, std::vector<T>& values) {
+    uint32_t Count;
+    if (!ReadValue(in, Count)) {
+        return false;
+    }
+    values.resize(Count);
+    return Count == 0 || static_cast<bool>(in.read(reinterpret_cast<char*>(values.data()), Count * sizeof(T)));
+}
+
+template<typename T>
+static void
+Permute(std::vector<T>& values, const std::vector<unsigned>& order) {
+    std::vector<T> Sorted(values.size());
+    for (unsigned Idx = 0; Idx < order.size(); ++Idx) {
+        Sorted[Idx] = values[order[Idx]];
+    }
+    values.swap(Sorted);
+}
+
+static bool
+ReadVec3(std::istringstream& line, glm::vec3& value) {
+    return static_cast<bool>(line >> value.x >> value.y >> value.z);
+}
+
+static std::string
+GetBinaryPath(const std::string& path) {
+    std::string::size_type Dot = path.find_last_of('.');
+    std::string::size_type Slash = path.find_last_of('/');
+    if (Dot == std::string::npos || (Slash != std::string::npos && Dot < Slash)) {
+        return path + ".bin";
+    }
+    return path.substr(0, Dot) + ".bin";
+}
+
+Scene::Scene() : mFirstDirty(0), mStaticBatching(true) {}
+
+void
+Scene::AddBuiltinMesh(const std::string& name, unsigned vao, unsigned vertexCount, const AABB& bounds, const float* vertices) {
+    MeshSlot Slot;
+    Slot.Name = name;
+    Slot.ModelIdx = -1;
+    Slot.VAO = vao;
+    Slot.VertexCount = vertexCount;
+    Slot.Bounds = bounds;
+    Slot.Sphere = BoundingSphere(bounds.GetCenter(), glm::length(bounds.GetExtents()));
+    if (vertices) {
+        Slot.Vertices.assign(vertices, vertices + 8 * vertexCount);
+    }
+    mMeshes.push_back(Slot);
+}
+
+bool
+Scene::Load(const std::string& path) {
+    std::ifstream TextFile(path);
+    if (!TextFile) {
+        std::cerr << "[Err] Failed to open scene " << path << std::endl;
+        return false;
+    }
+    std::stringstream Text;
+    Text << TextFile.rdbuf();
+    const std::string Source = Text.str();
+    const uint64_t SourceHash = HashFNV1a(Source);
+
+    std::string BinaryPath = GetBinaryPath(path);
+    if (!readBinary(BinaryPath, SourceHash)) {
+        if (!parseText(path, Source)) {
+            return false;
+        }
+        writeBinary(BinaryPath, SourceHash);
+    }
+
+    if (!loadResources()) {
+        return false;
+    }
+
+    unsigned EntityCount = mMeshIds.size();
+    mLocalMatrices.resize(EntityCount);
+    mModelMatrices.resize(EntityCount);
+    mNormalMatrices.resize(EntityCount);
+    mWorldBounds.resize(EntityCount);
+    mWorldSpheres.resize(EntityCount);
+    mDirty.assign(EntityCount, 0);
+    mFirstDirty = EntityCount;
+    for (unsigned EntityIdx = 0; EntityIdx < EntityCount; ++EntityIdx) {
+        setLocal(EntityIdx, mPositions[EntityIdx], mRotations[EntityIdx], mScales[EntityIdx]);
+    }
+    Update(0.0);
+    buildStaticTree();
+    buildStaticBatches();
+
+    unsigned BatchedCount = std::count(mBatched.begin(), mBatched.end(), 1);
+    std::cout << path << " Loaded " << EntityCount << " entities, " << mAnimations.size() << " animated, "
+        << mStaticEntities.size() << " static in " << mStaticTree.GetNodeCount() << " BVH nodes, "
+        << BatchedCount << " merged into " << mBatches.size() << " batches" << std::endl;
+    return true;
+}
+
+void
+Scene::Update(double time) {
+    float Time = static_cast<float>(time);
+    for (unsigned AnimIdx = 0; AnimIdx < mAnimations.size(); ++AnimIdx) {
+        const Animation& Anim = mAnimations[AnimIdx];
+        unsigned EntityIdx = Anim.Entity;
+
+        glm::quat Rotation = mRotations[EntityIdx];
+        if (Anim.SpinRate != 0.0f) {
+            Rotation = glm::angleAxis(glm::radians(Anim.SpinRate * Time), Anim.SpinAxis) * Rotation;
+        }
+
+        glm::vec3 Position = mPositions[EntityIdx];
+        if (Anim.OrbitRadius != 0.0f) {
+            float Angle = glm::radians(Anim.OrbitPhase + Anim.OrbitRate * Time);
+            Position += Anim.OrbitRadius * glm::vec3(std::sin(Angle), 0.0f, std::cos(Angle));
+        }
+
+        glm::vec3 Scale = mScales[EntityIdx];
+        Scale.x += Anim.PulseAmplitude.x * std::abs(std::sin(Anim.PulseFrequency.x * Time));
+        Scale.y += Anim.PulseAmplitude.y * std::abs(std::sin(Anim.PulseFrequency.y * Time));
+        Scale.z += Anim.PulseAmplitude.z * std::abs(std::sin(Anim.PulseFrequency.z * Time));
+
+        setLocal(EntityIdx, Position, Rotation, Scale);
+    }
+    propagate();
+}
+
+void
+Scene::Capture(SceneTransforms& transforms) const {
+    const unsigned Count = mDynamicEntities.size();
+    transforms.ModelMatrices.resize(Count);
+    transforms.NormalMatrices.resize(Count);
+    transforms.WorldBounds.resize(Count);
+    transforms.WorldSpheres.resize(Count);
+    for (unsigned DynamicIdx = 0; DynamicIdx < Count; ++DynamicIdx) {
+        unsigned EntityIdx = mDynamicEntities[DynamicIdx];
+        transforms.ModelMatrices[DynamicIdx] = mModelMatrices[EntityIdx];
+        transforms.NormalMatrices[DynamicIdx] = mNormalMatrices[EntityIdx];
+        transforms.WorldBounds[DynamicIdx] = mWorldBounds[EntityIdx];
+        transforms.WorldSpheres[DynamicIdx] = mWorldSpheres[EntityIdx];
+    }
+}
+
+void
+Scene::Submit(RenderQueue& queue, const Shader& shader, unsigned visibleMask, const SceneTransforms& transforms) {
+    // NOTE: World space vertices, so every batch shares the identity transform
+    static const glm::mat4 Identity(1.0f);
+    static const glm::mat3 NormalIdentity(1.0f);
+    if (mStaticBatching) {
+        for (unsigned BatchIdx = 0; BatchIdx < mBatches.size(); ++BatchIdx) {
+            const StaticBatch& Batch = mBatches[BatchIdx];
+            if ((Batch.Visibility & visibleMask) != Batch.Visibility) {
+                continue;
+            }
+
+            DrawPacket Packet;
+            Packet.Program = &shader;
+            Packet.VAO = Batch.VAO;
+            Packet.VertexCount = Batch.VertexCount;
+            Packet.Mesh = 0;
+            Packet.DiffuseTexture = Batch.MaterialIdx >= 0 ? mMaterials[Batch.MaterialIdx].DiffuseTexture : 0;
+            Packet.SpecularTexture = Batch.MaterialIdx >= 0 ? mMaterials[Batch.MaterialIdx].SpecularTexture : 0;
+            Packet.Layer = Batch.Layer;
+            Packet.ModelMatrix = &Identity;
+            Packet.NormalMatrix = &NormalIdentity;
+            Packet.Bounds = &Batch.Bounds;
+            Packet.Sphere = 0;
+            Packet.InstanceCount = 1;
+            Packet.Identity = 0;
+            queue.Push(Packet);
+        }
+    }
+
+    DrawPacket Packet;
+    mQueryResult.clear();
+    mStaticTree.QueryFrustum(queue.GetFrustum(), mQueryResult);
+    for (unsigned ResultIdx = 0; ResultIdx < mQueryResult.size(); ++ResultIdx) {
+        unsigned EntityIdx = mStaticEntities[mQueryResult[ResultIdx]];
+        if ((!mStaticBatching || !mBatched[EntityIdx]) && makePacket(shader, visibleMask, EntityIdx, Packet)) {
+            queue.Push(Packet);
+        }
+    }
+    for (unsigned DynamicIdx = 0; DynamicIdx < mDynamicEntities.size(); ++DynamicIdx) {
+        if (makePacket(shader, visibleMask, mDynamicEntities[DynamicIdx], Packet)) {
+            Packet.ModelMatrix = &transforms.ModelMatrices[DynamicIdx];
+            Packet.NormalMatrix = &transforms.NormalMatrices[DynamicIdx];
+            Packet.Bounds = &transforms.WorldBounds[DynamicIdx];
+            Packet.Sphere = &transforms.WorldSpheres[DynamicIdx];
+            queue.Push(Packet);
+        }
+    }
+}
+
+bool
+Scene::makePacket(const Shader& shader, unsigned visibleMask, unsigned entity, DrawPacket& packet) {
+    if ((mVisibility[entity] & visibleMask) != mVisibility[entity]) {
+        return false;
+    }
+
+    const MeshSlot& Mesh = mMeshes[mMeshIds[entity]];
+    int MaterialIdx = mMaterialIds[entity];
+    packet.Program = &shader;
+    packet.VAO = Mesh.VAO;
+    packet.VertexCount = Mesh.VertexCount;
+    packet.Mesh = Mesh.ModelIdx >= 0 ? &mModels[Mesh.ModelIdx] : 0;
+    packet.DiffuseTexture = MaterialIdx >= 0 ? mMaterials[MaterialIdx].DiffuseTexture : 0;
+    packet.SpecularTexture = MaterialIdx >= 0 ? mMaterials[MaterialIdx].SpecularTexture : 0;
+    packet.Layer = mLayers[entity];
+    packet.ModelMatrix = &mModelMatrices[entity];
+    packet.NormalMatrix = &mNormalMatrices[entity];
+    packet.Bounds = &mWorldBounds[entity];
+    packet.Sphere = &mWorldSpheres[entity];
+    packet.InstanceCount = 1;
+    // NOTE: Animated entities draw from a snapshot copy of their matrix, so the scene's own one keys them
+    packet.Identity = &mModelMatrices[entity];
+    return true;
+}
+
+void
+Scene::SetStaticBatching(bool enabled) {
+    mStaticBatching = enabled;
+}
+
+int
+Scene::Pick(const glm::vec3& origin, const glm::vec3& direction, float maxDistance, float& distance) const {
+    int Hit = mStaticTree.Raycast(origin, direction, maxDistance, distance);
+    if (Hit >= 0) {
+        Hit = mStaticEntities[Hit];
+    }
+
+    const glm::vec3 InvDirection = 1.0f / direction;
+    for (unsigned DynamicIdx = 0; DynamicIdx < mDynamicEntities.size(); ++DynamicIdx) {
+        unsigned EntityIdx = mDynamicEntities[DynamicIdx];
+        float Distance;
+        if (mWorldBounds[EntityIdx].IntersectsRay(origin, InvDirection, distance, Distance)) {
+            distance = Distance;
+            Hit = EntityIdx;
+        }
+    }
+    return Hit;
+}
+
+void
+Scene::GetOccluders(std::vector<glm::mat4>& boxes) const {
+    boxes.clear();
+    for (unsigned EntityIdx = 0; EntityIdx < mOccluders.size(); ++EntityIdx) {
+        if (!mOccluders[EntityIdx]) {
+            continue;
+        }
+        // NOTE: Nodes occlude with their own unit cube, entities with the box around their mesh
+        glm::mat4 Box(1.0f);
+        if (mMeshIds[EntityIdx] != NO_MESH) {
+            const AABB& Bounds = mMeshes[mMeshIds[EntityIdx]].Bounds;
+            Box[0][0] = Bounds.Max.x - Bounds.Min.x;
+            Box[1][1] = Bounds.Max.y - Bounds.Min.y;
+            Box[2][2] = Bounds.Max.z - Bounds.Min.z;
+            Box[3] = glm::vec4(Bounds.GetCenter(), 1.0f);
+        }
+        boxes.push_back(mModelMatrices[EntityIdx] * Box);
+    }
+}
+
+std::string
+Scene::GetMeshName(unsigned entity) const {
+    return mMeshIds[entity] == NO_MESH ? std::string() : mMeshes[mMeshIds[entity]].Name;
+}
+
+unsigned
+Scene::GetEntityCount() const {
+    return mMeshIds.size();
+}
+
+bool
+Scene::parseText(const std::string& path, const std::string& text) {
+    std::vector<std::string> MaterialNames;
+    std::vector<std::string> EntityNames;
+    std::istringstream Lines(text);
+    std::string Line;
+    unsigned LineNumber = 0;
+    while (std::getline(Lines, Line)) {
+        ++LineNumber;
+        std::string::size_type Comment = Line.find('#');
+        if (Comment != std::string::npos) {
+            Line.erase(Comment);
+        }
+
+        std::istringstream Tokens(Line);
+        std::string Keyword;
+        if (!(Tokens >> Keyword)) {
+            continue;
+        }
+
+        if (Keyword == "material") {
+            std::string Name;
+            Material Mat;
+            if (!(Tokens >> Name >> Mat.DiffusePath)) {
+                std::cerr << "[Err] " << path << ":" << LineNumber << ": Expected material <name> <diffuse> [specular <path>]" << std::endl;
+                return false;
+            }
+            std::string Option;
+            if (Tokens >> Option) {
+                if (Option != "specular" || !(Tokens >> Mat.SpecularPath)) {
+                    std::cerr << "[Err] " << path << ":" << LineNumber << ": Expected specular <path>" << std::endl;
+                    return false;
+                }
+            }
+            MaterialNames.push_back(Name);
+            mMaterials.push_back(Mat);
+        } else if (Keyword == "mesh") {
+            MeshSlot Slot;
+            if (!(Tokens >> Slot.Name >> Slot.Path)) {
+                std::cerr << "[Err] " << path << ":" << LineNumber << ": Expected mesh <name> <path>" << std::endl;
+                return false;
+            }
+            Slot.ModelIdx = -1;
+            Slot.VAO = 0;
+            Slot.VertexCount = 0;
+            mMeshes.push_back(Slot);
+        } else if (Keyword == "entity" || Keyword == "node") {
+            std::string Name;
+            std::string MeshName;
+            std::string MaterialName = "-";
+            bool IsNode = Keyword == "node";
+            if (IsNode ? !(Tokens >> Name) : !(Tokens >> MeshName >> MaterialName)) {
+                std::cerr << "[Err] " << path << ":" << LineNumber << ": Expected entity <mesh> <material|-> ... or node <name> ..." << std::endl;
+                return false;
+            }
+            int MeshIdx = IsNode ? NO_MESH : findMesh(MeshName);
+            if (!IsNode && MeshIdx < 0) {
+                std::cerr << "[Err] " << path << ":" << LineNumber << ": Unknown mesh " << MeshName << std::endl;
+                return false;
+            }
+            int MaterialIdx = -1;
+            if (MaterialName != "-") {
+                for (unsigned NameIdx = 0; NameIdx < MaterialNames.size(); ++NameIdx) {
+                    if (MaterialNames[NameIdx] == MaterialName) {
+                        MaterialIdx = NameIdx;
+                    }
+                }
+                if (MaterialIdx < 0) {
+                    std::cerr << "[Err] " << path << ":" << LineNumber << ": Unknown material " << MaterialName << std::endl;
+                    return false;
+                }
+            }
+
+            glm::vec3 Position(0.0f);
+            glm::quat Rotation(1.0f, 0.0f, 0.0f, 0.0f);
+            glm::vec3 Scale(1.0f);
+            unsigned Visibility = 0;
+            unsigned Layer = LAYER_OPAQUE;
+            unsigned char Occluder = 0;
+            int Parent = -1;
+            Animation Anim = { static_cast<unsigned>(mMeshIds.size()), glm::vec3(0.0f, 1.0f, 0.0f), 0.0f, 0.0f, 0.0f, 0.0f, glm::vec3(0.0f), glm::vec3(0.0f) };
+            bool Animated = false;
+
+            std::string Property;
+            bool Valid = true;
+            while (Valid && Tokens >> Property) {
+                if (Property == "position") {
+                    Valid = ReadVec3(Tokens, Position);
+                } else if (Property == "rotate") {
+                    float Degrees;
+                    glm::vec3 Axis;
+                    Valid = (Tokens >> Degrees) && ReadVec3(Tokens, Axis);
+                    if (Valid) {
+                        Rotation = Rotation * glm::angleAxis(glm::radians(Degrees), glm::normalize(Axis));
+                    }
+                } else if (Property == "scale") {
+                    // NOTE: One value for uniform scale, three otherwise
+                    Valid = static_cast<bool>(Tokens >> Scale.x);
+                    std::streampos Mark = Tokens.tellg();
+                    glm::vec3 Rest;
+                    if (Valid && Mark != std::streampos(-1) && (Tokens >> Rest.y >> Rest.z)) {
+                        Scale = glm::vec3(Scale.x, Rest.y, Rest.z);
+                    } else if (Valid) {
+                        Scale = glm::vec3(Scale.x);
+                        Tokens.clear();
+                        Tokens.seekg(Mark);
+                    }
+                } else if (Property == "translucent") {
+                    Layer = LAYER_TRANSLUCENT;
+                } else if (Property == "occluder") {
+                    Occluder = 1;
+                } else if (Property == "name") {
+                    Valid = static_cast<bool>(Tokens >> Name);
+                } else if (Property == "parent") {
+                    std::string ParentName;
+                    Valid = static_cast<bool>(Tokens >> ParentName);
+                    // NOTE: Parents have to be declared first, which also rules out cycles
+                    Parent = std::find(EntityNames.begin(), EntityNames.end(), ParentName) - EntityNames.begin();
+                    if (Valid && Parent == static_cast<int>(EntityNames.size())) {
+                        std::cerr << "[Err] " << path << ":" << LineNumber << ": Unknown parent " << ParentName << std::endl;
+                        return false;
+                    }
+                } else if (Property == "visible") {
+                    std::string Condition;
+                    Valid = static_cast<bool>(Tokens >> Condition);
+                    if (Condition == "day") {
+                        Visibility |= VISIBLE_DAY;
+                    } else if (Condition == "night") {
+                        Visibility |= VISIBLE_NIGHT;
+                    } else if (Condition == "clouds") {
+                        Visibility |= VISIBLE_CLOUDS;
+                    } else {
+                        Valid = false;
+                    }
+                } else if (Property == "spin") {
+                    Valid = (Tokens >> Anim.SpinRate) && ReadVec3(Tokens, Anim.SpinAxis);
+                    Anim.SpinAxis = glm::normalize(Anim.SpinAxis);
+                    Animated = true;
+                } else if (Property == "orbit") {
+                    Valid = static_cast<bool>(Tokens >> Anim.OrbitRadius >> Anim.OrbitPhase >> Anim.OrbitRate);
+                    Animated = true;
+                } else if (Property == "pulse") {
+                    Valid = ReadVec3(Tokens, Anim.PulseAmplitude) && ReadVec3(Tokens, Anim.PulseFrequency);
+                    Animated = true;
+                } else {
+                    Valid = false;
+                }
+            }
+            if (!Valid) {
+                std::cerr << "[Err] " << path << ":" << LineNumber << ": Bad entity property " << Property << std::endl;
+                return false;
+            }
+
+            mMeshIds.push_back(MeshIdx);
+            mMaterialIds.push_back(MaterialIdx);
+            mVisibility.push_back(Visibility);
+            mLayers.push_back(Layer);
+            mOccluders.push_back(Occluder);
+            mPositions.push_back(Position);
+            mRotations.push_back(Rotation);
+            mScales.push_back(Scale);
+            mParents.push_back(Parent);
+            EntityNames.push_back(Name);
+            if (Animated) {
+                mAnimations.push_back(Anim);
+            }
+        } else {
+            std::cerr << "[Err] " << path << ":" << LineNumber << ": Unknown keyword " << Keyword << std::endl;
+            return false;
+        }
+    }
+    sortBreadthFirst();
+    return true;
+}
+
+bool
+Scene::readBinary(const std::string& path, uint64_t sourceHash) {
+    std::ifstream In(path, std::ios::binary);
+    if (!In) {
+        return false;
+    }
+
+    uint32_t Magic, Version;
+    uint64_t Hash;
+    if (!ReadValue(In, Magic) || !ReadValue(In, Version) || !ReadValue(In, Hash)
+        || Magic != SceneMagic || Version != SceneVersion || Hash != sourceHash) {
+        return false;
+    }
+
+    uint32_t MaterialCount;
+    if (!ReadValue(In, MaterialCount)) {
+        return false;
+    }
+    std::vector<Material> Materials(MaterialCount);
+    for (unsigned MaterialIdx = 0; MaterialIdx < MaterialCount; ++MaterialIdx) {
+        if (!ReadString(In, Materials[MaterialIdx].DiffusePath) || !ReadString(In, Materials[MaterialIdx].SpecularPath)) {
+            return false;
+        }
+    }
+
+    // NOTE: Builtin meshes are registered in code, so mesh ids are remapped by name
+    uint32_t MeshCount;
+    if (!ReadValue(In, MeshCount)) {
+        return false;
+    }
+    const unsigned BuiltinCount = mMeshes.size();
+    std::vector<MeshSlot> Meshes;
+    std::vector<unsigned> MeshRemap(MeshCount);
+    for (unsigned MeshIdx = 0; MeshIdx < MeshCount; ++MeshIdx) {
+        MeshSlot Slot;
+        if (!ReadString(In, Slot.Name) || !ReadString(In, Slot.Path)) {
+            return false;
+        }
+        if (Slot.Path.empty()) {
+            int BuiltinIdx = findMesh(Slot.Name);
+            if (BuiltinIdx < 0) {
+                return false;
+            }
+            MeshRemap[MeshIdx] = BuiltinIdx;
+            continue;
+        }
+        Slot.ModelIdx = -1;
+        Slot.VAO = 0;
+        Slot.VertexCount = 0;
+        MeshRemap[MeshIdx] = BuiltinCount + Meshes.size();
+        Meshes.push_back(Slot);
+    }
+
+    // NOTE: Read into locals so a bad file leaves the scene empty for parseText
+    std::vector<unsigned> MeshIds;
+    std::vector<int> MaterialIds;
+    std::vector<unsigned> Visibility;
+    std::vector<unsigned> Layers;
+    std::vector<unsigned char> Occluders;
+    std::vector<glm::vec3> Positions;
+    std::vector<glm::quat> Rotations;
+    std::vector<glm::vec3> Scales;
+    std::vector<int> Parents;
+    std::vector<Animation> Animations;
+    if (!ReadArray(In, MeshIds) || !ReadArray(In, MaterialIds) || !ReadArray(In, Visibility)
+        || !ReadArray(In, Layers) || !ReadArray(In, Occluders) || !ReadArray(In, Positions) || !ReadArray(In, Rotations)
+        || !ReadArray(In, Scales) || !ReadArray(In, Parents) || !ReadArray(In, Animations)) {
+        return false;
+    }
+
+    const unsigned EntityCount = MeshIds.size();
+    if (MaterialIds.size() != EntityCount || Visibility.size() != EntityCount || Layers.size() != EntityCount
+        || Occluders.size() != EntityCount || Positions.size() != EntityCount || Rotations.size() != EntityCount
+        || Scales.size() != EntityCount || Parents.size() != EntityCount) {
+        return false;
+    }
+    for (unsigned EntityIdx = 0; EntityIdx < EntityCount; ++EntityIdx) {
+        // NOTE: Entities are stored breadth-first, so a parent always has a lower index
+        if (MaterialIds[EntityIdx] < -1 || MaterialIds[EntityIdx] >= static_cast<int>(MaterialCount)
+            || Parents[EntityIdx] < -1 || Parents[EntityIdx] >= static_cast<int>(EntityIdx)) {
+            return false;
+        }
+        if (MeshIds[EntityIdx] == NO_MESH) {
+            continue;
+        }
+        if (MeshIds[EntityIdx] >= MeshCount) {
+            return false;
+        }
+        MeshIds[EntityIdx] = MeshRemap[MeshIds[EntityIdx]];
+    }
+    for (unsigned AnimationIdx = 0; AnimationIdx < Animations.size(); ++AnimationIdx) {
+        if (Animations[AnimationIdx].Entity >= EntityCount) {
+            return false;
+        }
+    }
+
+    mMaterials.swap(Materials);
+    mMeshes.insert(mMeshes.end(), Meshes.begin(), Meshes.end());
+    mMeshIds.swap(MeshIds);
+    mMaterialIds.swap(MaterialIds);
+    mVisibility.swap(Visibility);
+    mLayers.swap(Layers);
+    mOccluders.swap(Occluders);
+    mPositions.swap(Positions);
+    mRotations.swap(Rotations);
+    mScales.swap(Scales);
+    mParents.swap(Parents);
+    mAnimations.swap(Animations);
+    std::cout << "Loaded compiled scene " << path << std::endl;
+    return true;
+}
+
+void
+Scene::writeBinary(const std::string& path, uint64_t sourceHash) const {
+    std::ofstream Out(path, std::ios::binary);
+    if (!Out) {
+        std::cerr << "[Err] Failed to write compiled scene " << path << std::endl;
+        return;
+    }
+
+    WriteValue(Out, SceneMagic);
+    WriteValue(Out, SceneVersion);
+    WriteValue(Out, sourceHash);
+
+    WriteValue(Out, static_cast<uint32_t>(mMaterials.size()));
+    for (unsigned MaterialIdx = 0; MaterialIdx < mMaterials.size(); ++MaterialIdx) {
+        WriteString(Out, mMaterials[MaterialIdx].DiffusePath);
+        WriteString(Out, mMaterials[MaterialIdx].SpecularPath);
+    }
+
+    WriteValue(Out, static_cast<uint32_t>(mMeshes.size()));
+    for (unsigned MeshIdx = 0; MeshIdx < mMeshes.size(); ++MeshIdx) {
+        WriteString(Out, mMeshes[MeshIdx].Name);
+        WriteString(Out, mMeshes[MeshIdx].Path);
+    }
+
+    WriteArray(Out, mMeshIds);
+    WriteArray(Out, mMaterialIds);
+    WriteArray(Out, mVisibility);
+    WriteArray(Out, mLayers);
+    WriteArray(Out, mOccluders);
+    WriteArray(Out, mPositions);
+    WriteArray(Out, mRotations);
+    WriteArray(Out, mScales);
+    WriteArray(Out, mParents);
+    WriteArray(Out, mAnimations);
+}
+
+bool
+Scene::loadResources() {
+    for (unsigned MaterialIdx = 0; MaterialIdx < mMaterials.size(); ++MaterialIdx) {
+        Material& Mat = mMaterials[MaterialIdx];
+        Mat.DiffuseTexture = Texture::LoadImageToTexture(Mat.DiffusePath);
+        Mat.SpecularTexture = Mat.SpecularPath.empty() ? 0 : Texture::LoadImageToTexture(Mat.SpecularPath);
+    }
+
+    mModels.reserve(mMeshes.size());
+    for (unsigned MeshIdx = 0; MeshIdx < mMeshes.size(); ++MeshIdx) {
+        MeshSlot& Slot = mMeshes[MeshIdx];
+        if (Slot.Path.empty()) {
+            continue;
+        }
+        mModels.push_back(Model(Slot.Path));
+        if (!mModels.back().Load()) {
+            std::cerr << "[Err] Failed to load scene mesh " << Slot.Name << std::endl;
+            return false;
+        }
+        Slot.ModelIdx = mModels.size() - 1;
+        Slot.Bounds = mModels.back().GetBounds();
+        Slot.Sphere = mModels.back().GetBoundingSphere();
+    }
+    return true;
+}
+
+int
+Scene::findMesh(const std::string& name) const {
+    for (unsigned MeshIdx = 0; MeshIdx < mMeshes.size(); ++MeshIdx) {
+        if (mMeshes[MeshIdx].Name == name) {
+            return MeshIdx;
+        }
+    }
+    return -1;
+}
+
+void
+Scene::sortBreadthFirst() {
+    // NOTE: Parents are declared before their children, so one pass gives every depth
+    std::vector<unsigned> Depths(mParents.size());
+    for (unsigned EntityIdx = 0; EntityIdx < mParents.size(); ++EntityIdx) {
+        Depths[EntityIdx] = mParents[EntityIdx] < 0 ? 0 : Depths[mParents[EntityIdx]] + 1;
+    }
+
+    std::vector<unsigned> Order(mParents.size());
+    for (unsigned EntityIdx = 0; EntityIdx < Order.size(); ++EntityIdx) {
+        Order[EntityIdx] = EntityIdx;
+    }
+    std::stable_sort(Order.begin(), Order.end(), [&Depths](unsigned a, unsigned b) { return Depths[a] < Depths[b]; });
+
+    std::vector<int> NewIndex(Order.size());
+    for (unsigned SortedIdx = 0; SortedIdx < Order.size(); ++SortedIdx) {
+        NewIndex[Order[SortedIdx]] = SortedIdx;
+    }
+
+    Permute(mMeshIds, Order);
+    Permute(mMaterialIds, Order);
+    Permute(mVisibility, Order);
+    Permute(mLayers, Order);
+    Permute(mOccluders, Order);
+    Permute(mPositions, Order);
+    Permute(mRotations, Order);
+    Permute(mScales, Order);
+    Permute(mParents, Order);
+    for (unsigned EntityIdx = 0; EntityIdx < mParents.size(); ++EntityIdx) {
+        if (mParents[EntityIdx] >= 0) {
+            mParents[EntityIdx] = NewIndex[mParents[EntityIdx]];
+        }
+    }
+    for (unsigned AnimIdx = 0; AnimIdx < mAnimations.size(); ++AnimIdx) {
+        mAnimations[AnimIdx].Entity = NewIndex[mAnimations[AnimIdx].Entity];
+    }
+}
+
+void
+Scene::setLocal(unsigned entity, const glm::vec3& position, const glm::quat& rotation, const glm::vec3& scale) {
+    // NOTE: Same as translate * rotate * scale, without the three matrix products
+    glm::mat3 Rotation = glm::mat3_cast(rotation);
+    glm::mat4& Local = mLocalMatrices[entity];
+    Local[0] = glm::vec4(Rotation[0] * scale.x, 0.0f);
+    Local[1] = glm::vec4(Rotation[1] * scale.y, 0.0f);
+    Local[2] = glm::vec4(Rotation[2] * scale.z, 0.0f);
+    Local[3] = glm::vec4(position, 1.0f);
+    mDirty[entity] = 1;
+    mFirstDirty = std::min(mFirstDirty, entity);
+}
+
+void
+Scene::propagate() {
+    const unsigned EntityCount = mMeshIds.size();
+    // NOTE: Breadth-first order means a parent is always final before its children are visited
+    for (unsigned EntityIdx = mFirstDirty; EntityIdx < EntityCount; ++EntityIdx) {
+        int Parent = mParents[EntityIdx];
+        if (Parent >= 0 && mDirty[Parent]) {
+            mDirty[EntityIdx] = 1;
+        }
+        if (!mDirty[EntityIdx]) {
+            continue;
+        }
+
+        glm::mat4& World = mModelMatrices[EntityIdx];
+        World = Parent >= 0 ? mModelMatrices[Parent] * mLocalMatrices[EntityIdx] : mLocalMatrices[EntityIdx];
+        mNormalMatrices[EntityIdx] = Transform::NormalMatrix(World);
+        if (mMeshIds[EntityIdx] != NO_MESH) {
+            mWorldBounds[EntityIdx] = mMeshes[mMeshIds[EntityIdx]].Bounds.Transformed(World);
+            mWorldSpheres[EntityIdx] = mMeshes[mMeshIds[EntityIdx]].Sphere.Transformed(World);
+        }
+    }
+
+    if (mFirstDirty < EntityCount) {
+        std::fill(mDirty.begin() + mFirstDirty, mDirty.end(), 0);
+    }
+    mFirstDirty = EntityCount;
+}
+
+void
+Scene::buildStaticTree() {
+    const unsigned EntityCount = mMeshIds.size();
+    std::vector<unsigned char> Dynamic(EntityCount, 0);
+    for (unsigned AnimIdx = 0; AnimIdx < mAnimations.size(); ++AnimIdx) {
+        Dynamic[mAnimations[AnimIdx].Entity] = 1;
+    }
+
+    mStaticEntities.clear();
+    mDynamicEntities.clear();
+    std::vector<AABB> StaticBounds;
+    for (unsigned EntityIdx = 0; EntityIdx < EntityCount; ++EntityIdx) {
+        int Parent = mParents[EntityIdx];
+        if (Parent >= 0 && Dynamic[Parent]) {
+            Dynamic[EntityIdx] = 1;
+        }
+        if (mMeshIds[EntityIdx] == NO_MESH) {
+            continue;
+        }
+        if (Dynamic[EntityIdx]) {
+            mDynamicEntities.push_back(EntityIdx);
+        } else {
+            mStaticEntities.push_back(EntityIdx);
+            StaticBounds.push_back(mWorldBounds[EntityIdx]);
+        }
+    }
+    mStaticTree.Build(StaticBounds.data(), StaticBounds.size());
+}
+
+void
+Scene::buildStaticBatches() {
+    mBatches.clear();
+    mBatched.assign(mMeshIds.size(), 0);
+    std::vector<std::vector<float> > BatchVertices;
+    for (unsigned StaticIdx = 0; StaticIdx < mStaticEntities.size(); ++StaticIdx) {
+        unsigned EntityIdx = mStaticEntities[StaticIdx];
+        const MeshSlot& Mesh = mMeshes[mMeshIds[EntityIdx]];
+        // NOTE: Translucent entities stay separate, they have to be sorted back-to-front one by one
+        if (Mesh.Vertices.empty() || mLayers[EntityIdx] != LAYER_OPAQUE) {
+            continue;
+        }
+
+        unsigned BatchIdx = 0;
+        while (BatchIdx < mBatches.size() && (mBatches[BatchIdx].MaterialIdx != mMaterialIds[EntityIdx]
+            || mBatches[BatchIdx].Visibility != mVisibility[EntityIdx] || mBatches[BatchIdx].Layer != mLayers[EntityIdx])) {
+            ++BatchIdx;
+        }
+        if (BatchIdx == mBatches.size()) {
+            StaticBatch Batch;
+            Batch.MaterialIdx = mMaterialIds[EntityIdx];
+            Batch.Visibility = mVisibility[EntityIdx];
+            Batch.Layer = mLayers[EntityIdx];
+            Batch.VAO = 0;
+            Batch.VertexCount = 0;
+            mBatches.push_back(Batch);
+            BatchVertices.push_back(std::vector<float>());
+        }
+
+        const glm::mat4& Model = mModelMatrices[EntityIdx];
+        const glm::mat3& Normal = mNormalMatrices[EntityIdx];
+        std::vector<float>& Out = BatchVertices[BatchIdx];
+        for (unsigned VertexIdx = 0; VertexIdx < Mesh.VertexCount; ++VertexIdx) {
+            const float* In = &Mesh.Vertices[8 * VertexIdx];
+            glm::vec3 Position = glm::vec3(Model * glm::vec4(In[0], In[1], In[2], 1.0f));
+            glm::vec3 Direction = glm::normalize(Normal * glm::vec3(In[3], In[4], In[5]));
+            float Vertex[8] = { Position.x, Position.y, Position.z, Direction.x, Direction.y, Direction.z, In[6], In[7] };
+            Out.insert(Out.end(), Vertex, Vertex + 8);
+        }
+        mBatches[BatchIdx].VertexCount += Mesh.VertexCount;
+        mBatches[BatchIdx].Bounds.Extend(mWorldBounds[EntityIdx]);
+        mBatched[EntityIdx] = 1;
+    }
+
+    for (unsigned BatchIdx = 0; BatchIdx < mBatches.size(); ++BatchIdx) {
+        unsigned VBO;
+        glGenVertexArrays(1, &mBatches[BatchIdx].VAO);
+        glBindVertexArray(mBatches[BatchIdx].VAO);
+        glGenBuffers(1, &VBO);
+        glBindBuffer(GL_ARRAY_BUFFER, VBO);
+        glBufferData(GL_ARRAY_BUFFER, BatchVertices[BatchIdx].size() * sizeof(float), BatchVertices[BatchIdx].data(), GL_STATIC_DRAW);
+        glVertexAttribPointer(0, 3, GL_FLOAT, GL_FALSE, 8 * sizeof(float), (void*)0);
+        glEnableVertexAttribArray(0);
+        glVertexAttribPointer(1, 3, GL_FLOAT, GL_FALSE, 8 * sizeof(float), (void*)(3 * sizeof(float)));
+        glEnableVertexAttribArray(1);
+        glVertexAttribPointer(2, 2, GL_FLOAT, GL_FALSE, 8 * sizeof(float), (void*)(6 * sizeof(float)));
+        glEnableVertexAttribArray(2);
+    }
+    glBindBuffer(GL_ARRAY_BUFFER, 0);
+    glBindVertexArray(0);
+}
@@ -0,0 +1,225 @@
+/**
+ * @file scene.hpp
+ * @brief Data-driven scene loaded from a text description or its compiled
+ * binary form into flat per entity arrays
+ *
+ */
+
+#pragma once
+#include <string>
+#include <cstdint>
+#include <vector>
+#include <glm/glm.hpp>
+#include <glm/gtc/quaternion.hpp>
+#include "shader.hpp"
+#include "model.hpp"
+#include "bounds.hpp"
+#include "render_queue.hpp"
+#include "bvh.hpp"
+
+// NOTE: Mesh id of "node" entities, which only group and place their children
+#define NO_MESH 0xFFFFFFFF
+
+/**
+ * @brief Conditions under which an entity is drawn. Entities without any are always drawn
+ */
+enum EVisibility {
+    VISIBLE_DAY = 1 << 0,
+    VISIBLE_NIGHT = 1 << 1,
+    VISIBLE_CLOUDS = 1 << 2,
+};
+
+/**
+ * @brief World transforms of a scene's animated entities at one point in time. Static
+ * entities never move after load, so they are read from the scene itself
+ */
+struct SceneTransforms {
+    std::vector<glm::mat4> ModelMatrices;
+    std::vector<glm::mat3> NormalMatrices;
+    std::vector<AABB> WorldBounds;
+    std::vector<BoundingSphere> WorldSpheres;
+};
+
+class Scene {
+public:
+    Scene();
+
+    /**
+     * @brief Makes a mesh created in code available to the scene file under a name
+     *
+     * @param name Name used by "entity" lines
+     * @param vao Vertex array with position, normal and UV attributes
+     * @param vertexCount Number of vertices drawn with glDrawArrays
+     * @param bounds Object space bounds
+     * @param vertices Optional copy of the VAO's data, 8 floats per vertex. Static
+     * entities of meshes that have it are merged into per material batches on load
+     */
+    void AddBuiltinMesh(const std::string& name, unsigned vao, unsigned vertexCount, const AABB& bounds, const float* vertices = 0);
+
+    /**
+     * @brief Loads the scene. The text file is compiled to a binary file next
+     * to it (same name, .bin) which is used instead while the text is unchanged
+     *
+     * @param path Text scene path
+     *
+     * @returns true - Success, false - Failure
+     */
+    bool Load(const std::string& path);
+
+    /**
+     * @brief Advances animations and recomputes world matrices of the entities
+     * they moved and of their descendants. Static entities are computed once on load
+     *
+     * @param time Seconds since start
+     */
+    void Update(double time);
+
+    /**
+     * @brief Copies the world transforms of the animated entities, as computed by the last Update
+     *
+     * @param transforms Output, may be reused between calls
+     */
+    void Capture(SceneTransforms& transforms) const;
+
+    /**
+     * @brief Queues a draw for every entity whose visibility condition is met.
+     * Static entities come from a frustum query of their hierarchy, animated ones are tested by the queue.
+     * Only reads what Update leaves unchanged, so it may run on another thread than Update
+     *
+     * @param queue Queue of the current frame
+     * @param shader Shader to draw with
+     * @param visibleMask Bitwise OR of EVisibility conditions that hold now
+     * @param transforms Animated entities' transforms from Capture, they have to stay alive until the queue is submitted
+     */
+    void Submit(RenderQueue& queue, const Shader& shader, unsigned visibleMask, const SceneTransforms& transforms);
+
+    /**
+     * @brief Draws batched static entities with one draw per batch or, if disabled, one by one
+     *
+     */
+    void SetStaticBatching(bool enabled);
+
+    /**
+     * @brief Finds the entity whose world bounds the ray hits first, regardless of visibility conditions
+     *
+     * @param origin Ray origin
+     * @param direction Normalized ray direction
+     * @param maxDistance Maximum distance along the ray
+     * @param distance Output distance to the hit bounds
+     *
+     * @returns Entity index or -1 if nothing was hit
+     */
+    int Pick(const glm::vec3& origin, const glm::vec3& direction, float maxDistance, float& distance) const;
+
+    /**
+     * @brief Returns boxes of the entities marked as occluders, as matrices that
+     * map the unit cube centered on the origin to each box
+     *
+     * @param boxes Output matrices
+     */
+    void GetOccluders(std::vector<glm::mat4>& boxes) const;
+
+    /**
+     * @brief Returns name of the entity's mesh, empty for nodes
+     *
+     * @param entity Entity index
+     */
+    std::string GetMeshName(unsigned entity) const;
+
+    unsigned GetEntityCount() const;
+
+private:
+    struct Material {
+        std::string DiffusePath;
+        // NOTE: Empty if the material has no specular map
+        std::string SpecularPath;
+        unsigned DiffuseTexture;
+        unsigned SpecularTexture;
+    };
+
+    struct MeshSlot {
+        std::string Name;
+        // NOTE: Empty for meshes added with AddBuiltinMesh
+        std::string Path;
+        int ModelIdx;
+        unsigned VAO;
+        unsigned VertexCount;
+        AABB Bounds;
+        BoundingSphere Sphere;
+        // NOTE: Position, normal, UV per vertex, only kept for builtin meshes that can be batched
+        std::vector<float> Vertices;
+    };
+
+    // NOTE: Static opaque entities sharing material, visibility and layer, pre-transformed into one buffer
+    struct StaticBatch {
+        int MaterialIdx;
+        unsigned Visibility;
+        unsigned Layer;
+        unsigned VAO;
+        unsigned VertexCount;
+        AABB Bounds;
+    };
+
+    // NOTE: Only animated entities have one, scale = Scale + PulseAmplitude * |sin(PulseFrequency * t)|
+    struct Animation {
+        unsigned Entity;
+        glm::vec3 SpinAxis;
+        float SpinRate;
+        float OrbitRadius;
+        float OrbitPhase;
+        float OrbitRate;
+        glm::vec3 PulseAmplitude;
+        glm::vec3 PulseFrequency;
+    };
+
+    std::vector<Material> mMaterials;
+    std::vector<MeshSlot> mMeshes;
+    std::vector<Model> mModels;
+
+    // NOTE: Per entity, structure-of-arrays sorted breadth-first so parents always
+    // precede their children. Position, rotation and scale are as authored, relative to the parent
+    std::vector<unsigned> mMeshIds;
+    std::vector<int> mMaterialIds;
+    std::vector<unsigned> mVisibility;
+    std::vector<unsigned> mLayers;
+    // NOTE: 1 for solid entities that hide what is behind them in the software occlusion buffer
+    std::vector<unsigned char> mOccluders;
+    std::vector<glm::vec3> mPositions;
+    std::vector<glm::quat> mRotations;
+    std::vector<glm::vec3> mScales;
+    std::vector<int> mParents;
+    std::vector<glm::mat4> mLocalMatrices;
+    std::vector<glm::mat4> mModelMatrices;
+    std::vector<glm::mat3> mNormalMatrices;
+    std::vector<AABB> mWorldBounds;
+    std::vector<BoundingSphere> mWorldSpheres;
+    std::vector<unsigned char> mDirty;
+    // NOTE: Lowest dirty entity, everything before it is up to date
+    unsigned mFirstDirty;
+
+    std::vector<Animation> mAnimations;
+
+    // NOTE: Entities with meshes split by whether they or an ancestor are animated.
+    // Static ones never move after load, so their world bounds are kept in a BVH
+    std::vector<unsigned> mStaticEntities;
+    std::vector<unsigned> mDynamicEntities;
+    BVH mStaticTree;
+    std::vector<unsigned> mQueryResult;
+
+    std::vector<StaticBatch> mBatches;
+    // NOTE: Per entity, 1 if a batch draws it
+    std::vector<unsigned char> mBatched;
+    bool mStaticBatching;
+
+    bool parseText(const std::string& path, const std::string& text);
+    bool readBinary(const std::string& path, uint64_t sourceHash);
+    void writeBinary(const std::string& path, uint64_t sourceHash) const;
+    bool loadResources();
+    int findMesh(const std::string& name) const;
+    void sortBreadthFirst();
+    void setLocal(unsigned entity, const glm::vec3& position, const glm::quat& rotation, const glm::vec3& scale);
+    void propagate();
+    void buildStaticTree();
+    void buildStaticBatches();
+    bool makePacket(const Shader& shader, unsigned visibleMask, unsigned entity, DrawPacket& packet);
+};
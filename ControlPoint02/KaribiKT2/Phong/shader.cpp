@@ -1,9 +1,91 @@
 #include "shader.hpp"
+#include "transform.hpp"
+#include "program_cache.hpp"
+#include "shader_preprocessor.hpp"
+
+Shader::Shader(const std::string& vShaderPath, const std::string& fShaderPath)
+    : Shader(vShaderPath, fShaderPath, std::vector<std::string>()) {}
+
+Shader::Shader(const std::string& vShaderPath, const std::string& fShaderPath, const std::vector<std::string>& defines)
+    : Shader(vShaderPath, fShaderPath, defines, false) {}
+
+Shader::Shader(const std::string& vShaderPath, const std::string& fShaderPath, const std::vector<std::string>& defines, bool async) {
+    mVertexPath = vShaderPath;
+    mFragmentPath = fShaderPath;
+    mVertexShader = 0;
+    mFragmentShader = 0;
+    mPending = false;
+    const std::string& VertexSource = ShaderPreprocessor::Process(vShaderPath, defines);
+    const std::string& FragmentSource = ShaderPreprocessor::Process(fShaderPath, defines);
+
+    // NOTE: Key covers the final source, so a changed define or edited file misses the cache
+    mCacheKey = ProgramCache::MakeKey(VertexSource, FragmentSource);
+    mId = ProgramCache::Load(mCacheKey);
+    if (mId) {
+        std::cout << "Loaded " << vShaderPath << " + " << fShaderPath << " from shader cache" << std::endl;
+        return;
+    }
 
-Shader::Shader(const std::string& vShaderPath, const std::string& fShaderPath) {
-    unsigned vs = loadAndCompileShader(vShaderPath, GL_VERTEX_SHADER);
-    unsigned fs = loadAndCompileShader(fShaderPath, GL_FRAGMENT_SHADER);
-    mId = createBasicProgram(vs, fs);
+    // NOTE: No status is queried here, querying makes the driver finish the
+    // program before the next one is even submitted
+    mVertexShader = compileShader(VertexSource, GL_VERTEX_SHADER);
+    mFragmentShader = compileShader(FragmentSource, GL_FRAGMENT_SHADER);
+    mId = createBasicProgram(mVertexShader, mFragmentShader);
+    mPending = true;
+    if (!async) {
+        Finish();
+    }
+}
+
+bool
+Shader::IsReady() {
+    if (!mPending) {
+        return true;
+    }
+
+    // NOTE: Without the extension there is no way to ask without blocking, so finish right away
+    if (GLEW_KHR_parallel_shader_compile) {
+        int Completed = 0;
+        glGetProgramiv(mId, GL_COMPLETION_STATUS_KHR, &Completed);
+        if (!Completed) {
+            return false;
+        }
+    }
+
+    Finish();
+    return true;
+}
+
+void
+Shader::Finish() {
+    if (!mPending) {
+        return;
+    }
+    mPending = false;
+
+    bool Compiled = checkShader(mVertexShader, GL_VERTEX_SHADER, mVertexPath);
+    Compiled = checkShader(mFragmentShader, GL_FRAGMENT_SHADER, mFragmentPath) && Compiled;
+
+    int Success;
+    char InfoLog[512];
+    glGetProgramiv(mId, GL_LINK_STATUS, &Success);
+    if (!Compiled || !Success) {
+        if (Compiled) {
+            glGetProgramInfoLog(mId, 512, NULL, InfoLog);
+            std::cerr << "[Err] Failed to link shader program:" << std::endl << InfoLog << std::endl;
+        }
+        glDeleteProgram(mId);
+        glDeleteShader(mVertexShader);
+        glDeleteShader(mFragmentShader);
+        mId = 0;
+        return;
+    }
+
+    glDetachShader(mId, mVertexShader);
+    glDetachShader(mId, mFragmentShader);
+    glDeleteShader(mVertexShader);
+    glDeleteShader(mFragmentShader);
+    ProgramCache::Store(mCacheKey, mId);
 }
 
 unsigned
@@ -21,19 +103,50 @@ Shader::SetUniform1f(const std::string& uniform, float v) const {
     glUniform1f(glGetUniformLocation(mId, uniform.c_str()), v);
 }
 
+void
+Shader::SetUniform1iv(const std::string& uniform, unsigned count, const int* v) const {
+    glUniform1iv(glGetUniformLocation(mId, uniform.c_str()), count, v);
+}
+
+void
+Shader::SetUniform2f(const std::string& uniform, const glm::vec2& v) const {
+    glUniform2f(glGetUniformLocation(mId, uniform.c_str()), v.x, v.y);
+}
+
 void
 Shader::SetUniform3f(const std::string& uniform, const glm::vec3& v) const {
     glUniform3f(glGetUniformLocation(mId, uniform.c_str()), v.x, v.y, v.z);
 }
 
+void
+Shader::SetUniform2fv(const std::string& uniform, unsigned count, const glm::vec2* v) const {
+    glUniform2fv(glGetUniformLocation(mId, uniform.c_str()), count, &v[0].x);
+}
+
+void
+Shader::SetUniform3fv(const std::string& uniform, unsigned count, const glm::vec3* v) const {
+    glUniform3fv(glGetUniformLocation(mId, uniform.c_str()), count, &v[0].x);
+}
+
 void
 Shader::SetUniform4m(const std::string& uniform, const glm::mat4& m) const {
     glUniformMatrix4fv(glGetUniformLocation(mId, uniform.c_str()), 1, GL_FALSE, &m[0][0]);
 }
 
+void
+Shader::SetUniform3m(const std::string& uniform, const glm::mat3& m) const {
+    glUniformMatrix3fv(glGetUniformLocation(mId, uniform.c_str()), 1, GL_FALSE, &m[0][0]);
+}
+
 void
 Shader::SetModel(const glm::mat4& m) const {
+    SetModel(m, Transform::NormalMatrix(m));
+}
+
+void
+Shader::SetModel(const glm::mat4& m, const glm::mat3& normal) const {
     SetUniform4m("uModel", m);
+    SetUniform3m("uNormalMatrix", normal);
 }
 
 void
@@ -46,58 +159,46 @@ void Shader::SetProjection(const glm::mat4& m) const {
 }
 
 unsigned
-Shader::loadAndCompileShader(std::string filename, GLuint shaderType) {
+Shader::compileShader(const std::string& source, GLuint shaderType) {
     unsigned ShaderID = 0;
-    std::ifstream In(filename);
-    std::string Str;
-
-    In.seekg(0, std::ios::end);
-    Str.reserve(In.tellg());
-    In.seekg(0, std::ios::beg);
-
-    Str.assign((std::istreambuf_iterator<char>(In)), std::istreambuf_iterator<char>());
-    const char* CharContent = Str.c_str();
+    const char* CharContent = source.c_str();
 
     ShaderID = glCreateShader(shaderType);
     glShaderSource(ShaderID, 1, &CharContent, NULL);
     glCompileShader(ShaderID);
 
+    return ShaderID;
+}
+
+bool
+Shader::checkShader(unsigned shader, GLuint shaderType, const std::string& filename) {
     int Success;
     char InfoLog[512];
-    glGetShaderiv(ShaderID, GL_COMPILE_STATUS, &Success);
+    glGetShaderiv(shader, GL_COMPILE_STATUS, &Success);
     if (!Success) {
-        glGetShaderInfoLog(ShaderID, 256, NULL, InfoLog);
+        glGetShaderInfoLog(shader, 256, NULL, InfoLog);
         std::string ShaderTypeName = shaderType == GL_VERTEX_SHADER ? "vertex" : "fragment";
-        std::cout << "Error while compiling shader [" << ShaderTypeName << "]:" << std::endl << InfoLog << std::endl;
-        return 0;
+        std::cout << "Error while compiling shader [" << ShaderTypeName << "] " << filename << ":" << std::endl << InfoLog << std::endl;
+        std::cout << "Source string numbers:" << std::endl;
+        ShaderPreprocessor::PrintSourceNames();
+        return false;
     }
 
     std::cout << "Loaded " << filename << " shader" << std::endl;
 
-    return ShaderID;
+    return true;
 }
 
 unsigned
 Shader::createBasicProgram(unsigned vShader, unsigned fShader) {
     unsigned ProgramID = 0;
     ProgramID = glCreateProgram();
+    if (ProgramCache::IsSupported()) {
+        glProgramParameteri(ProgramID, GL_PROGRAM_BINARY_RETRIEVABLE_HINT, GL_TRUE);
+    }
     glAttachShader(ProgramID, vShader);
     glAttachShader(ProgramID, fShader);
     glLinkProgram(ProgramID);
 
-    int Success;
-    char InfoLog[512];
-    glGetProgramiv(ProgramID, GL_LINK_STATUS, &Success);
-    if (!Success) {
-        glGetProgramInfoLog(ProgramID, 512, NULL, InfoLog);
-        std::cerr << "[Err] Failed to link shader program:" << std::endl << InfoLog << std::endl;
-        return 0;
-    }
-
-    glDetachShader(ProgramID, vShader);
-    glDetachShader(ProgramID, fShader);
-    glDeleteShader(vShader);
-    glDeleteShader(fShader);
-
     return ProgramID;
-}
\ No newline at end of file
+}
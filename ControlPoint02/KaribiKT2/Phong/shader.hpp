@@ -23,8 +23,44 @@ public:
     unsigned mId;
 
     Shader(const std::string& vShaderPath, const std::string& fShaderPath);
+
+    /**
+     * @brief Ctor - compiles a permutation of the program with the given
+     * preprocessor symbols defined in both stages
+     *
+     * @param vShaderPath Vertex shader path
+     * @param fShaderPath Fragment shader path
+     * @param defines Symbols injected as #define lines after #version, see ShaderPreprocessor
+     */
+    Shader(const std::string& vShaderPath, const std::string& fShaderPath, const std::vector<std::string>& defines);
+
+    /**
+     * @brief Ctor - submits compilation and linking. With async set the
+     * results are not waited on, see IsReady and Finish
+     *
+     * @param vShaderPath Vertex shader path
+     * @param fShaderPath Fragment shader path
+     * @param defines Symbols injected as #define lines after #version
+     * @param async Return without waiting for the driver
+     */
+    Shader(const std::string& vShaderPath, const std::string& fShaderPath, const std::vector<std::string>& defines, bool async);
     unsigned GetId() const;
 
+    /**
+     * @brief Polls an async program. Never blocks when KHR_parallel_shader_compile
+     * is available, otherwise finishes the program
+     *
+     * @returns true if the program is linked (or failed) and may be used
+     */
+    bool IsReady();
+
+    /**
+     * @brief Waits for an async program, reports errors and stores it in the
+     * program cache. Does nothing for programs that are already finished
+     *
+     */
+    void Finish();
+
     /**
      * @brief Sets int uniform value
      *
@@ -41,6 +77,23 @@ public:
      */
     void SetUniform1f(const std::string& uniform, float v) const;
 
+    /**
+     * @brief Sets int array uniform value
+     *
+     * @param uniform Name of uniform
+     * @param count Number of array elements
+     * @param v Values
+     */
+    void SetUniform1iv(const std::string& uniform, unsigned count, const int* v) const;
+
+    /**
+     * @brief Sets vec2 uniform value
+     *
+     * @param uniform Name of uniform
+     * @param v Value
+     */
+    void SetUniform2f(const std::string& uniform, const glm::vec2& v) const;
+
     /**
     * @brief Sets float uniform value
     *
@@ -49,6 +102,24 @@ public:
     */
     void SetUniform3f(const std::string& uniform, const glm::vec3& v) const;
 
+    /**
+     * @brief Sets vec2 array uniform value
+     *
+     * @param uniform Name of uniform
+     * @param count Number of array elements
+     * @param v Values
+     */
+    void SetUniform2fv(const std::string& uniform, unsigned count, const glm::vec2* v) const;
+
+    /**
+     * @brief Sets vec3 array uniform value
+     *
+     * @param uniform Name of uniform
+     * @param count Number of array elements
+     * @param v Values
+     */
+    void SetUniform3fv(const std::string& uniform, unsigned count, const glm::vec3* v) const;
+
     /**
      * @brief Sets 4x4 matrix uniform value
      *
@@ -58,12 +129,28 @@ public:
     void SetUniform4m(const std::string& uniform, const glm::mat4& m) const;
 
     /**
-     * @brief Sets the Model matrix
+     * @brief Sets 3x3 matrix uniform value
+     *
+     * @param uniform Name of uniform
+     * @param m GLM matrix
+     */
+    void SetUniform3m(const std::string& uniform, const glm::mat3& m) const;
+
+    /**
+     * @brief Sets the Model matrix and the Normal matrix derived from it
      *
      * @param m Model matrix
      */
     void SetModel(const glm::mat4& m) const;
 
+    /**
+     * @brief Sets the Model matrix with a precomputed Normal matrix
+     *
+     * @param m Model matrix
+     * @param normal Normal matrix, see Transform::NormalMatrix
+     */
+    void SetModel(const glm::mat4& m, const glm::mat3& normal) const;
+
     /**
      * @brief Sets the View matrix
      *
@@ -78,16 +165,35 @@ public:
      */
     void SetProjection(const glm::mat4& m) const;
 private:
+    std::string mVertexPath;
+    std::string mFragmentPath;
+    std::string mCacheKey;
+    // NOTE: Kept until the async program is finished, for error reporting
+    unsigned mVertexShader;
+    unsigned mFragmentShader;
+    bool mPending;
 
     /**
-     * @brief Loads shader from file and returns the compiled shader's ID
+     * @brief Submits shader source for compilation without waiting for the result
      *
-     * @param filename File path to be loaded
-     * @param shadertType Type of shader: vertex or fragment
-     * 
-     * @returns Compiled shader's ID
+     * @param source Shader source
+     * @param shaderType Type of shader: vertex or fragment
+     *
+     * @returns Shader's ID
      */
-    unsigned loadAndCompileShader(std::string filename, GLuint shaderType);
+    unsigned compileShader(const std::string& source, GLuint shaderType);
+
+    /**
+     * @brief Reports shader compilation errors
+     *
+     * @param shader Shader ID
+     * @param shaderType Type of shader: vertex or fragment
+     * @param filename File the source was loaded from, for logging
+     *
+     * @returns true if compilation succeeded
+     */
+    bool checkShader(unsigned shader, GLuint shaderType, const std::string& filename);
+
     /**
      * @brief Creates a shader program and returns the ID
      *
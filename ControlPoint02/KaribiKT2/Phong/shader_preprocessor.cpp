@@ -0,0 +1,150 @@
+#include "shader_preprocessor.hpp"
+#include "hash.hpp"
+#include <fstream>
+#include <iostream>
+#include <sstream>
+#include <unordered_map>
+
+// NOTE: Shader files do not change while running, each one is read from disk once
+static std::unordered_map<std::string, std::string> FileContents;
+// NOTE: Index is the GLSL source string number used in #line
+static std::vector<std::string> SourceNames;
+static std::unordered_map<uint64_t, std::string> ProcessedSources;
+
+static bool
+ReadFile(const std::string& filename, const std::string*& contents) {
+    auto Found = FileContents.find(filename);
+    if (Found == FileContents.end()) {
+        std::ifstream In(filename);
+        if (!In) {
+            return false;
+        }
+        std::stringstream Str;
+        Str << In.rdbuf();
+        Found = FileContents.emplace(filename, Str.str()).first;
+    }
+
+    contents = &Found->second;
+    return true;
+}
+
+static unsigned
+GetSourceNumber(const std::string& filename) {
+    for (unsigned SourceIdx = 0; SourceIdx < SourceNames.size(); ++SourceIdx) {
+        if (SourceNames[SourceIdx] == filename) {
+            return SourceIdx;
+        }
+    }
+
+    SourceNames.push_back(filename);
+    return SourceNames.size() - 1;
+}
+
+static std::string
+LineDirective(unsigned nextLine, unsigned sourceNumber) {
+    // NOTE: GLSL 330 numbers the line following "#line N" as N + 1
+    return "#line " + std::to_string(nextLine - 1) + " " + std::to_string(sourceNumber) + "\n";
+}
+
+static bool
+Expand(const std::string& filename, const std::string& defines, std::vector<std::string>& includeStack, std::vector<std::string>& included, std::string& out) {
+    const std::string* Contents = 0;
+    if (!ReadFile(filename, Contents)) {
+        std::cerr << "[Err] Failed to open shader file " << filename;
+        if (!includeStack.empty()) {
+            std::cerr << " included from " << includeStack.back();
+        }
+        std::cerr << std::endl;
+        return false;
+    }
+
+    includeStack.push_back(filename);
+    included.push_back(filename);
+    unsigned SourceNumber = GetSourceNumber(filename);
+    std::string Directory = filename.substr(0, filename.find_last_of('/') + 1);
+    bool IsRoot = includeStack.size() == 1;
+    if (!IsRoot) {
+        out += LineDirective(1, SourceNumber);
+    } else if (Contents->find("#version") == std::string::npos) {
+        out += defines + LineDirective(1, SourceNumber);
+    }
+
+    std::istringstream Lines(*Contents);
+    std::string Line;
+    unsigned LineNumber = 0;
+    while (std::getline(Lines, Line)) {
+        ++LineNumber;
+        size_t First = Line.find_first_not_of(" \t");
+        bool IsDirective = First != std::string::npos && Line[First] == '#';
+
+        // NOTE: #version has to stay the first statement, so defines go right after it
+        if (IsRoot && IsDirective && Line.compare(First, 8, "#version") == 0) {
+            out += Line + "\n" + defines + LineDirective(LineNumber + 1, SourceNumber);
+            continue;
+        }
+
+        if (!IsDirective || Line.compare(First, 8, "#include") != 0) {
+            out += Line + "\n";
+            continue;
+        }
+
+        size_t PathStart = Line.find('"', First);
+        size_t PathEnd = PathStart == std::string::npos ? PathStart : Line.find('"', PathStart + 1);
+        if (PathEnd == std::string::npos) {
+            std::cerr << "[Err] Malformed #include in " << filename << ":" << LineNumber << std::endl;
+            return false;
+        }
+
+        std::string IncludePath = Directory + Line.substr(PathStart + 1, PathEnd - PathStart - 1);
+        for (const std::string& Parent : includeStack) {
+            if (Parent == IncludePath) {
+                std::cerr << "[Err] Include cycle: " << IncludePath << " included from " << filename << std::endl;
+                return false;
+            }
+        }
+
+        bool AlreadyIncluded = false;
+        for (const std::string& Previous : included) {
+            AlreadyIncluded |= Previous == IncludePath;
+        }
+        if (!AlreadyIncluded) {
+            if (!Expand(IncludePath, defines, includeStack, included, out)) {
+                return false;
+            }
+        }
+        out += LineDirective(LineNumber + 1, SourceNumber);
+    }
+
+    includeStack.pop_back();
+    return true;
+}
+
+const std::string&
+ShaderPreprocessor::Process(const std::string& filename, const std::vector<std::string>& defines) {
+    std::string Defines;
+    for (const std::string& Define : defines) {
+        Defines += "#define " + Define + "\n";
+    }
+
+    uint64_t Key = HashFNV1a(Defines, HashFNV1a(filename));
+    auto Found = ProcessedSources.find(Key);
+    if (Found != ProcessedSources.end()) {
+        return Found->second;
+    }
+
+    std::string Source;
+    std::vector<std::string> IncludeStack;
+    std::vector<std::string> Included;
+    if (!Expand(filename, Defines, IncludeStack, Included, Source)) {
+        Source.clear();
+    }
+
+    return ProcessedSources.emplace(Key, Source).first->second;
+}
+
+void
+ShaderPreprocessor::PrintSourceNames() {
+    for (unsigned SourceIdx = 0; SourceIdx < SourceNames.size(); ++SourceIdx) {
+        std::cout << "  " << SourceIdx << ": " << SourceNames[SourceIdx] << std::endl;
+    }
+}
@@ -0,0 +1,34 @@
+/**
+ * @file shader_preprocessor.hpp
+ * @brief Resolves #include and injects #define sets before GLSL compilation
+ *
+ */
+
+#pragma once
+#include <string>
+#include <vector>
+
+class ShaderPreprocessor {
+public:
+    /**
+     * @brief Returns the source ready for glShaderSource. Defines are inserted
+     * after #version and #include "file" lines are replaced by the file's
+     * contents, paths relative to the including file. Every file is included
+     * at most once. #line directives keep compiler errors pointing at the
+     * original file and line, files are numbered as listed by PrintSourceNames.
+     * Results are cached by a hash of the path and defines
+     *
+     * @param filename Shader path
+     * @param defines Symbols injected as #define lines
+     *
+     * @returns Preprocessed source, empty if a file is missing or includes form a cycle
+     */
+    static const std::string& Process(const std::string& filename, const std::vector<std::string>& defines);
+
+    /**
+     * @brief Prints the source string number of every file seen so far, for
+     * reading compiler error locations
+     *
+     */
+    static void PrintSourceNames();
+};
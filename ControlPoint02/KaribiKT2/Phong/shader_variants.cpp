@@ -0,0 +1,94 @@
+#include "shader_variants.hpp"
+#include <algorithm>
+
+static const char* LightFeatureDefines[LIGHT_FEATURE_COUNT] = {
+    "HAS_DIR_LIGHT",
+    "HAS_POINT_LIGHTS",
+    "HAS_SPOT_LIGHTS",
+    "CLUSTERED_LIGHTING",
+    "INDIRECT_DRAW",
+};
+
+ShaderVariants::ShaderVariants(const std::string& vShaderPath, const std::string& fShaderPath, const std::vector<std::string>& commonDefines, InitCallback onCreate) {
+    mVertexPath = vShaderPath;
+    mFragmentPath = fShaderPath;
+    mCommonDefines = commonDefines;
+    mOnCreate = onCreate;
+}
+
+void
+ShaderVariants::Request(unsigned mask) {
+    if (mVariants.find(mask) != mVariants.end()) {
+        return;
+    }
+
+    mVariants.emplace(mask, Shader(mVertexPath, mFragmentPath, getDefines(mask), true));
+    mPending.push_back(mask);
+}
+
+const Shader&
+ShaderVariants::Get(unsigned mask) {
+    Request(mask);
+    Shader& Variant = mVariants.find(mask)->second;
+    auto Pending = std::find(mPending.begin(), mPending.end(), mask);
+    if (Pending != mPending.end()) {
+        mPending.erase(Pending);
+        Variant.Finish();
+        onReady(mask, Variant);
+    }
+
+    return Variant;
+}
+
+const Shader&
+ShaderVariants::GetReady(unsigned mask, unsigned fallbackMask) {
+    Request(mask);
+    auto Pending = std::find(mPending.begin(), mPending.end(), mask);
+    if (Pending == mPending.end()) {
+        // NOTE: A variant that failed to compile keeps id 0, it is never treated as ready
+        const Shader& Variant = mVariants.find(mask)->second;
+        return Variant.GetId() ? Variant : Get(fallbackMask);
+    }
+
+    Shader& Variant = mVariants.find(mask)->second;
+    if (Variant.IsReady()) {
+        mPending.erase(Pending);
+        onReady(mask, Variant);
+        if (Variant.GetId()) {
+            return Variant;
+        }
+    }
+
+    return Get(fallbackMask);
+}
+
+unsigned
+ShaderVariants::GetPendingCount() const {
+    return mPending.size();
+}
+
+unsigned
+ShaderVariants::GetVariantCount() const {
+    return mVariants.size();
+}
+
+std::vector<std::string>
+ShaderVariants::getDefines(unsigned mask) const {
+    std::vector<std::string> Defines = mCommonDefines;
+    for (unsigned FeatureIdx = 0; FeatureIdx < LIGHT_FEATURE_COUNT; ++FeatureIdx) {
+        if (mask & (1u << FeatureIdx)) {
+            Defines.push_back(LightFeatureDefines[FeatureIdx]);
+        }
+    }
+
+    return Defines;
+}
+
+void
+ShaderVariants::onReady(unsigned mask, const Shader& variant) {
+    std::cout << "Compiled shader variant 0x" << std::hex << mask << std::dec << std::endl;
+    if (mOnCreate && variant.GetId()) {
+        glUseProgram(variant.GetId());
+        mOnCreate(variant);
+    }
+}
@@ -0,0 +1,101 @@
+/**
+ * @file shader_variants.hpp
+ * @brief Cache of #define driven shader permutations
+ *
+ */
+
+#pragma once
+#include <functional>
+#include <string>
+#include <unordered_map>
+#include <vector>
+#include "shader.hpp"
+
+/**
+ * @brief Light features that can be compiled in or out of the Phong shader.
+ * Each bit maps to a HAS_* define in phong_material_texture.frag
+ */
+enum ELightFeature {
+    LIGHT_DIRECTIONAL = 1 << 0,
+    LIGHT_POINT = 1 << 1,
+    LIGHT_SPOT = 1 << 2,
+    // NOTE: Point and spot lights come from the cluster grid instead of uniform arrays
+    LIGHT_CLUSTERED = 1 << 3,
+    // NOTE: Not a light feature, transforms come from the render queue's draw data instead of uniforms
+    DRAW_INDIRECT = 1 << 4,
+    LIGHT_FEATURE_COUNT = 5,
+};
+
+class ShaderVariants {
+public:
+    /**
+     * @brief Callback invoked once for every newly compiled variant while
+     * its program is bound. Used for setting constant uniforms
+     */
+    typedef std::function<void(const Shader&)> InitCallback;
+
+    /**
+     * @brief Ctor - no programs are compiled until they are requested
+     *
+     * @param vShaderPath Vertex shader path
+     * @param fShaderPath Fragment shader path
+     * @param commonDefines Defines shared by every variant, e.g. array sizes
+     * @param onCreate Called for each variant after it is compiled
+     */
+    ShaderVariants(const std::string& vShaderPath, const std::string& fShaderPath, const std::vector<std::string>& commonDefines, InitCallback onCreate);
+
+    /**
+     * @brief Starts compiling the variant in the background if it was not
+     * requested before. Does not wait for the driver
+     *
+     * @param mask Bitwise OR of ELightFeature values
+     */
+    void Request(unsigned mask);
+
+    /**
+     * @brief Returns the program compiled for the feature mask, compiling
+     * and caching it on first use. Waits for the variant if it is still compiling
+     *
+     * @param mask Bitwise OR of ELightFeature values
+     *
+     * @returns Shader variant
+     */
+    const Shader& Get(unsigned mask);
+
+    /**
+     * @brief Returns the variant if it has finished compiling, otherwise
+     * requests it and returns the fallback variant so rendering never waits
+     * on the compiler. A variant that failed to compile always returns the fallback.
+     * The fallback should be compiled up front with Get
+     *
+     * @param mask Bitwise OR of ELightFeature values
+     * @param fallbackMask Variant that can render anything mask can, usually a superset of features
+     *
+     * @returns Shader variant
+     */
+    const Shader& GetReady(unsigned mask, unsigned fallbackMask);
+
+    /**
+     * @brief Returns number of requested variants that are still compiling
+     *
+     */
+    unsigned GetPendingCount() const;
+
+    /**
+     * @brief Returns number of compiled variants
+     *
+     */
+    unsigned GetVariantCount() const;
+
+private:
+    std::string mVertexPath;
+    std::string mFragmentPath;
+    std::vector<std::string> mCommonDefines;
+    InitCallback mOnCreate;
+    std::unordered_map<unsigned, Shader> mVariants;
+    // NOTE: Variants that were submitted but not yet seen finished
+    std::vector<unsigned> mPending;
+
+    std::vector<std::string> getDefines(unsigned mask) const;
+    void onReady(unsigned mask, const Shader& variant);
+};
@@ -6,15 +6,32 @@ layout (location = 2) in vec2 aUV;
 
 uniform mat4 uProjection;
 uniform mat4 uView;
+#ifdef INDIRECT_DRAW
+// Index of the draw, one per instance starting at the command's base instance
+layout (location = 4) in float aDrawId;
+// Written by the render queue: model matrix columns, then normal matrix columns
+uniform samplerBuffer uDrawData;
+#else
 uniform mat4 uModel;
+// Inverse transpose of uModel, computed once per object on the CPU
+uniform mat3 uNormalMatrix;
+#endif
 
 out vec2 UV;
 out vec3 vWorldSpaceFragment;
 out vec3 vWorldSpaceNormal;
 
 void main() {
-	vWorldSpaceFragment = vec3(uModel * vec4(aPos, 1.0f));
-	vWorldSpaceNormal = normalize(mat3(transpose(inverse(uModel))) * aNormal);
+#ifdef INDIRECT_DRAW
+	int Base = int(aDrawId) * 7;
+	mat4 Model = mat4(texelFetch(uDrawData, Base), texelFetch(uDrawData, Base + 1), texelFetch(uDrawData, Base + 2), texelFetch(uDrawData, Base + 3));
+	mat3 NormalMatrix = mat3(texelFetch(uDrawData, Base + 4).xyz, texelFetch(uDrawData, Base + 5).xyz, texelFetch(uDrawData, Base + 6).xyz);
+#else
+	mat4 Model = uModel;
+	mat3 NormalMatrix = uNormalMatrix;
+#endif
+	vWorldSpaceFragment = vec3(Model * vec4(aPos, 1.0f));
+	vWorldSpaceNormal = normalize(NormalMatrix * aNormal);
 	UV = aUV;
-	gl_Position = uProjection * uView * uModel * vec4(aPos, 1.0f);
-}
\ No newline at end of file
+	gl_Position = uProjection * uView * Model * vec4(aPos, 1.0f);
+}
@@ -0,0 +1,46 @@
+// Point and spot lights looked up from the cluster grid, see ClusteredLighting
+#include "lighting.glsl"
+
+#ifdef CLUSTERED_LIGHTING
+// Per cluster (offset into uClusterIndices, point count | spot count << 16)
+uniform usamplerBuffer uClusterGrid;
+uniform usamplerBuffer uClusterIndices;
+// Point light: 4 texels, spot light: 5 texels. See ClusteredLighting::packLights
+uniform samplerBuffer uPointLightData;
+uniform samplerBuffer uSpotLightData;
+uniform vec2 uClusterScreenScale;
+uniform vec2 uClusterDepthScaleBias;
+uniform mat4 uView;
+
+vec3 ClusteredLights(Surface S) {
+	float ViewDepth = -(uView * vec4(S.Position, 1.0f)).z;
+	int Slice = clamp(int(log(ViewDepth) * uClusterDepthScaleBias.x + uClusterDepthScaleBias.y), 0, CLUSTER_GRID_Z - 1);
+	ivec2 Tile = min(ivec2(gl_FragCoord.xy * uClusterScreenScale), ivec2(CLUSTER_GRID_X - 1, CLUSTER_GRID_Y - 1));
+	uvec2 Cluster = texelFetch(uClusterGrid, (Slice * CLUSTER_GRID_Y + Tile.y) * CLUSTER_GRID_X + Tile.x).xy;
+	int Offset = int(Cluster.x);
+	int PointCount = int(Cluster.y & 0xFFFFu);
+	int SpotCount = int(Cluster.y >> 16u);
+	vec3 Color = vec3(0.0f);
+
+	for (int ClusterLightIdx = 0; ClusterLightIdx < PointCount; ++ClusterLightIdx) {
+		int Texel = int(texelFetch(uClusterIndices, Offset + ClusterLightIdx).x) * 4;
+		vec4 PositionKc = texelFetch(uPointLightData, Texel);
+		vec4 KaKl = texelFetch(uPointLightData, Texel + 1);
+		vec4 KdKq = texelFetch(uPointLightData, Texel + 2);
+		vec4 Ks = texelFetch(uPointLightData, Texel + 3);
+		Color += PointLight(S, PositionKc.xyz, KaKl.rgb, KdKq.rgb, Ks.rgb, vec3(PositionKc.w, KaKl.w, KdKq.w));
+	}
+
+	for (int ClusterLightIdx = 0; ClusterLightIdx < SpotCount; ++ClusterLightIdx) {
+		int Texel = int(texelFetch(uClusterIndices, Offset + PointCount + ClusterLightIdx).x) * 5;
+		vec4 PositionKc = texelFetch(uSpotLightData, Texel);
+		vec4 KaKl = texelFetch(uSpotLightData, Texel + 1);
+		vec4 KdKq = texelFetch(uSpotLightData, Texel + 2);
+		vec4 KsInner = texelFetch(uSpotLightData, Texel + 3);
+		vec4 DirectionOuter = texelFetch(uSpotLightData, Texel + 4);
+		Color += SpotLight(S, PositionKc.xyz, DirectionOuter.xyz, KaKl.rgb, KdKq.rgb, KsInner.rgb, vec3(PositionKc.w, KaKl.w, KdKq.w), vec2(KsInner.w, DirectionOuter.w));
+	}
+
+	return Color;
+}
+#endif
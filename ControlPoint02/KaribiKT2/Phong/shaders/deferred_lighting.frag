@@ -0,0 +1,47 @@
+#version 330 core
+
+// Point and spot lights always come from the cluster grid, only the sun is a plain uniform
+#include "lighting.glsl"
+#include "clustered_lighting.glsl"
+#include "normal_encoding.glsl"
+
+// G-buffer, see DeferredRenderer::createTargets for the layout
+uniform sampler2D uGAlbedo;
+uniform sampler2D uGSpecular;
+uniform sampler2D uGNormal;
+uniform sampler2D uGDepth;
+uniform mat4 uInverseViewProjection;
+
+out vec4 FragColor;
+
+void main() {
+	ivec2 Pixel = ivec2(gl_FragCoord.xy);
+	float Depth = texelFetch(uGDepth, Pixel, 0).r;
+	// NOTE: Nothing was drawn here, leave the clear color
+	if (Depth == 1.0f) {
+		discard;
+	}
+
+	vec4 Clip = vec4(gl_FragCoord.xy / vec2(textureSize(uGDepth, 0)) * 2.0f - 1.0f, Depth * 2.0f - 1.0f, 1.0f);
+	vec4 World = uInverseViewProjection * Clip;
+	vec4 SpecularShininess = texelFetch(uGSpecular, Pixel, 0);
+
+	Surface S;
+	S.Position = World.xyz / World.w;
+	S.Normal = DecodeNormal(texelFetch(uGNormal, Pixel, 0).xy);
+	S.ViewDirection = normalize(uViewPos - S.Position);
+	S.Albedo = texelFetch(uGAlbedo, Pixel, 0).rgb;
+	S.Specular = SpecularShininess.rgb;
+	S.Shininess = SpecularShininess.a * 256.0f;
+	vec3 FinalColor = vec3(0.0f);
+
+#ifdef HAS_DIR_LIGHT
+	FinalColor += SunLight(S);
+#endif
+
+#ifdef CLUSTERED_LIGHTING
+	FinalColor += ClusteredLights(S);
+#endif
+
+	FragColor = vec4(FinalColor, 1.0f);
+}
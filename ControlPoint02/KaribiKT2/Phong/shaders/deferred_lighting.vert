@@ -0,0 +1,7 @@
+#version 330 core
+
+// Single triangle covering the screen, no vertex buffer needed
+void main() {
+	vec2 Position = vec2((gl_VertexID << 1) & 2, gl_VertexID & 2);
+	gl_Position = vec4(Position * 2.0f - 1.0f, 0.0f, 1.0f);
+}
@@ -0,0 +1,18 @@
+#version 330 core
+
+#include "material.glsl"
+#include "normal_encoding.glsl"
+
+in vec2 UV;
+in vec3 vWorldSpaceFragment;
+in vec3 vWorldSpaceNormal;
+
+layout (location = 0) out vec4 GAlbedo;
+layout (location = 1) out vec4 GSpecular;
+layout (location = 2) out vec2 GNormal;
+
+void main() {
+	GAlbedo = vec4(vec3(texture(uMaterial.Kd, UV)), 1.0f);
+	GSpecular = vec4(vec3(texture(uMaterial.Ks, UV)), uMaterial.Shininess / 256.0f);
+	GNormal = EncodeNormal(normalize(vWorldSpaceNormal));
+}
@@ -0,0 +1,52 @@
+// Phong light evaluation shared by the forward and deferred shaders
+
+struct DirectionalLight {
+	vec3 Direction;
+	vec3 Ka;
+	vec3 Kd;
+	vec3 Ks;
+};
+
+uniform DirectionalLight uDirLight;
+uniform vec3 uViewPos;
+
+// Everything the lighting functions need to know about the shaded point
+struct Surface {
+	vec3 Position;
+	vec3 Normal;
+	vec3 ViewDirection;
+	vec3 Albedo;
+	vec3 Specular;
+	float Shininess;
+};
+
+// Returns ambient + diffuse + specular for a light coming from LightVector
+vec3 Phong(Surface S, vec3 LightVector, vec3 Ka, vec3 Kd, vec3 Ks) {
+	float Diffuse = max(dot(S.Normal, LightVector), 0.0f);
+	vec3 ReflectDirection = reflect(-LightVector, S.Normal);
+	float SpecularFactor = pow(max(dot(S.ViewDirection, ReflectDirection), 0.0f), S.Shininess);
+	return Ka * S.Albedo + Diffuse * Kd * S.Albedo + SpecularFactor * Ks * S.Specular;
+}
+
+float Attenuate(vec3 Attenuation, float Distance) {
+	return 1.0f / (Attenuation.x + Attenuation.y * Distance + Attenuation.z * (Distance * Distance));
+}
+
+vec3 SunLight(Surface S) {
+	return Phong(S, normalize(-uDirLight.Direction), uDirLight.Ka, uDirLight.Kd, uDirLight.Ks);
+}
+
+vec3 PointLight(Surface S, vec3 Position, vec3 Ka, vec3 Kd, vec3 Ks, vec3 Attenuation) {
+	vec3 ToLight = Position - S.Position;
+	float Distance = length(ToLight);
+	return Attenuate(Attenuation, Distance) * Phong(S, ToLight / Distance, Ka, Kd, Ks);
+}
+
+vec3 SpotLight(Surface S, vec3 Position, vec3 Direction, vec3 Ka, vec3 Kd, vec3 Ks, vec3 Attenuation, vec2 CutOff) {
+	vec3 ToLight = Position - S.Position;
+	float Distance = length(ToLight);
+	vec3 LightVector = ToLight / Distance;
+	float Theta = dot(LightVector, normalize(-Direction));
+	float Intensity = clamp((Theta - CutOff.y) / (CutOff.x - CutOff.y), 0.0f, 1.0f);
+	return Intensity * Attenuate(Attenuation, Distance) * Phong(S, LightVector, Ka, Kd, Ks);
+}
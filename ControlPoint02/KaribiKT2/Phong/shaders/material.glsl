@@ -0,0 +1,8 @@
+// Diffuse and specular maps bound to texture units 0 and 1
+struct Material {
+	sampler2D Kd;
+	sampler2D Ks;
+	float Shininess;
+};
+
+uniform Material uMaterial;
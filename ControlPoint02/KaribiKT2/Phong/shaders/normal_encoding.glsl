@@ -0,0 +1,13 @@
+// Octahedral normal encoding, unit vector folded onto a square in [-1, 1]
+vec2 EncodeNormal(vec3 N) {
+	N /= abs(N.x) + abs(N.y) + abs(N.z);
+	vec2 Folded = (1.0f - abs(N.yx)) * vec2(N.x >= 0.0f ? 1.0f : -1.0f, N.y >= 0.0f ? 1.0f : -1.0f);
+	return N.z >= 0.0f ? N.xy : Folded;
+}
+
+vec3 DecodeNormal(vec2 E) {
+	vec3 N = vec3(E, 1.0f - abs(E.x) - abs(E.y));
+	float T = max(-N.z, 0.0f);
+	N.xy += vec2(N.x >= 0.0f ? -T : T, N.y >= 0.0f ? -T : T);
+	return normalize(N);
+}
@@ -0,0 +1,5 @@
+#version 330 core
+
+// Bounding box proxies only feed occlusion queries, color and depth writes are masked off
+void main() {
+}
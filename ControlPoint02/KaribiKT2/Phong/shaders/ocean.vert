@@ -0,0 +1,61 @@
+#version 330 core
+
+// Grid coordinates of the vertex inside its level
+layout (location = 0) in vec2 aGrid;
+
+uniform mat4 uProjection;
+uniform mat4 uView;
+uniform vec3 uViewPos;
+// Set per level by OceanClipmap
+uniform vec2 uLevelOrigin;
+uniform float uLevelSpacing;
+uniform float uGridHalfSize;
+// Filled every frame by OceanMaps, one texel per simulation cell and repeating every uPatchSize
+uniform sampler2D uDisplacementMap;
+uniform sampler2D uNormalMap;
+uniform float uPatchSize;
+
+out vec2 UV;
+out vec3 vWorldSpaceFragment;
+out vec3 vWorldSpaceNormal;
+
+const float SeaLevel = -4.5f;
+const float TextureSize = 4.0f;
+
+// Simulated surface at a point of the still surface
+void Displace(vec2 still, out vec3 position, out vec3 normal) {
+	// NOTE: Picking the mip level by distance instead of by level keeps both sides of a level
+	// edge equal. Cells grow to about a sixteenth of the distance, so that is where texels get skipped
+	float Texel = uPatchSize / float(textureSize(uDisplacementMap, 0).x);
+	float Lod = log2(max(1.0f, length(still - uViewPos.xz) / (16.0f * Texel)));
+	vec2 PatchUV = still / uPatchSize;
+	vec3 Offset = textureLod(uDisplacementMap, PatchUV, Lod).xyz;
+	position = vec3(still.x, SeaLevel, still.y) + Offset;
+	normal = textureLod(uNormalMap, PatchUV, Lod).xyz;
+}
+
+void main() {
+	vec2 Still = uLevelOrigin + aGrid * uLevelSpacing;
+	vec3 Position;
+	vec3 Normal;
+	Displace(Still, Position, Normal);
+
+	// NOTE: The level outside only has every other vertex on the shared edge. Odd edge vertices
+	// are moved onto the line between their neighbours so the edge has no cracks
+	vec2 Edge = vec2(abs(aGrid.x) == uGridHalfSize ? 0.0f : 1.0f, abs(aGrid.y) == uGridHalfSize ? 0.0f : 1.0f);
+	if (Edge != vec2(1.0f) && mod(dot(aGrid, Edge), 2.0f) == 1.0f) {
+		vec3 PositionA;
+		vec3 NormalA;
+		vec3 PositionB;
+		vec3 NormalB;
+		Displace(Still - Edge * uLevelSpacing, PositionA, NormalA);
+		Displace(Still + Edge * uLevelSpacing, PositionB, NormalB);
+		Position = 0.5f * (PositionA + PositionB);
+		Normal = NormalA + NormalB;
+	}
+
+	vWorldSpaceFragment = Position;
+	vWorldSpaceNormal = normalize(Normal);
+	UV = Still / TextureSize;
+	gl_Position = uProjection * uView * vec4(Position, 1.0f);
+}
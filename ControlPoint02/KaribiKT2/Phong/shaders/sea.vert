@@ -0,0 +1,44 @@
+#version 330 core
+
+layout (location = 0) in vec3 aPos;
+layout (location = 1) in vec3 aNormal;
+layout (location = 2) in vec2 aUV;
+// Per instance: grid cell and 1 for the rolling wave cube, 0 for the steady cube under it
+layout (location = 3) in vec3 aCell;
+
+uniform mat4 uProjection;
+uniform mat4 uView;
+uniform mat4 uModel;
+uniform mat3 uNormalMatrix;
+// Seconds since start, the whole sea moves from this alone
+uniform float uTime;
+
+out vec2 UV;
+out vec3 vWorldSpaceFragment;
+out vec3 vWorldSpaceNormal;
+
+const float CellSize = 4.0f;
+const vec3 WaveAxis = normalize(vec3(0.11f, 0.0f, 2.0f));
+
+// Rotation about a unit axis, same matrix as glm::angleAxis
+mat3 AxisAngle(vec3 axis, float angle) {
+	float c = cos(angle);
+	float s = sin(angle);
+	vec3 t = (1.0f - c) * axis;
+	return mat3(
+		t.x * axis + vec3(c, s * axis.z, -s * axis.y),
+		t.y * axis + vec3(-s * axis.z, c, s * axis.x),
+		t.z * axis + vec3(s * axis.y, -s * axis.x, c));
+}
+
+void main() {
+	float Height = abs(sin(uTime)) - CellSize * mix(1.5f, 1.6f, aCell.z);
+	mat3 Rotation = aCell.z > 0.5f ? AxisAngle(WaveAxis, radians(uTime * (45.0f + aCell.x))) : mat3(1.0f);
+	vec3 Local = Rotation * (aPos * CellSize) + vec3(aCell.x * CellSize, Height, aCell.y * CellSize);
+
+	vec4 World = uModel * vec4(Local, 1.0f);
+	vWorldSpaceFragment = vec3(World);
+	vWorldSpaceNormal = normalize(uNormalMatrix * (Rotation * aNormal));
+	UV = aUV;
+	gl_Position = uProjection * uView * World;
+}
@@ -0,0 +1,329 @@
+#include "software_occlusion.hpp"
+#include <xmmintrin.h>
+#include <algorithm>
+#include <chrono>
+#include <cmath>
+#include <iostream>
+
+// NOTE: Corner i of the unit cube has x, y and z taken from bits 0, 1 and 2
+static const unsigned CubeFaces[6][4] = {
+    { 0, 2, 6, 4 }, { 1, 3, 7, 5 },
+    { 0, 1, 5, 4 }, { 2, 3, 7, 6 },
+    { 0, 1, 3, 2 }, { 4, 5, 7, 6 },
+};
+
+// NOTE: More than the near plane, so an occluder is skipped before the camera can see into it
+static const float CameraMargin = 0.5f;
+
+static glm::vec3
+CubeCorner(unsigned corner) {
+    return glm::vec3(corner & 1 ? 0.5f : -0.5f, corner & 2 ? 0.5f : -0.5f, corner & 4 ? 0.5f : -0.5f);
+}
+
+static glm::vec3
+ToScreen(const glm::vec4& clip, unsigned width, unsigned height) {
+    float InvW = 1.0f / clip.w;
+    return glm::vec3((clip.x * InvW * 0.5f + 0.5f) * width, (clip.y * InvW * 0.5f + 0.5f) * height, clip.z * InvW);
+}
+
+SoftwareOcclusion::SoftwareOcclusion(unsigned width, unsigned height) {
+    mWidth = (std::max(width, 1u) + TILE_SIZE - 1) / TILE_SIZE * TILE_SIZE;
+    mHeight = (std::max(height, 1u) + TILE_SIZE - 1) / TILE_SIZE * TILE_SIZE;
+    mDepth.assign(mWidth * mHeight, 1.0f);
+    mTileMaxDepth.assign((mWidth / TILE_SIZE) * (mHeight / TILE_SIZE), 1.0f);
+    mViewProjection = glm::mat4(1.0f);
+    mViewPosition = glm::vec3(0.0f);
+    mPending = false;
+    mQuit = false;
+    mLastRasterMs = 0.0;
+    mLastOccluderCount = 0;
+    mLastTestedCount = 0;
+    mLastCulledCount = 0;
+    mWorker = std::thread(&SoftwareOcclusion::workerLoop, this);
+}
+
+SoftwareOcclusion::~SoftwareOcclusion() {
+    {
+        std::lock_guard<std::mutex> Lock(mMutex);
+        mQuit = true;
+    }
+    mWakeUp.notify_all();
+    mWorker.join();
+}
+
+void
+SoftwareOcclusion::Begin(const glm::mat4& viewProjection, const glm::vec3& viewPosition, const std::vector<glm::mat4>& occluders) {
+    // NOTE: The worker may still be reading last frame's input if nobody waited for it
+    Wait();
+    {
+        std::lock_guard<std::mutex> Lock(mMutex);
+        mViewProjection = viewProjection;
+        mViewPosition = viewPosition;
+        mOccluders = occluders;
+        mPending = true;
+    }
+    mLastTestedCount = 0;
+    mLastCulledCount = 0;
+    mWakeUp.notify_one();
+}
+
+void
+SoftwareOcclusion::Wait() {
+    std::unique_lock<std::mutex> Lock(mMutex);
+    mDone.wait(Lock, [this] { return !mPending; });
+}
+
+void
+SoftwareOcclusion::workerLoop() {
+    for (;;) {
+        {
+            std::unique_lock<std::mutex> Lock(mMutex);
+            mWakeUp.wait(Lock, [this] { return mQuit || mPending; });
+            if (mQuit) {
+                return;
+            }
+        }
+
+        rasterize();
+
+        {
+            std::lock_guard<std::mutex> Lock(mMutex);
+            mPending = false;
+        }
+        mDone.notify_all();
+    }
+}
+
+void
+SoftwareOcclusion::rasterize() {
+    std::chrono::high_resolution_clock::time_point Start = std::chrono::high_resolution_clock::now();
+    std::fill(mDepth.begin(), mDepth.end(), 1.0f);
+
+    unsigned Rasterized = 0;
+    for (unsigned OccluderIdx = 0; OccluderIdx < mOccluders.size(); ++OccluderIdx) {
+        const glm::mat4& Box = mOccluders[OccluderIdx];
+        glm::vec3 Local = glm::vec3(glm::inverse(Box) * glm::vec4(mViewPosition, 1.0f));
+        if (std::abs(Local.x) <= 0.5f + CameraMargin / glm::length(glm::vec3(Box[0]))
+            && std::abs(Local.y) <= 0.5f + CameraMargin / glm::length(glm::vec3(Box[1]))
+            && std::abs(Local.z) <= 0.5f + CameraMargin / glm::length(glm::vec3(Box[2]))) {
+            continue;
+        }
+        ++Rasterized;
+
+        glm::mat4 MVP = mViewProjection * Box;
+        glm::vec4 Clip[8];
+        for (unsigned Corner = 0; Corner < 8; ++Corner) {
+            Clip[Corner] = MVP * glm::vec4(CubeCorner(Corner), 1.0f);
+        }
+
+        for (unsigned FaceIdx = 0; FaceIdx < 6; ++FaceIdx) {
+            // NOTE: Only the near plane is clipped against, the rest is handled by clamping to the buffer.
+            // A quad cut by one plane has at most five corners
+            glm::vec3 Screen[5];
+            unsigned Count = 0;
+            for (unsigned Edge = 0; Edge < 4; ++Edge) {
+                const glm::vec4& From = Clip[CubeFaces[FaceIdx][Edge]];
+                const glm::vec4& To = Clip[CubeFaces[FaceIdx][(Edge + 1) % 4]];
+                float FromDistance = From.z + From.w;
+                float ToDistance = To.z + To.w;
+                if (FromDistance >= 0.0f) {
+                    Screen[Count++] = ToScreen(From, mWidth, mHeight);
+                }
+                if ((FromDistance >= 0.0f) != (ToDistance >= 0.0f)) {
+                    float T = FromDistance / (FromDistance - ToDistance);
+                    Screen[Count++] = ToScreen(From + (To - From) * T, mWidth, mHeight);
+                }
+            }
+            if (Count >= 3) {
+                rasterizePolygon(Screen, Count);
+            }
+        }
+    }
+    buildTiles();
+
+    mLastOccluderCount = Rasterized;
+    mLastRasterMs = std::chrono::duration<double, std::milli>(std::chrono::high_resolution_clock::now() - Start).count();
+}
+
+void
+SoftwareOcclusion::rasterizePolygon(const glm::vec3* vertices, unsigned count) {
+    float Area = 0.0f;
+    for (unsigned VertexIdx = 0; VertexIdx < count; ++VertexIdx) {
+        const glm::vec3& A = vertices[VertexIdx];
+        const glm::vec3& B = vertices[(VertexIdx + 1) % count];
+        Area += A.x * B.y - B.x * A.y;
+    }
+    if (std::abs(Area) < 1e-6f) {
+        return;
+    }
+
+    // NOTE: Faces are drawn from both sides, so they are brought to counter-clockwise order
+    glm::vec3 V[5];
+    for (unsigned VertexIdx = 0; VertexIdx < count; ++VertexIdx) {
+        V[VertexIdx] = Area > 0.0f ? vertices[VertexIdx] : vertices[count - 1 - VertexIdx];
+    }
+
+    // NOTE: Depth is planar in screen space, the largest fan triangle gives the most precise gradients
+    unsigned Best = 1;
+    float BestArea = 0.0f;
+    for (unsigned VertexIdx = 1; VertexIdx + 1 < count; ++VertexIdx) {
+        float TriangleArea = (V[VertexIdx].x - V[0].x) * (V[VertexIdx + 1].y - V[0].y) - (V[VertexIdx + 1].x - V[0].x) * (V[VertexIdx].y - V[0].y);
+        if (TriangleArea > BestArea) {
+            BestArea = TriangleArea;
+            Best = VertexIdx;
+        }
+    }
+    if (BestArea < 1e-6f) {
+        return;
+    }
+    const glm::vec3& P0 = V[0];
+    const glm::vec3& P1 = V[Best];
+    const glm::vec3& P2 = V[Best + 1];
+    float DzDx = ((P1.z - P0.z) * (P2.y - P0.y) - (P2.z - P0.z) * (P1.y - P0.y)) / BestArea;
+    float DzDy = ((P2.z - P0.z) * (P1.x - P0.x) - (P1.z - P0.z) * (P2.x - P0.x)) / BestArea;
+    // NOTE: Farthest depth of the face within a pixel, so the occluder is never nearer than it really is
+    float DepthBias = 0.5f * (std::abs(DzDx) + std::abs(DzDy));
+
+    float MinX = V[0].x, MaxX = V[0].x, MinY = V[0].y, MaxY = V[0].y;
+    for (unsigned VertexIdx = 1; VertexIdx < count; ++VertexIdx) {
+        MinX = std::min(MinX, V[VertexIdx].x);
+        MaxX = std::max(MaxX, V[VertexIdx].x);
+        MinY = std::min(MinY, V[VertexIdx].y);
+        MaxY = std::max(MaxY, V[VertexIdx].y);
+    }
+    int X0 = static_cast<int>(std::max(std::floor(MinX), 0.0f)) & ~3;
+    int X1 = static_cast<int>(std::min(std::ceil(MaxX), static_cast<float>(mWidth)));
+    int Y0 = static_cast<int>(std::max(std::floor(MinY), 0.0f));
+    int Y1 = static_cast<int>(std::min(std::ceil(MaxY), static_cast<float>(mHeight)));
+    if (X0 >= X1 || Y0 >= Y1) {
+        return;
+    }
+
+    // NOTE: A pixel is written only if it lies fully inside the face, the edge function
+    // at its center has to clear half the pixel's extent along the edge normal
+    float EdgeA[5], EdgeB[5], EdgeC[5], Threshold[5];
+    for (unsigned EdgeIdx = 0; EdgeIdx < count; ++EdgeIdx) {
+        const glm::vec3& From = V[EdgeIdx];
+        const glm::vec3& To = V[(EdgeIdx + 1) % count];
+        EdgeA[EdgeIdx] = From.y - To.y;
+        EdgeB[EdgeIdx] = To.x - From.x;
+        EdgeC[EdgeIdx] = -EdgeA[EdgeIdx] * From.x - EdgeB[EdgeIdx] * From.y;
+        Threshold[EdgeIdx] = 0.5f * (std::abs(EdgeA[EdgeIdx]) + std::abs(EdgeB[EdgeIdx]));
+    }
+
+    const __m128 LaneOffsets = _mm_set_ps(3.5f, 2.5f, 1.5f, 0.5f);
+    const float StartX = static_cast<float>(X0);
+    for (int Y = Y0; Y < Y1; ++Y) {
+        const float CenterY = Y + 0.5f;
+        __m128 Edges[5];
+        __m128 Steps[5];
+        __m128 Thresholds[5];
+        for (unsigned EdgeIdx = 0; EdgeIdx < count; ++EdgeIdx) {
+            __m128 A = _mm_set1_ps(EdgeA[EdgeIdx]);
+            Edges[EdgeIdx] = _mm_add_ps(_mm_mul_ps(A, _mm_add_ps(_mm_set1_ps(StartX), LaneOffsets)), _mm_set1_ps(EdgeB[EdgeIdx] * CenterY + EdgeC[EdgeIdx]));
+            Steps[EdgeIdx] = _mm_set1_ps(4.0f * EdgeA[EdgeIdx]);
+            Thresholds[EdgeIdx] = _mm_set1_ps(Threshold[EdgeIdx]);
+        }
+        __m128 Depth = _mm_add_ps(_mm_mul_ps(_mm_set1_ps(DzDx), _mm_sub_ps(_mm_add_ps(_mm_set1_ps(StartX), LaneOffsets), _mm_set1_ps(P0.x))),
+            _mm_set1_ps(P0.z + DzDy * (CenterY - P0.y) + DepthBias));
+        const __m128 DepthStep = _mm_set1_ps(4.0f * DzDx);
+
+        float* Row = &mDepth[Y * mWidth];
+        for (int X = X0; X < X1; X += 4) {
+            __m128 Inside = _mm_cmpge_ps(Edges[0], Thresholds[0]);
+            Edges[0] = _mm_add_ps(Edges[0], Steps[0]);
+            for (unsigned EdgeIdx = 1; EdgeIdx < count; ++EdgeIdx) {
+                Inside = _mm_and_ps(Inside, _mm_cmpge_ps(Edges[EdgeIdx], Thresholds[EdgeIdx]));
+                Edges[EdgeIdx] = _mm_add_ps(Edges[EdgeIdx], Steps[EdgeIdx]);
+            }
+            if (_mm_movemask_ps(Inside)) {
+                __m128 Old = _mm_loadu_ps(Row + X);
+                __m128 Nearer = _mm_min_ps(Old, Depth);
+                _mm_storeu_ps(Row + X, _mm_or_ps(_mm_and_ps(Inside, Nearer), _mm_andnot_ps(Inside, Old)));
+            }
+            Depth = _mm_add_ps(Depth, DepthStep);
+        }
+    }
+}
+
+void
+SoftwareOcclusion::buildTiles() {
+    const unsigned TilesX = mWidth / TILE_SIZE;
+    for (unsigned TileY = 0; TileY < mHeight / TILE_SIZE; ++TileY) {
+        for (unsigned TileX = 0; TileX < TilesX; ++TileX) {
+            __m128 Max = _mm_set1_ps(-1.0f);
+            for (unsigned Y = TileY * TILE_SIZE; Y < (TileY + 1) * TILE_SIZE; ++Y) {
+                const float* Row = &mDepth[Y * mWidth + TileX * TILE_SIZE];
+                for (unsigned X = 0; X < TILE_SIZE; X += 4) {
+                    Max = _mm_max_ps(Max, _mm_loadu_ps(Row + X));
+                }
+            }
+            Max = _mm_max_ps(Max, _mm_shuffle_ps(Max, Max, _MM_SHUFFLE(1, 0, 3, 2)));
+            Max = _mm_max_ps(Max, _mm_shuffle_ps(Max, Max, _MM_SHUFFLE(2, 3, 0, 1)));
+            _mm_store_ss(&mTileMaxDepth[TileY * TilesX + TileX], Max);
+        }
+    }
+}
+
+bool
+SoftwareOcclusion::IsVisible(const AABB& box) {
+    ++mLastTestedCount;
+    float MinX = static_cast<float>(mWidth), MaxX = 0.0f, MinY = static_cast<float>(mHeight), MaxY = 0.0f, MinZ = 1.0f;
+    for (unsigned Corner = 0; Corner < 8; ++Corner) {
+        glm::vec3 Position(Corner & 1 ? box.Max.x : box.Min.x, Corner & 2 ? box.Max.y : box.Min.y, Corner & 4 ? box.Max.z : box.Min.z);
+        glm::vec4 Clip = mViewProjection * glm::vec4(Position, 1.0f);
+        if (Clip.z < -Clip.w) {
+            return true;
+        }
+        glm::vec3 Screen = ToScreen(Clip, mWidth, mHeight);
+        MinX = std::min(MinX, Screen.x);
+        MaxX = std::max(MaxX, Screen.x);
+        MinY = std::min(MinY, Screen.y);
+        MaxY = std::max(MaxY, Screen.y);
+        MinZ = std::min(MinZ, Screen.z);
+    }
+
+    int X0 = static_cast<int>(std::max(std::floor(MinX), 0.0f));
+    int X1 = static_cast<int>(std::min(std::ceil(MaxX), static_cast<float>(mWidth)));
+    int Y0 = static_cast<int>(std::max(std::floor(MinY), 0.0f));
+    int Y1 = static_cast<int>(std::min(std::ceil(MaxY), static_cast<float>(mHeight)));
+    if (X0 >= X1 || Y0 >= Y1) {
+        ++mLastCulledCount;
+        return false;
+    }
+
+    const unsigned TilesX = mWidth / TILE_SIZE;
+    const __m128 BoxDepth = _mm_set1_ps(MinZ);
+    const __m128 Lanes = _mm_set_ps(3.0f, 2.0f, 1.0f, 0.0f);
+    const __m128 First = _mm_set1_ps(static_cast<float>(X0));
+    const __m128 End = _mm_set1_ps(static_cast<float>(X1));
+    for (int TileY = Y0 / TILE_SIZE; TileY * static_cast<int>(TILE_SIZE) < Y1; ++TileY) {
+        for (int TileX = X0 / TILE_SIZE; TileX * static_cast<int>(TILE_SIZE) < X1; ++TileX) {
+            if (mTileMaxDepth[TileY * TilesX + TileX] < MinZ) {
+                continue;
+            }
+
+            int RowStart = std::max(Y0, TileY * static_cast<int>(TILE_SIZE));
+            int RowEnd = std::min(Y1, (TileY + 1) * static_cast<int>(TILE_SIZE));
+            for (int Y = RowStart; Y < RowEnd; ++Y) {
+                for (int X = TileX * TILE_SIZE; X < (TileX + 1) * static_cast<int>(TILE_SIZE); X += 4) {
+                    __m128 Column = _mm_add_ps(_mm_set1_ps(static_cast<float>(X)), Lanes);
+                    __m128 InRect = _mm_and_ps(_mm_cmpge_ps(Column, First), _mm_cmplt_ps(Column, End));
+                    __m128 Behind = _mm_cmpge_ps(_mm_loadu_ps(&mDepth[Y * mWidth + X]), BoxDepth);
+                    if (_mm_movemask_ps(_mm_and_ps(InRect, Behind))) {
+                        return true;
+                    }
+                }
+            }
+        }
+    }
+
+    ++mLastCulledCount;
+    return false;
+}
+
+void
+SoftwareOcclusion::PrintStats() const {
+    std::cout << "Software occlusion: " << mLastOccluderCount << " occluders in " << mLastRasterMs << " ms at "
+        << mWidth << "x" << mHeight << ", " << mLastCulledCount << " of " << mLastTestedCount << " objects hidden" << std::endl;
+}
@@ -0,0 +1,90 @@
+/**
+ * @file software_occlusion.hpp
+ * @brief Low resolution depth buffer of a few large occluders, rasterized with SSE
+ * on a worker thread and used to cull objects hidden behind them in the same frame
+ *
+ */
+
+#pragma once
+#include <atomic>
+#include <condition_variable>
+#include <mutex>
+#include <thread>
+#include <vector>
+#include <glm/glm.hpp>
+#include "bounds.hpp"
+
+class SoftwareOcclusion {
+public:
+    /**
+     * @brief Ctor - starts the rasterizer thread
+     *
+     * @param width Depth buffer width, rounded up to a multiple of the tile size
+     * @param height Depth buffer height, rounded up to a multiple of the tile size
+     */
+    SoftwareOcclusion(unsigned width, unsigned height);
+    ~SoftwareOcclusion();
+
+    SoftwareOcclusion(const SoftwareOcclusion&) = delete;
+    SoftwareOcclusion& operator=(const SoftwareOcclusion&) = delete;
+
+    /**
+     * @brief Starts rasterizing the occluders for this frame's view and returns immediately
+     *
+     * @param viewProjection Projection * view
+     * @param viewPosition Camera position, occluders around the camera are skipped
+     * @param occluders Matrices that map the unit cube centered on the origin to each occluder box
+     */
+    void Begin(const glm::mat4& viewProjection, const glm::vec3& viewPosition, const std::vector<glm::mat4>& occluders);
+
+    /**
+     * @brief Blocks until the depth buffer of the last Begin is ready
+     *
+     */
+    void Wait();
+
+    /**
+     * @brief Returns false if the box is fully behind the occluders. Boxes crossing the
+     * near plane are always visible. Wait has to be called first, after that it may be
+     * called from several threads at once
+     *
+     * @param box World space box
+     */
+    bool IsVisible(const AABB& box);
+
+    /**
+     * @brief Prints rasterization time and tested and culled objects of the last frame
+     *
+     */
+    void PrintStats() const;
+
+private:
+    // NOTE: Tiles keep the farthest depth of their pixels, a box nearer than
+    // that is visible without looking at single pixels
+    static const unsigned TILE_SIZE = 8;
+
+    unsigned mWidth;
+    unsigned mHeight;
+    std::vector<float> mDepth;
+    std::vector<float> mTileMaxDepth;
+    glm::mat4 mViewProjection;
+    glm::vec3 mViewPosition;
+    std::vector<glm::mat4> mOccluders;
+
+    std::thread mWorker;
+    std::mutex mMutex;
+    std::condition_variable mWakeUp;
+    std::condition_variable mDone;
+    bool mPending;
+    bool mQuit;
+
+    double mLastRasterMs;
+    unsigned mLastOccluderCount;
+    std::atomic<unsigned> mLastTestedCount;
+    std::atomic<unsigned> mLastCulledCount;
+
+    void workerLoop();
+    void rasterize();
+    void rasterizePolygon(const glm::vec3* vertices, unsigned count);
+    void buildTiles();
+};
@@ -0,0 +1,101 @@
+#include "thread_pool.hpp"
+#include <algorithm>
+
+ThreadPool::ThreadPool(unsigned threadCount) {
+    if (!threadCount) {
+        threadCount = std::max(1u, std::thread::hardware_concurrency());
+    }
+
+    mJob = 0;
+    mCount = 0;
+    mChunkSize = 1;
+    mNextChunk = 0;
+    mBusyWorkers = 0;
+    mGeneration = 0;
+    mQuit = false;
+    for (unsigned ThreadIdx = 1; ThreadIdx < threadCount; ++ThreadIdx) {
+        mWorkers.emplace_back(&ThreadPool::workerLoop, this, ThreadIdx);
+    }
+}
+
+ThreadPool::~ThreadPool() {
+    {
+        std::lock_guard<std::mutex> Lock(mMutex);
+        mQuit = true;
+    }
+    mWakeUp.notify_all();
+    for (std::thread& Worker : mWorkers) {
+        Worker.join();
+    }
+}
+
+void
+ThreadPool::ParallelFor(unsigned count, const RangeJob& job, unsigned grain) {
+    if (!count) {
+        return;
+    }
+
+    unsigned ThreadCount = GetThreadCount();
+    // NOTE: A few chunks per thread so uneven chunks still balance out
+    unsigned ChunkSize = std::max(std::max(grain, 1u), (count + ThreadCount * 4 - 1) / (ThreadCount * 4));
+    if (mWorkers.empty() || count <= ChunkSize) {
+        job(0, count, 0);
+        return;
+    }
+
+    {
+        std::lock_guard<std::mutex> Lock(mMutex);
+        mJob = &job;
+        mCount = count;
+        mChunkSize = ChunkSize;
+        mNextChunk = 0;
+        mBusyWorkers = mWorkers.size();
+        ++mGeneration;
+    }
+    mWakeUp.notify_all();
+
+    runChunks(0);
+
+    std::unique_lock<std::mutex> Lock(mMutex);
+    mDone.wait(Lock, [this] { return mBusyWorkers == 0; });
+    mJob = 0;
+}
+
+unsigned
+ThreadPool::GetThreadCount() const {
+    return mWorkers.size() + 1;
+}
+
+void
+ThreadPool::workerLoop(unsigned thread) {
+    unsigned SeenGeneration = 0;
+    for (;;) {
+        {
+            std::unique_lock<std::mutex> Lock(mMutex);
+            mWakeUp.wait(Lock, [&] { return mQuit || mGeneration != SeenGeneration; });
+            if (mQuit) {
+                return;
+            }
+            SeenGeneration = mGeneration;
+        }
+
+        runChunks(thread);
+
+        std::lock_guard<std::mutex> Lock(mMutex);
+        if (--mBusyWorkers == 0) {
+            mDone.notify_one();
+        }
+    }
+}
+
+void
+ThreadPool::runChunks(unsigned thread) {
+    for (;;) {
+        unsigned Begin = mNextChunk.fetch_add(mChunkSize);
+        if (Begin >= mCount) {
+            return;
+        }
+        unsigned End = std::min(mCount, Begin + mChunkSize);
+        (*mJob)(Begin, End, thread);
+    }
+}
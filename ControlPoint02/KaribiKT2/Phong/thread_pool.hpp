@@ -0,0 +1,67 @@
+/**
+ * @file thread_pool.hpp
+ * @brief Fixed set of worker threads for data parallel loops
+ *
+ */
+
+#pragma once
+#include <atomic>
+#include <condition_variable>
+#include <functional>
+#include <mutex>
+#include <thread>
+#include <vector>
+
+class ThreadPool {
+public:
+    /**
+     * @brief Range callback. Receives [begin, end) and the index of the
+     * thread running it, 0 being the calling thread
+     */
+    typedef std::function<void(unsigned begin, unsigned end, unsigned thread)> RangeJob;
+
+    /**
+     * @brief Ctor - starts the worker threads
+     *
+     * @param threadCount Number of threads including the caller. 0 picks
+     * one per hardware thread
+     */
+    ThreadPool(unsigned threadCount = 0);
+    ~ThreadPool();
+
+    ThreadPool(const ThreadPool&) = delete;
+    ThreadPool& operator=(const ThreadPool&) = delete;
+
+    /**
+     * @brief Splits [0, count) into chunks and runs them on all threads.
+     * The calling thread works too and the call returns once every chunk
+     * is done
+     *
+     * @param count Number of items
+     * @param job Callback run for each chunk
+     * @param grain Minimum number of items per chunk
+     */
+    void ParallelFor(unsigned count, const RangeJob& job, unsigned grain = 1);
+
+    /**
+     * @brief Returns number of threads including the caller
+     *
+     */
+    unsigned GetThreadCount() const;
+
+private:
+    std::vector<std::thread> mWorkers;
+    std::mutex mMutex;
+    std::condition_variable mWakeUp;
+    std::condition_variable mDone;
+    const RangeJob* mJob;
+    unsigned mCount;
+    unsigned mChunkSize;
+    std::atomic<unsigned> mNextChunk;
+    unsigned mBusyWorkers;
+    unsigned mGeneration;
+    bool mQuit;
+
+    void workerLoop(unsigned thread);
+    void runChunks(unsigned thread);
+};
@@ -0,0 +1,76 @@
+#include "transform.hpp"
+#include <emmintrin.h>
+
+// NOTE: inverse(M)^T of a 3x3 matrix with columns c0, c1, c2 is the cofactor matrix
+// (c1 x c2, c2 x c0, c0 x c1) divided by the determinant dot(c0, c1 x c2)
+glm::mat3
+Transform::NormalMatrix(const glm::mat4& model) {
+    glm::vec3 C0(model[0]);
+    glm::vec3 C1(model[1]);
+    glm::vec3 C2(model[2]);
+    glm::vec3 Cofactor0 = glm::cross(C1, C2);
+    glm::vec3 Cofactor1 = glm::cross(C2, C0);
+    glm::vec3 Cofactor2 = glm::cross(C0, C1);
+    float InvDet = 1.0f / glm::dot(C0, Cofactor0);
+    return glm::mat3(Cofactor0 * InvDet, Cofactor1 * InvDet, Cofactor2 * InvDet);
+}
+
+struct Vec3x4 {
+    __m128 X;
+    __m128 Y;
+    __m128 Z;
+};
+
+static inline Vec3x4
+LoadColumns(const glm::mat4* models, unsigned column) {
+    Vec3x4 Result;
+    Result.X = _mm_setr_ps(models[0][column].x, models[1][column].x, models[2][column].x, models[3][column].x);
+    Result.Y = _mm_setr_ps(models[0][column].y, models[1][column].y, models[2][column].y, models[3][column].y);
+    Result.Z = _mm_setr_ps(models[0][column].z, models[1][column].z, models[2][column].z, models[3][column].z);
+    return Result;
+}
+
+static inline Vec3x4
+Cross(const Vec3x4& a, const Vec3x4& b) {
+    Vec3x4 Result;
+    Result.X = _mm_sub_ps(_mm_mul_ps(a.Y, b.Z), _mm_mul_ps(a.Z, b.Y));
+    Result.Y = _mm_sub_ps(_mm_mul_ps(a.Z, b.X), _mm_mul_ps(a.X, b.Z));
+    Result.Z = _mm_sub_ps(_mm_mul_ps(a.X, b.Y), _mm_mul_ps(a.Y, b.X));
+    return Result;
+}
+
+static inline void
+StoreColumns(const Vec3x4& v, __m128 scale, glm::mat3* normals, unsigned column) {
+    alignas(16) float X[4];
+    alignas(16) float Y[4];
+    alignas(16) float Z[4];
+    _mm_store_ps(X, _mm_mul_ps(v.X, scale));
+    _mm_store_ps(Y, _mm_mul_ps(v.Y, scale));
+    _mm_store_ps(Z, _mm_mul_ps(v.Z, scale));
+    for (unsigned Lane = 0; Lane < 4; ++Lane) {
+        normals[Lane][column] = glm::vec3(X[Lane], Y[Lane], Z[Lane]);
+    }
+}
+
+void
+Transform::NormalMatrices(const glm::mat4* models, glm::mat3* normals, unsigned count) {
+    // NOTE: Four matrices are transposed into SSE lanes so every lane runs the scalar formula above
+    unsigned MatrixIdx = 0;
+    for (; MatrixIdx + 4 <= count; MatrixIdx += 4) {
+        Vec3x4 C0 = LoadColumns(models + MatrixIdx, 0);
+        Vec3x4 C1 = LoadColumns(models + MatrixIdx, 1);
+        Vec3x4 C2 = LoadColumns(models + MatrixIdx, 2);
+        Vec3x4 Cofactor0 = Cross(C1, C2);
+        Vec3x4 Cofactor1 = Cross(C2, C0);
+        Vec3x4 Cofactor2 = Cross(C0, C1);
+        __m128 Det = _mm_add_ps(_mm_add_ps(_mm_mul_ps(C0.X, Cofactor0.X), _mm_mul_ps(C0.Y, Cofactor0.Y)), _mm_mul_ps(C0.Z, Cofactor0.Z));
+        __m128 InvDet = _mm_div_ps(_mm_set1_ps(1.0f), Det);
+        StoreColumns(Cofactor0, InvDet, normals + MatrixIdx, 0);
+        StoreColumns(Cofactor1, InvDet, normals + MatrixIdx, 1);
+        StoreColumns(Cofactor2, InvDet, normals + MatrixIdx, 2);
+    }
+
+    for (; MatrixIdx < count; ++MatrixIdx) {
+        normals[MatrixIdx] = NormalMatrix(models[MatrixIdx]);
+    }
+}
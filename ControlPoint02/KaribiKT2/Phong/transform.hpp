@@ -0,0 +1,28 @@
+/**
+ * @file transform.hpp
+ * @brief Helpers for deriving per object matrices on the CPU
+ *
+ */
+
+#pragma once
+#include <glm/glm.hpp>
+
+class Transform {
+public:
+    /**
+     * @brief Returns the inverse transpose of the upper 3x3 of the model matrix,
+     * i.e. the matrix that transforms normals to world space
+     *
+     * @param model Model matrix
+     */
+    static glm::mat3 NormalMatrix(const glm::mat4& model);
+
+    /**
+     * @brief Computes normal matrices for a batch of model matrices, four at a time with SSE
+     *
+     * @param models Model matrices
+     * @param normals Output, one normal matrix per model matrix
+     * @param count Number of matrices
+     */
+    static void NormalMatrices(const glm::mat4* models, glm::mat3* normals, unsigned count);
+};
@@ -0,0 +1,194 @@
+#include "transform_array.hpp"
+#include <glm/gtc/matrix_transform.hpp>
+#include <xmmintrin.h>
+#include <algorithm>
+#include <chrono>
+#include <cstdlib>
+#include <cmath>
+#include <iostream>
+#include <iomanip>
+
+unsigned
+TransformArray::Add(const glm::vec3& position, const glm::quat& rotation, const glm::vec3& scale) {
+    mPositionX.push_back(position.x);
+    mPositionY.push_back(position.y);
+    mPositionZ.push_back(position.z);
+    mRotationX.push_back(rotation.x);
+    mRotationY.push_back(rotation.y);
+    mRotationZ.push_back(rotation.z);
+    mRotationW.push_back(rotation.w);
+    mScaleX.push_back(scale.x);
+    mScaleY.push_back(scale.y);
+    mScaleZ.push_back(scale.z);
+    return mPositionX.size() - 1;
+}
+
+void
+TransformArray::SetPosition(unsigned idx, const glm::vec3& position) {
+    mPositionX[idx] = position.x;
+    mPositionY[idx] = position.y;
+    mPositionZ[idx] = position.z;
+}
+
+void
+TransformArray::SetRotation(unsigned idx, const glm::quat& rotation) {
+    mRotationX[idx] = rotation.x;
+    mRotationY[idx] = rotation.y;
+    mRotationZ[idx] = rotation.z;
+    mRotationW[idx] = rotation.w;
+}
+
+void
+TransformArray::SetScale(unsigned idx, const glm::vec3& scale) {
+    mScaleX[idx] = scale.x;
+    mScaleY[idx] = scale.y;
+    mScaleZ[idx] = scale.z;
+}
+
+unsigned
+TransformArray::GetCount() const {
+    return mPositionX.size();
+}
+
+// NOTE: Lanes hold one matrix element of four transforms, the transpose turns
+// four such element vectors into one column of each of the four matrices
+static inline void
+StoreColumn(glm::mat4* models, unsigned column, __m128 x, __m128 y, __m128 z, __m128 w) {
+    _MM_TRANSPOSE4_PS(x, y, z, w);
+    _mm_storeu_ps(&models[0][column][0], x);
+    _mm_storeu_ps(&models[1][column][0], y);
+    _mm_storeu_ps(&models[2][column][0], z);
+    _mm_storeu_ps(&models[3][column][0], w);
+}
+
+void
+TransformArray::ComputeMatrices(glm::mat4* models) const {
+    const unsigned Count = GetCount();
+    const __m128 One = _mm_set1_ps(1.0f);
+    const __m128 Two = _mm_set1_ps(2.0f);
+    const __m128 Zero = _mm_setzero_ps();
+
+    unsigned Idx = 0;
+    for (; Idx + 4 <= Count; Idx += 4) {
+        __m128 QX = _mm_loadu_ps(&mRotationX[Idx]);
+        __m128 QY = _mm_loadu_ps(&mRotationY[Idx]);
+        __m128 QZ = _mm_loadu_ps(&mRotationZ[Idx]);
+        __m128 QW = _mm_loadu_ps(&mRotationW[Idx]);
+
+        // NOTE: Same terms as glm::mat3_cast
+        __m128 XX = _mm_mul_ps(QX, QX);
+        __m128 YY = _mm_mul_ps(QY, QY);
+        __m128 ZZ = _mm_mul_ps(QZ, QZ);
+        __m128 XY = _mm_mul_ps(QX, QY);
+        __m128 XZ = _mm_mul_ps(QX, QZ);
+        __m128 YZ = _mm_mul_ps(QY, QZ);
+        __m128 WX = _mm_mul_ps(QW, QX);
+        __m128 WY = _mm_mul_ps(QW, QY);
+        __m128 WZ = _mm_mul_ps(QW, QZ);
+
+        __m128 SX = _mm_loadu_ps(&mScaleX[Idx]);
+        __m128 SY = _mm_loadu_ps(&mScaleY[Idx]);
+        __m128 SZ = _mm_loadu_ps(&mScaleZ[Idx]);
+
+        __m128 M00 = _mm_mul_ps(_mm_sub_ps(One, _mm_mul_ps(Two, _mm_add_ps(YY, ZZ))), SX);
+        __m128 M01 = _mm_mul_ps(_mm_mul_ps(Two, _mm_add_ps(XY, WZ)), SX);
+        __m128 M02 = _mm_mul_ps(_mm_mul_ps(Two, _mm_sub_ps(XZ, WY)), SX);
+
+        __m128 M10 = _mm_mul_ps(_mm_mul_ps(Two, _mm_sub_ps(XY, WZ)), SY);
+        __m128 M11 = _mm_mul_ps(_mm_sub_ps(One, _mm_mul_ps(Two, _mm_add_ps(XX, ZZ))), SY);
+        __m128 M12 = _mm_mul_ps(_mm_mul_ps(Two, _mm_add_ps(YZ, WX)), SY);
+
+        __m128 M20 = _mm_mul_ps(_mm_mul_ps(Two, _mm_add_ps(XZ, WY)), SZ);
+        __m128 M21 = _mm_mul_ps(_mm_mul_ps(Two, _mm_sub_ps(YZ, WX)), SZ);
+        __m128 M22 = _mm_mul_ps(_mm_sub_ps(One, _mm_mul_ps(Two, _mm_add_ps(XX, YY))), SZ);
+
+        glm::mat4* Out = models + Idx;
+        StoreColumn(Out, 0, M00, M01, M02, Zero);
+        StoreColumn(Out, 1, M10, M11, M12, Zero);
+        StoreColumn(Out, 2, M20, M21, M22, Zero);
+        StoreColumn(Out, 3, _mm_loadu_ps(&mPositionX[Idx]), _mm_loadu_ps(&mPositionY[Idx]), _mm_loadu_ps(&mPositionZ[Idx]), One);
+    }
+
+    ComputeMatricesScalar(models, Idx);
+}
+
+void
+TransformArray::ComputeMatricesScalar(glm::mat4* models, unsigned first) const {
+    for (unsigned Idx = first; Idx < GetCount(); ++Idx) {
+        glm::mat3 Rotation = glm::mat3_cast(glm::quat(mRotationW[Idx], mRotationX[Idx], mRotationY[Idx], mRotationZ[Idx]));
+        glm::mat4& Model = models[Idx];
+        Model[0] = glm::vec4(Rotation[0] * mScaleX[Idx], 0.0f);
+        Model[1] = glm::vec4(Rotation[1] * mScaleY[Idx], 0.0f);
+        Model[2] = glm::vec4(Rotation[2] * mScaleZ[Idx], 0.0f);
+        Model[3] = glm::vec4(mPositionX[Idx], mPositionY[Idx], mPositionZ[Idx], 1.0f);
+    }
+}
+
+static float
+RandomFloat(float min, float max) {
+    return min + (max - min) * (std::rand() / static_cast<float>(RAND_MAX));
+}
+
+template<typename F>
+static double
+TimeNanosecondsPerTransform(unsigned count, unsigned repeats, F function) {
+    std::chrono::high_resolution_clock::time_point Start = std::chrono::high_resolution_clock::now();
+    for (unsigned Repeat = 0; Repeat < repeats; ++Repeat) {
+        function();
+    }
+    std::chrono::duration<double, std::nano> Elapsed = std::chrono::high_resolution_clock::now() - Start;
+    return Elapsed.count() / (static_cast<double>(count) * repeats);
+}
+
+void
+TransformArray::Benchmark() {
+    const unsigned Counts[] = { 1000, 10000, 100000 };
+    std::cout << "Transform benchmark, ns per transform" << std::endl;
+    std::cout << std::setw(8) << "Count" << std::setw(12) << "glm chain" << std::setw(12) << "SoA scalar" << std::setw(12) << "SoA SSE" << std::setw(12) << "Max error" << std::endl;
+    for (unsigned CountIdx = 0; CountIdx < sizeof(Counts) / sizeof(Counts[0]); ++CountIdx) {
+        const unsigned Count = Counts[CountIdx];
+        // NOTE: Around 2M transforms per measurement, enough to rise above timer noise
+        const unsigned Repeats = 2000000 / Count;
+
+        std::srand(Count);
+        TransformArray Transforms;
+        std::vector<glm::vec3> Positions(Count);
+        std::vector<float> Angles(Count);
+        std::vector<glm::vec3> Axes(Count);
+        std::vector<glm::vec3> Scales(Count);
+        for (unsigned Idx = 0; Idx < Count; ++Idx) {
+            Positions[Idx] = glm::vec3(RandomFloat(-50, 50), RandomFloat(-50, 50), RandomFloat(-50, 50));
+            Angles[Idx] = RandomFloat(0, 360);
+            Axes[Idx] = glm::normalize(glm::vec3(RandomFloat(-1, 1), RandomFloat(-1, 1), RandomFloat(0.1f, 1)));
+            Scales[Idx] = glm::vec3(RandomFloat(0.1f, 5), RandomFloat(0.1f, 5), RandomFloat(0.1f, 5));
+            Transforms.Add(Positions[Idx], glm::angleAxis(glm::radians(Angles[Idx]), Axes[Idx]), Scales[Idx]);
+        }
+
+        std::vector<glm::mat4> Reference(Count);
+        std::vector<glm::mat4> Scalar(Count);
+        std::vector<glm::mat4> Simd(Count);
+        double ChainTime = TimeNanosecondsPerTransform(Count, Repeats, [&]() {
+            for (unsigned Idx = 0; Idx < Count; ++Idx) {
+                glm::mat4 Model(1.0f);
+                Model = glm::translate(Model, Positions[Idx]);
+                Model = glm::rotate(Model, glm::radians(Angles[Idx]), Axes[Idx]);
+                Reference[Idx] = glm::scale(Model, Scales[Idx]);
+            }
+        });
+        double ScalarTime = TimeNanosecondsPerTransform(Count, Repeats, [&]() { Transforms.ComputeMatricesScalar(Scalar.data()); });
+        double SimdTime = TimeNanosecondsPerTransform(Count, Repeats, [&]() { Transforms.ComputeMatrices(Simd.data()); });
+
+        float MaxError = 0.0f;
+        for (unsigned Idx = 0; Idx < Count; ++Idx) {
+            for (unsigned Column = 0; Column < 4; ++Column) {
+                for (unsigned Row = 0; Row < 4; ++Row) {
+                    MaxError = std::max(MaxError, std::fabs(Reference[Idx][Column][Row] - Simd[Idx][Column][Row]));
+                }
+            }
+        }
+
+        std::cout << std::setw(8) << Count << std::fixed << std::setprecision(2)
+            << std::setw(12) << ChainTime << std::setw(12) << ScalarTime << std::setw(12) << SimdTime
+            << std::scientific << std::setprecision(1) << std::setw(12) << MaxError << std::defaultfloat << std::endl;
+    }
+}
@@ -0,0 +1,60 @@
+/**
+ * @file transform_array.hpp
+ * @brief Position, rotation and scale of many objects stored as structure-of-arrays
+ *
+ */
+
+#pragma once
+#include <vector>
+#include <glm/glm.hpp>
+#include <glm/gtc/quaternion.hpp>
+
+class TransformArray {
+public:
+    /**
+     * @brief Appends a transform
+     *
+     * @returns Index used by the setters
+     */
+    unsigned Add(const glm::vec3& position, const glm::quat& rotation, const glm::vec3& scale);
+
+    void SetPosition(unsigned idx, const glm::vec3& position);
+    void SetRotation(unsigned idx, const glm::quat& rotation);
+    void SetScale(unsigned idx, const glm::vec3& scale);
+    unsigned GetCount() const;
+
+    /**
+     * @brief Builds translate * rotate * scale matrices directly from the components,
+     * four transforms at a time with SSE
+     *
+     * @param models Output, one matrix per transform
+     */
+    void ComputeMatrices(glm::mat4* models) const;
+
+    /**
+     * @brief Scalar version of ComputeMatrices, used for the tail and as reference
+     *
+     * @param models Output, one matrix per transform
+     * @param first First transform to compute
+     */
+    void ComputeMatricesScalar(glm::mat4* models, unsigned first = 0) const;
+
+    /**
+     * @brief Times the glm translate/rotate/scale chain against the scalar and SSE
+     * paths for 1K to 100K random transforms and prints the results
+     *
+     */
+    static void Benchmark();
+
+private:
+    std::vector<float> mPositionX;
+    std::vector<float> mPositionY;
+    std::vector<float> mPositionZ;
+    std::vector<float> mRotationX;
+    std::vector<float> mRotationY;
+    std::vector<float> mRotationZ;
+    std::vector<float> mRotationW;
+    std::vector<float> mScaleX;
+    std::vector<float> mScaleY;
+    std::vector<float> mScaleZ;
+};
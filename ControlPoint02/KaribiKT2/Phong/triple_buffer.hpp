@@ -0,0 +1,104 @@
+/**
+ * @file triple_buffer.hpp
+ * @brief Hands the latest value from one producer thread to one consumer thread.
+ * Each side owns one of three slots, so neither waits for the other to finish its slot
+ *
+ */
+
+#pragma once
+#include <algorithm>
+#include <chrono>
+#include <condition_variable>
+#include <mutex>
+
+template<typename T>
+class TripleBuffer {
+public:
+    TripleBuffer() : mWriteIdx(0), mReadyIdx(1), mReadIdx(2), mFresh(false), mClosed(false) {}
+
+    TripleBuffer(const TripleBuffer&) = delete;
+    TripleBuffer& operator=(const TripleBuffer&) = delete;
+
+    /**
+     * @brief Returns the producer's slot. It still holds an older value, which lets
+     * containers keep their memory
+     *
+     */
+    T& GetWriteSlot() {
+        return mSlots[mWriteIdx];
+    }
+
+    /**
+     * @brief Makes the write slot the latest value. A value the consumer has not
+     * taken yet is dropped and its slot is written next
+     *
+     */
+    void Publish() {
+        {
+            std::lock_guard<std::mutex> Lock(mMutex);
+            std::swap(mWriteIdx, mReadyIdx);
+            mFresh = true;
+        }
+        mChanged.notify_all();
+    }
+
+    /**
+     * @brief Blocks until the consumer took the latest value or the timeout passes
+     *
+     * @returns true - Taken or closed, false - Timed out
+     */
+    bool WaitForTake(std::chrono::milliseconds timeout) {
+        std::unique_lock<std::mutex> Lock(mMutex);
+        return mChanged.wait_for(Lock, timeout, [this] { return !mFresh || mClosed; });
+    }
+
+    /**
+     * @brief Blocks until a value newer than the read slot is published and makes it the read slot
+     *
+     * @returns true - New value, false - Closed
+     */
+    bool Acquire() {
+        {
+            std::unique_lock<std::mutex> Lock(mMutex);
+            mChanged.wait(Lock, [this] { return mFresh || mClosed; });
+            if (mClosed) {
+                return false;
+            }
+            std::swap(mReadIdx, mReadyIdx);
+            mFresh = false;
+        }
+        mChanged.notify_all();
+        return true;
+    }
+
+    /**
+     * @brief Returns the consumer's slot, it is not touched by the producer until the next Acquire
+     *
+     */
+    T& GetReadSlot() {
+        return mSlots[mReadIdx];
+    }
+
+    /**
+     * @brief Wakes both sides, Acquire returns false from now on
+     *
+     */
+    void Close() {
+        {
+            std::lock_guard<std::mutex> Lock(mMutex);
+            mClosed = true;
+        }
+        mChanged.notify_all();
+    }
+
+private:
+    T mSlots[3];
+    unsigned mWriteIdx;
+    unsigned mReadyIdx;
+    unsigned mReadIdx;
+    // NOTE: Set while the ready slot holds a value the consumer has not taken
+    bool mFresh;
+    bool mClosed;
+    std::mutex mMutex;
+    std::condition_variable mChanged;
+};